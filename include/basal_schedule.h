@@ -0,0 +1,78 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016 Darrell Wright
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "data_types.h"
+#include "lib_iob_history.h"
+#include "tz_cache.h"
+
+namespace ns {
+	namespace lib {
+		namespace iob {
+			/// @brief Basal profile compiled to a rate per minute of the day and the insulin scheduled from midnight
+			/// to each minute, so the insulin over any interval is the difference of two lookups
+			class basal_schedule_t {
+				std::vector<insulin_t> m_rates;	// U/hr for each minute of the day
+				std::vector<insulin_t> m_cumulative;	// U from midnight to the start of each minute, and the whole day
+
+				insulin_t cumulative_in_day( timestamp_t::duration const & time_of_day ) const;
+
+			public:
+				explicit basal_schedule_t( std::vector<basal_profile_entry_t> const & basal_profile );
+
+				~basal_schedule_t( ) = default;
+				basal_schedule_t( basal_schedule_t const & ) = default;
+				basal_schedule_t( basal_schedule_t && ) = default;
+				basal_schedule_t & operator=( basal_schedule_t const & ) = default;
+				basal_schedule_t & operator=( basal_schedule_t && ) = default;
+
+				/// @brief Scheduled rate, U/hr, at local wall clock time
+				insulin_t rate_at( timestamp_t::duration const & local ) const;
+				insulin_t rate_at( timestamp_t const & utc, tz_cache_t const & tz ) const;
+
+				/// @brief U scheduled from the local epoch to local
+				insulin_t cumulative( timestamp_t::duration const & local ) const;
+
+				/// @brief U scheduled over [local_from, local_to) of wall clock time
+				insulin_t scheduled_insulin( timestamp_t::duration const & local_from, timestamp_t::duration const & local_to ) const;
+
+				/// @brief U scheduled over [from, to).  Each side of a clock change is counted in its own wall clock
+				/// time, so the hour skipped or repeated is not
+				insulin_t scheduled_insulin( timestamp_t const & from, timestamp_t const & to, tz_cache_t const & tz ) const;
+
+				insulin_t daily_total( ) const;
+				insulin_t max_rate( ) const;
+			};	// basal_schedule_t
+
+			/// @brief Insulin delivered by temp above, or when negative below, the schedule
+			insulin_t net_basal_insulin( temp_basal_t const & temp, basal_schedule_t const & schedule, tz_cache_t const & tz );
+
+			/// @brief Read a pump basal profile, an array of { "minutes", "rate" } entries
+			std::vector<basal_profile_entry_t> basal_profile_from_file( std::string const & file_name );
+		}	// namespace iob
+	}	// namespace lib
+}    // namespace ns
@@ -0,0 +1,102 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016 Darrell Wright
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+
+#include "iob_forecast.h"
+
+namespace ns {
+	struct prediction_inputs_t {
+		double bg;	// current BG, mg/dL
+		double min_delta;	// smallest of delta, short and long average delta, mg/dL/5m
+		double sens;	// ISF, mg/dL/U
+		double carb_ratio;	// g/U
+		double meal_cob;	// carbs on board, g
+		double slope_from_deviations;	// change in the unannounced meal impact per 5m tick
+		std::chrono::minutes remaining_carb_time;	// how long carbs still on board have left to absorb
+		std::chrono::minutes min_bg_after;	// min_bg ignores predictions before this, 90 minutes starts at index 18
+
+		prediction_inputs_t( double BG, double minDelta, double Sens, double carbRatio, double mealCob = 0.0, double slopeFromDeviations = 0.0 );
+
+		prediction_inputs_t( ) = delete;
+		~prediction_inputs_t( ) = default;
+		prediction_inputs_t( prediction_inputs_t const & ) = default;
+		prediction_inputs_t( prediction_inputs_t && ) = default;
+		prediction_inputs_t & operator=( prediction_inputs_t const & ) = default;
+		prediction_inputs_t & operator=( prediction_inputs_t && ) = default;
+	};	// prediction_inputs_t
+
+	struct prediction_curve_summary_t {
+		double min_bg;	// lowest point after min_bg_after
+		double min_guard_bg;	// lowest point
+		double max_bg;
+		double eventual_bg;	// last point
+	};	// prediction_curve_summary_t
+
+	struct prediction_summary_t {
+		double bgi;	// BG impact of the current insulin activity, mg/dL/5m
+		double carb_impact;	// deviation of BG from the insulin impact, mg/dL/5m
+		double carb_impact_ticks;	// 5m ticks the remaining carbs take at the current carb impact
+		prediction_curve_summary_t iob;	// insulin only, deviations decay to zero over an hour
+		prediction_curve_summary_t cob;	// insulin and the remaining carbs
+		prediction_curve_summary_t uam;	// insulin and an unannounced meal following the deviation slope
+	};	// prediction_summary_t
+
+	/// @brief Projects BG every 5 minutes along the IOB, COB and UAM curves.
+	/// The curves are kept in fixed storage and reused across predictions,
+	/// each curve starts with the current BG followed by one point per
+	/// activity value
+	class bg_prediction_engine_t {
+	public:
+		static constexpr size_t const max_ticks = 48;	// 4 hours
+		using curve_t = std::array<double, max_ticks + 1>;
+	private:
+		curve_t m_iob;
+		curve_t m_cob;
+		curve_t m_uam;
+		size_t m_size;
+	public:
+		bg_prediction_engine_t( ) noexcept;
+		~bg_prediction_engine_t( ) = default;
+		bg_prediction_engine_t( bg_prediction_engine_t const & ) = default;
+		bg_prediction_engine_t( bg_prediction_engine_t && ) = default;
+		bg_prediction_engine_t & operator=( bg_prediction_engine_t const & ) = default;
+		bg_prediction_engine_t & operator=( bg_prediction_engine_t && ) = default;
+
+		/// @brief Predict from the insulin activity(U/min) at each 5 minute tick, starting now.
+		/// Only the first max_ticks values are used
+		prediction_summary_t predict( prediction_inputs_t const & inputs, double const * activity, size_t count ) noexcept;
+
+		/// @brief Predict from a forecast with a 5 minute step
+		prediction_summary_t predict( prediction_inputs_t const & inputs, iob_forecast_t const & forecast );
+
+		/// @brief Points in each curve from the last prediction
+		size_t size( ) const noexcept;
+		double const * iob_curve( ) const noexcept;
+		double const * cob_curve( ) const noexcept;
+		double const * uam_curve( ) const noexcept;
+	};	// bg_prediction_engine_t
+}	// namespace ns
@@ -0,0 +1,50 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016 Darrell Wright
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <chrono>
+
+namespace ns {
+	/// @brief Whole minutes from lhs to rhs
+	double calc_duration( std::chrono::system_clock::time_point const & lhs, std::chrono::system_clock::time_point const & rhs );
+
+	struct carb_dose_t {
+		using timestamp_t = std::chrono::system_clock::time_point;
+		double amount;
+		double absorption_rate;
+		timestamp_t dose_time;
+
+		carb_dose_t( ) = delete;
+		~carb_dose_t( ) = default;
+		carb_dose_t( carb_dose_t const & ) = default;
+		carb_dose_t & operator=( carb_dose_t const & ) = default;
+		carb_dose_t( carb_dose_t && ) = default;
+		carb_dose_t & operator=( carb_dose_t && ) = default;
+
+		carb_dose_t( timestamp_t doseTime, double Amount, double absorptionRate );
+
+		static double calc_cob( carb_dose_t const & item, timestamp_t const & current_ts );
+
+		double tick( timestamp_t const & current_ts ) const;
+	};	// carb_dose_t
+}	// namespace ns
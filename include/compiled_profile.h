@@ -0,0 +1,94 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016 Darrell Wright
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "basal_schedule.h"
+#include "data_types.h"
+#include "lib_iob_history.h"
+#include "tz_cache.h"
+
+namespace ns {
+	/// @brief value from start minutes after local midnight until the next entry
+	struct schedule_entry_t {
+		std::chrono::minutes start;
+		double value;
+	};	// schedule_entry_t
+
+	struct bg_target_entry_t {
+		std::chrono::minutes start;
+		glucose_t low;
+		glucose_t high;
+	};	// bg_target_entry_t
+
+	/// @brief Everything the profile schedules for one minute of the day
+	struct profile_values_t {
+		insulin_t basal;	// U/hr
+		double isf;
+		double carb_ratio;
+		glucose_t min_bg;
+		glucose_t max_bg;
+
+		glucose_t target_bg( ) const noexcept;
+	};	// profile_values_t
+
+	/// @brief Pump schedules compiled to one profile_values_t per minute of the day, so what applied at any time is
+	/// a single lookup
+	class compiled_profile_t {
+		std::vector<profile_values_t> m_values;	// each minute of the day
+		lib::iob::basal_schedule_t m_basal_schedule;
+		tz_cache_t m_tz;
+
+	public:
+		/// @param carb_ratios may be empty, the ratio is then 0
+		/// @param tz the pump's time zone, which the schedules are in
+		compiled_profile_t( std::vector<lib::iob::basal_profile_entry_t> const & basal_profile, std::vector<schedule_entry_t> const & isf, std::vector<schedule_entry_t> const & carb_ratios, std::vector<bg_target_entry_t> const & bg_targets, tz_cache_t tz );
+		/// @param values one for each minute of the day, as from values( )
+		compiled_profile_t( std::vector<profile_values_t> values, tz_cache_t tz );
+
+		~compiled_profile_t( ) = default;
+		compiled_profile_t( compiled_profile_t const & ) = default;
+		compiled_profile_t( compiled_profile_t && ) = default;
+		compiled_profile_t & operator=( compiled_profile_t const & ) = default;
+		compiled_profile_t & operator=( compiled_profile_t && ) = default;
+
+		profile_values_t const & at_minute( std::chrono::minutes const minute_of_day ) const;
+		/// @brief Values at local wall clock time
+		profile_values_t const & at_local( timestamp_t::duration const & local ) const;
+		profile_values_t const & at( timestamp_t const & utc ) const;
+
+		std::vector<profile_values_t> const & values( ) const noexcept;
+		lib::iob::basal_schedule_t const & basal_schedule( ) const noexcept;
+		tz_cache_t const & tz( ) const noexcept;
+	};	// compiled_profile_t
+
+	/// @brief Read the sensitivities of insulin_sensitivities.json
+	std::vector<schedule_entry_t> isf_from_file( std::string const & file_name );
+	/// @brief Read the schedule of carb_ratios.json
+	std::vector<schedule_entry_t> carb_ratios_from_file( std::string const & file_name );
+	/// @brief Read the targets of bg_targets.json
+	std::vector<bg_target_entry_t> bg_targets_from_file( std::string const & file_name );
+}    // namespace ns
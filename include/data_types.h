@@ -32,6 +32,8 @@
 #include <daw/json/daw_json_link.h>
 #include <daw/json/value_t.h>
 
+#include "determine_basal_reason.h"
+
 namespace ns {
 	using json_t = daw::json::impl::value_t;
 	using json_real = typename json_t::real_t;
@@ -44,7 +46,13 @@ namespace ns {
 
 	struct requested_temp_t {
 		boost::optional<std::string> error;
+		boost::optional<insulin_t> rate;
+		boost::optional<std::chrono::minutes> duration;
+		reason_log_t reason;
 
+		/// @brief Render the reason events as text, only done when the
+		/// result is output
+		std::string reason_text( ) const;
 	};	// requested_temp
 
 	enum class profile_types: size_t { current };
@@ -61,6 +69,7 @@ namespace ns {
 		boost::optional<bool> temp_target_set;
 		boost::optional<dia_t> dia;
 		boost::optional<double> sens;
+		boost::optional<double> carb_ratio;
 		boost::optional<glucose_t> max_bg;
 		boost::optional<glucose_t> min_bg;
 		boost::optional<glucose_t> target_bg;
@@ -87,6 +96,7 @@ namespace ns {
 				temp_target_set{ },
 				dia{ },
 				sens{ },
+				carb_ratio{ },
 				max_bg{ },
 				min_bg{ },
 				target_bg{ },
@@ -111,6 +121,7 @@ namespace ns {
 				link_boolean( "temp_target_set", temp_target_set );
 				//link_object( "dia", dia );
 				link_real( "sens", sens );
+				link_real( "carb_ratio", carb_ratio );
 				link_real( "max_bg", max_bg );
 				link_real( "min_bg", min_bg );
 				link_real( "target_bg", target_bg );
@@ -173,7 +184,9 @@ namespace ns {
 	};	// autosense_data_t
 
 	struct meal_data_t {
-
+		double meal_cob;	// carbs on board, g
+		double slope_from_max_deviation;
+		double slope_from_min_deviation;
 	};	// meal_data_t
 
 	struct current_temp_t {
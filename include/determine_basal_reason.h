@@ -0,0 +1,107 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016 Darrell Wright
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+
+namespace ns {
+	/// @brief What a determine_basal decision step did, the operands are
+	/// stored alongside so the text is only produced when it is asked for
+	enum class reason_code_t: uint8_t {
+		basal_adjusted_autosens,	// from, to
+		cgm_calibrating,	// bg
+		cgm_calibrating_set_basal,	// basal
+		cgm_calibrating_temp_below_basal,	// temp rate, basal
+		temp_target_set,
+		target_bg_unchanged,	// target
+		target_bg_adjusted,	// from, to
+		bg_targets,	// min bg, max bg, target bg after any adjustment
+		predicted,	// eventual bg, min predicted bg
+		low_glucose_suspend,	// min guard bg, threshold
+		eventual_bg_below_min,	// eventual bg, min bg
+		eventual_bg_below_min_rising,	// min delta, expected delta
+		delta_below_expected,	// min delta, expected delta
+		in_range,	// eventual bg, min predicted bg
+		iob_above_max,	// iob, max iob
+		insulin_req_limited,	// insulin required, max iob - iob
+		rate_above_max_safe,	// rate, max safe basal
+		temp_above_required,	// temp rate, required rate
+		set_current_basal,	// basal
+		no_decision	// current temp rate
+	};
+
+	std::ostream & operator<<( std::ostream & os, reason_code_t code );
+
+	struct reason_event_t {
+		std::array<double, 3> operands;
+		reason_code_t code;
+
+		double const & operator[]( size_t pos ) const noexcept {
+			return operands[pos];
+		}
+	};	// reason_event_t
+
+	std::ostream & operator<<( std::ostream & os, reason_event_t const & event );
+
+	/// @brief A fixed capacity list of reason events.  Adding an event never
+	/// allocates, events past the capacity are counted but not kept
+	class reason_log_t {
+	public:
+		static constexpr size_t const capacity = 16;
+	private:
+		std::array<reason_event_t, capacity> m_events;
+		size_t m_size;
+		size_t m_dropped;
+	public:
+		using const_iterator = typename std::array<reason_event_t, capacity>::const_iterator;
+
+		reason_log_t( ) noexcept;
+		~reason_log_t( ) = default;
+		reason_log_t( reason_log_t const & ) = default;
+		reason_log_t( reason_log_t && ) = default;
+		reason_log_t & operator=( reason_log_t const & ) = default;
+		reason_log_t & operator=( reason_log_t && ) = default;
+
+		void add( reason_code_t code, double operand0 = 0.0, double operand1 = 0.0, double operand2 = 0.0 ) noexcept;
+		void clear( ) noexcept;
+
+		const_iterator begin( ) const noexcept;
+		const_iterator end( ) const noexcept;
+		size_t size( ) const noexcept;
+		bool empty( ) const noexcept;
+		bool contains( reason_code_t code ) const noexcept;
+
+		/// @brief Events that did not fit in the log
+		size_t dropped( ) const noexcept;
+
+		reason_event_t const & operator[]( size_t pos ) const noexcept;
+	};	// reason_log_t
+
+	/// @brief The events as oref0 reason text, separated by "; "
+	std::ostream & operator<<( std::ostream & os, reason_log_t const & reasons );
+	std::string to_string( reason_log_t const & reasons );
+}    // namespace ns
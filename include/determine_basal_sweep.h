@@ -0,0 +1,119 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016 Darrell Wright
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <boost/optional.hpp>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include "data_types.h"
+#include "determine_basal_reason.h"
+
+namespace ns {
+	/// @brief The profile values determine_basal and the temp basal limits
+	/// read, as plain members so a variant is cheap to make and copy
+	struct profile_variant_t {
+		bool autosens_adjust_targets;
+		boost::optional<bool> temp_target_set;
+		boost::optional<glucose_t> max_bg;
+		boost::optional<glucose_t> min_bg;
+		boost::optional<glucose_t> target_bg;
+		boost::optional<insulin_t> current_basal;
+		boost::optional<insulin_t> max_basal;
+		boost::optional<insulin_t> max_daily_basal;
+		boost::optional<double> sens;
+		boost::optional<double> carb_ratio;
+		double autosens_max;
+		double autosens_min;
+		double current_basal_safety_multiplier;
+		double max_dialy_safety_multiplier;
+		insulin_t max_iob;
+
+		explicit profile_variant_t( profile_t const & profile );
+
+		profile_variant_t( ) = delete;
+		~profile_variant_t( ) = default;
+		profile_variant_t( profile_variant_t const & ) = default;
+		profile_variant_t( profile_variant_t && ) = default;
+		profile_variant_t & operator=( profile_variant_t const & ) = default;
+		profile_variant_t & operator=( profile_variant_t && ) = default;
+	};	// profile_variant_t
+
+	/// @brief The inputs shared by every variant in a sweep
+	struct sweep_snapshot_t {
+		glucose_status_t glucose_status;
+		current_temp_t current_temp;
+		iob_data_t iob_data;
+		boost::optional<autosense_data_t> autosense_data;
+		meal_data_t meal_data;
+	};	// sweep_snapshot_t
+
+	struct target_range_t {
+		glucose_t min_bg;
+		glucose_t max_bg;
+	};	// target_range_t
+
+	/// @brief Values to sweep over, every combination is a variant.  An empty
+	/// list keeps the base profile's value
+	struct sweep_grid_t {
+		std::vector<target_range_t> target_ranges;
+		std::vector<double> autosens_min;
+		std::vector<double> autosens_max;
+		std::vector<double> current_basal_safety_multiplier;
+
+		/// @brief Number of variants
+		size_t size( ) const noexcept;
+
+		/// @brief The variant at index, target_ranges varies slowest and
+		/// current_basal_safety_multiplier fastest.  Setting a target range
+		/// clears target_bg so the target is the middle of the range
+		profile_variant_t variant( profile_variant_t const & base, size_t index ) const;
+	};	// sweep_grid_t
+
+	struct sweep_result_t {
+		size_t index;	// of the variant in the grid
+		boost::optional<insulin_t> rate;	// none when no temp is requested
+		std::chrono::minutes duration;
+		glucose_t min_bg;	// the targets determine_basal used after the autosens adjustment, 0 when it stopped before them
+		glucose_t max_bg;
+		glucose_t target_bg;
+		reason_event_t last_reason;
+		uint8_t reason_count;
+		bool failed;	// determine_basal threw a determine_basal_exception
+	};	// sweep_result_t
+
+	/// @brief Receives a block of finished results, blocks arrive in the order they finish.  Calls are serialized
+	using sweep_callback_t = std::function<void( sweep_result_t const * results, size_t count )>;
+
+	/// @brief Run determine_basal for every variant in grid against the same snapshot on threads threads,
+	/// 0 uses every core.  Variants are handed out block_size at a time, 0 picks a size that gives each
+	/// thread several blocks.  Temps are limited to max_safe_basal of the variant and the autosens ratio
+	/// to the variant's autosens_min/autosens_max
+	void sweep_determine_basal( sweep_snapshot_t const & snapshot, profile_variant_t const & base, sweep_grid_t const & grid, sweep_callback_t const & on_results, size_t threads = 0, size_t block_size = 0 );
+
+	/// @brief As above with the results collected in index order
+	std::vector<sweep_result_t> sweep_determine_basal( sweep_snapshot_t const & snapshot, profile_variant_t const & base, sweep_grid_t const & grid, size_t threads = 0, size_t block_size = 0 );
+}    // namespace ns
@@ -0,0 +1,78 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016 Darrell Wright
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "iob_calc.h"
+
+namespace ns {
+	/// @brief Doses stored as columns, one set per insulin curve.  Amounts are float and times are minutes since
+	/// the epoch, 8 bytes a dose against 24 for ns::dose.  Each curve's doses are kept sorted by time so expired
+	/// doses are erased from the front.  The columns grow by an eighth at a time and are trimmed when they hold
+	/// more than a quarter spare, so the allocation stays under half of a std::vector<ns::dose>
+	class dose_store {
+	public:
+		using timestamp_t = std::chrono::system_clock::time_point;
+
+	private:
+		struct columns_t {
+			std::vector<float> amounts;
+			std::vector<int32_t> times;	// minutes since epoch
+
+			columns_t( );
+			size_t size( ) const noexcept;
+			void reserve_for_one( );
+		};	// columns_t
+
+		std::array<columns_t, 5> m_curves;
+
+	public:
+		dose_store( );
+		~dose_store( ) = default;
+		dose_store( dose_store const & ) = default;
+		dose_store( dose_store && ) = default;
+		dose_store & operator=( dose_store const & ) = default;
+		dose_store & operator=( dose_store && ) = default;
+
+		/// @brief Add a dose.  Doses given in time order are appended
+		void push_back( dose const & item );
+
+		/// @brief Drop the doses that are no longer on board at now
+		void expire( timestamp_t const & now );
+
+		/// @brief IOB and activity at now, future doses are fully on board
+		iob_activity_t on_board( timestamp_t const & now ) const;
+
+		size_t size( ) const noexcept;
+		size_t size( insulin_duration_t const duration ) const noexcept;
+		bool empty( ) const noexcept;
+
+		/// @brief Bytes allocated for the stored doses, including spare capacity
+		size_t memory_used( ) const noexcept;
+	};	// dose_store
+}	// namespace ns
@@ -0,0 +1,121 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016 Darrell Wright
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <boost/iostreams/device/mapped_file.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "data_types.h"
+#include "lib_iob_history.h"
+
+namespace ns {
+	/// On disk pump history.  <path> holds a header and fixed size records sorted by time, <path>.idx holds the
+	/// time of every index_stride'th record.  Readers map both files and answer time range queries with pointers
+	/// into the mapping
+	namespace history_archive {
+		struct record_t {
+			int64_t time_ms;	// since epoch, UTC
+			double value;	// Bolus amount or TempBasal rate
+			int32_t duration_min;	// TempBasalDuration
+			uint8_t type;	// lib::iob::pump_history_types
+			uint8_t temp_type;	// lib::iob::pump_temp_basal_types
+			uint8_t reserved[2];
+
+			static record_t from_history( lib::iob::pump_history_t const & item );
+			lib::iob::pump_history_t to_history( ) const;
+			timestamp_t timestamp( ) const;
+		};	// record_t
+
+		struct header_t {
+			char magic[8];
+			uint32_t version;
+			uint32_t record_size;
+			uint32_t index_stride;
+			uint32_t reserved;
+			uint64_t count;
+		};	// header_t
+
+		constexpr uint32_t const current_version = 1;
+		constexpr uint32_t const default_index_stride = 256;
+
+		/// @brief Records in [first, last) of a mapped archive
+		struct range_t {
+			record_t const * first;
+			record_t const * last;
+
+			record_t const * begin( ) const noexcept;
+			record_t const * end( ) const noexcept;
+			size_t size( ) const noexcept;
+			bool empty( ) const noexcept;
+		};	// range_t
+
+		/// @brief Appends records to an archive, creating it if needed
+		class writer {
+			std::string m_path;
+			std::fstream m_records;
+			std::fstream m_index;
+			header_t m_header;
+			int64_t m_last_time_ms;
+
+		public:
+			explicit writer( std::string path, uint32_t const index_stride = default_index_stride );
+			~writer( ) = default;
+			writer( writer const & ) = delete;
+			writer( writer && ) = default;
+			writer & operator=( writer const & ) = delete;
+			writer & operator=( writer && ) = default;
+
+			/// @brief Append records sorted by time, none may be older than the newest in the archive
+			void append( lib::iob::pump_history_t const * items, size_t const count );
+			void append( std::vector<lib::iob::pump_history_t> const & items );
+			void flush( );
+
+			size_t size( ) const noexcept;
+			/// @brief Time of the newest record, only valid when size( ) > 0
+			timestamp_t newest( ) const;
+		};	// writer
+
+		/// @brief Read only view of an archive.  Records appended after it was opened are not visible
+		class reader {
+			boost::iostreams::mapped_file_source m_records;
+			boost::iostreams::mapped_file_source m_index;
+			header_t m_header;
+
+			record_t const * records( ) const noexcept;
+			int64_t const * index( ) const noexcept;
+			size_t index_size( ) const noexcept;
+
+		public:
+			explicit reader( std::string const & path );
+
+			/// @brief Records with t0 <= time < t1.  Touches the index and one block of records
+			range_t range( timestamp_t const & t0, timestamp_t const & t1 ) const;
+			range_t all( ) const noexcept;
+			size_t size( ) const noexcept;
+		};	// reader
+	}	// namespace history_archive
+}    // namespace ns
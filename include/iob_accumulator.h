@@ -0,0 +1,89 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016 Darrell Wright
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+#include "iob_calc.h"
+#include "iob_infusion.h"
+
+namespace ns {
+	/// @brief Running IOB and activity of a set of doses.  Doses are bucketed by the minute they were given
+	/// into one ring per curve that is as long as the curve, so expired doses fall out of the rings on their
+	/// own.  Buckets old enough to be on the polynomial part of their curve are also summed as powers of their
+	/// minute, so advancing time only touches the buckets that expire or reach that part.  Infusions are kept
+	/// as segments and evaluated from the integral of the curve
+	class iob_accumulator {
+	public:
+		using timestamp_t = std::chrono::system_clock::time_point;
+
+	private:
+		struct curve_buckets_t {
+			std::vector<double> amounts;	// slot is minute % duration
+			size_t active;	// number of non-empty slots
+			std::array<double, 5> moments;	// sum of amount * (minute - m_origin)^k over the polynomial part
+
+			explicit curve_buckets_t( size_t const duration );
+		};	// curve_buckets_t
+
+		std::array<curve_buckets_t, 5> m_curves;
+		std::vector<dose> m_pending;	// doses in the future sorted by time, fully on board
+		std::vector<infusion> m_infusions;
+		intmax_t m_now;	// minutes since epoch
+		intmax_t m_origin;	// minute the moments are taken about, kept within a curve of m_now
+		double m_pending_iob;
+		iob_activity_t m_totals;
+
+		void rebase( );
+		void update_totals( );
+
+	public:
+		explicit iob_accumulator( timestamp_t now = std::chrono::system_clock::now( ) );
+		~iob_accumulator( ) = default;
+		iob_accumulator( iob_accumulator const & ) = default;
+		iob_accumulator( iob_accumulator && ) = default;
+		iob_accumulator & operator=( iob_accumulator const & ) = default;
+		iob_accumulator & operator=( iob_accumulator && ) = default;
+
+		void add( dose const & item );
+
+		/// @brief Add a segment.  A segment continuing the last one at the same rate and DIA extends it
+		void add( infusion const & item );
+
+		/// @brief Move the accumulator to now.  Time can only move forward
+		void advance( timestamp_t now );
+
+		timestamp_t now( ) const;
+		double iob( ) const noexcept;
+		double activity( ) const noexcept;
+		iob_activity_t const & on_board( ) const noexcept;
+
+		/// @brief Number of minute buckets holding insulin plus pending future doses and infusion segments
+		size_t size( ) const noexcept;
+		bool empty( ) const noexcept;
+	};	// iob_accumulator
+}	// namespace ns
+
@@ -0,0 +1,74 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016 Darrell Wright
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <vector>
+
+#include "data_types.h"
+#include "lib_iob_history.h"
+#include "lib_iob_total.h"
+#include "tz_cache.h"
+
+namespace ns {
+	namespace lib {
+		namespace iob {
+			/// @brief iob_total fields at start + n*step for n in [0, size( ))
+			struct backfill_t {
+				timestamp_t start;
+				std::chrono::minutes step;
+				std::vector<insulin_t> iob;
+				std::vector<insulin_t> activity;
+				std::vector<insulin_t> bolussnooze;
+				std::vector<insulin_t> basaliob;
+				std::vector<insulin_t> netbasalinsulin;
+				std::vector<insulin_t> hightempinsulin;
+
+				backfill_t( timestamp_t start_time, std::chrono::minutes step_size, size_t const count );
+
+				backfill_t( ) = delete;
+				~backfill_t( ) = default;
+				backfill_t( backfill_t const & ) = default;
+				backfill_t( backfill_t && ) = default;
+				backfill_t & operator=( backfill_t const & ) = default;
+				backfill_t & operator=( backfill_t && ) = default;
+
+				size_t size( ) const noexcept;
+				timestamp_t time_at( size_t const n ) const;
+			};	// backfill_t
+
+			/// @brief Treatments for iob_total from calc_temp_treatments.  Net basal is given as 0.05U boluses, negative
+			/// below the schedule, spread evenly over each piece.  Sorted by date
+			std::vector<iob_treatment_t> iob_treatments( temp_treatments_t const & treatments );
+
+			/// @brief iob_total over [start, end) every step from pump history in any order.  The range is cut into
+			/// days that are worked on in parallel, each from only the history that can reach it: dia plus the
+			/// longest temp before it, and the longest temp after so temps are cut short the same way.  The result
+			/// is the same for any number of threads
+			/// @param dia insulin action in hours
+			/// @param threads workers to use, 0 for one per core
+			backfill_t backfill_iob( pump_history_t const * pump_history, size_t const count, std::vector<basal_profile_entry_t> const & basal_profile, tz_cache_t const & tz, double const dia, profile_t const & profile, timestamp_t const & start, timestamp_t const & end, std::chrono::minutes const step = std::chrono::minutes{ 5 }, size_t threads = 0 );
+		}	// namespace iob
+	}	// namespace lib
+}    // namespace ns
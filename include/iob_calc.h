@@ -120,6 +120,35 @@ namespace ns {
 	enum class insulin_duration_t: int16_t { t180 = 180, t210 = 210, t240 = 240, t300 = 300, t360 = 360 };
 	double insulin_on_board_pct( double const time_from_bolus_min, insulin_duration_t const insulin_duration );
 
+	/// @brief Evaluate insulin_on_board_pct for count doses at once.  Uses AVX2/SSE2 lanes when available
+	/// @param time_from_bolus_min age of each dose in minutes
+	/// @param insulin_duration curve of each dose
+	/// @param results output, count values
+	void insulin_on_board_pct( double const * time_from_bolus_min, insulin_duration_t const * insulin_duration, double * results, size_t const count );
+
+	/// @brief Sum of amount * insulin_on_board_pct over count doses
+	double insulin_on_board( double const * amounts, double const * time_from_bolus_min, insulin_duration_t const * insulin_duration, size_t const count );
+
+	struct iob_activity_t {
+		double iob;	// insulin on board, fraction of dose or units when summed
+		double activity;	// insulin absorbed per minute, the negated derivative of iob
+
+		iob_activity_t & operator+=( iob_activity_t const & rhs ) noexcept {
+			iob += rhs.iob;
+			activity += rhs.activity;
+			return *this;
+		}
+	};	// iob_activity_t
+
+	/// @brief Fraction of a dose on board and the fraction absorbed per minute, evaluated from the same polynomial
+	iob_activity_t insulin_on_board_activity_pct( double const time_from_bolus_min, insulin_duration_t const insulin_duration );
+
+	/// @brief Batch form of insulin_on_board_activity_pct, results are written to iob_results and activity_results
+	void insulin_on_board_activity_pct( double const * time_from_bolus_min, insulin_duration_t const * insulin_duration, double * iob_results, double * activity_results, size_t const count );
+
+	/// @brief Sum of amount * insulin_on_board_activity_pct over count doses
+	iob_activity_t insulin_on_board_activity( double const * amounts, double const * time_from_bolus_min, insulin_duration_t const * insulin_duration, size_t const count );
+
 	struct dose {
 		using timestamp_t = std::chrono::system_clock::time_point;
 		double amount;	// Amount of insulin
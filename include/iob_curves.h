@@ -0,0 +1,65 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016 Darrell Wright
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+//
+// Walsh IOB curve coefficients shared by the polynomial and table engines.
+// Adapted from algorithm found at https://raw.githubusercontent.com/Perceptus/iob/master/insulin_on_board_pct.js
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "iob_calc.h"
+
+namespace ns {
+	namespace impl {
+		/// Walsh curve polynomial coefficients, coefficients[power][slot] where slot = (duration - 180)/30.
+		/// Slots 3 and 5 have no curve.  The layout lets the vector kernels gather a whole power at once
+		constexpr double coefficients[5][7] = {
+			{  99.951000000,  99.924242424,  99.950000000, 0.0,  99.300000000, 0.0,  99.700000000 },
+			{   0.092550000,   0.282046657,  -0.090860000, 0.0,   0.044900000, 0.0,   0.063650000 },
+			{  -0.017590000,  -0.014898990,  -0.005510000, 0.0,  -0.005550000, 0.0,  -0.004095000 },
+			{   0.000135400,   0.000087168,   0.000025300, 0.0,   0.000023200, 0.0,   0.000014130 },
+			{  -0.00000032030, -0.00000015900, -0.00000003310, 0.0, -0.00000002950, 0.0, -0.00000001493 }
+		};
+
+		constexpr insulin_duration_t insulin_durations[5] = { insulin_duration_t::t180, insulin_duration_t::t210, insulin_duration_t::t240, insulin_duration_t::t300, insulin_duration_t::t360 };
+
+		constexpr size_t insulin_duration_to_slot( insulin_duration_t const duration ) {
+			return static_cast<size_t>((static_cast<int16_t>(duration) - 180)/30);
+		}
+
+		/// @brief Position of the curve in insulin_durations
+		constexpr size_t insulin_duration_to_index( insulin_duration_t const duration ) {
+			return insulin_duration_to_slot( duration ) < 3 ? insulin_duration_to_slot( duration ) : (insulin_duration_to_slot( duration )/2 + 1);
+		}
+
+		/// @brief Clamped curve value without the special cases at age <= 0 and age >= duration
+		constexpr double walsh_pct( double const time_from_bolus_min, size_t const slot ) {
+			auto const & t = time_from_bolus_min;
+			auto const percentage = ((((coefficients[4][slot] * t + coefficients[3][slot]) * t + coefficients[2][slot]) * t + coefficients[1][slot]) * t + coefficients[0][slot])/100.0;
+			return percentage > 1.0 ? 1.0 : (percentage < 0.0 ? 0.0 : percentage);
+		}
+	}	// namespace impl
+}	// namespace ns
+
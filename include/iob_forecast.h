@@ -0,0 +1,59 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016 Darrell Wright
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <vector>
+
+#include "iob_calc.h"
+#include "iob_infusion.h"
+
+namespace ns {
+	/// @brief IOB and activity at start + n*step for n in [0, size( ))
+	struct iob_forecast_t {
+		using timestamp_t = std::chrono::system_clock::time_point;
+		timestamp_t start;
+		std::chrono::minutes step;
+		std::vector<double> iob;
+		std::vector<double> activity;
+
+		iob_forecast_t( timestamp_t start_time, std::chrono::minutes step_size, size_t const count );
+
+		iob_forecast_t( ) = delete;
+		~iob_forecast_t( ) = default;
+		iob_forecast_t( iob_forecast_t const & ) = default;
+		iob_forecast_t( iob_forecast_t && ) = default;
+		iob_forecast_t & operator=( iob_forecast_t const & ) = default;
+		iob_forecast_t & operator=( iob_forecast_t && ) = default;
+
+		size_t size( ) const noexcept;
+		timestamp_t time_at( size_t const n ) const;
+	};	// iob_forecast_t
+
+	/// @brief Forecast IOB and activity over horizon/step points starting at start.  Each dose is evaluated over
+	/// the points it is active for in one batch, future doses are fully on board until given
+	iob_forecast_t forecast_iob( dose const * doses, size_t const dose_count, infusion const * infusions, size_t const infusion_count, iob_forecast_t::timestamp_t const & start, std::chrono::minutes const horizon, std::chrono::minutes const step = std::chrono::minutes{ 5 } );
+
+	iob_forecast_t forecast_iob( std::vector<dose> const & doses, std::vector<infusion> const & infusions, iob_forecast_t::timestamp_t const & start, std::chrono::minutes const horizon, std::chrono::minutes const step = std::chrono::minutes{ 5 } );
+}	// namespace ns
@@ -0,0 +1,61 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016 Darrell Wright
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <chrono>
+
+#include "iob_calc.h"
+
+namespace ns {
+	/// @brief Insulin delivered at a constant rate over [start, end), e.g. a basal or temp basal segment
+	struct infusion {
+		using timestamp_t = std::chrono::system_clock::time_point;
+		double rate;	// U/hr
+		timestamp_t start;
+		timestamp_t end;
+		insulin_duration_t dose_dia;
+
+		infusion( double rate_per_hr, timestamp_t start_time, timestamp_t end_time, insulin_duration_t dia = insulin_duration_t::t240 );
+
+		infusion( ) = delete;
+		~infusion( ) = default;
+		infusion( infusion const & ) = default;
+		infusion( infusion && ) = default;
+		infusion & operator=( infusion const & ) = default;
+		infusion & operator=( infusion && ) = default;
+
+		/// @brief Total insulin in the segment
+		double amount( ) const;
+
+		/// @brief Time at which the last insulin of the segment is no longer on board
+		timestamp_t expires( ) const;
+	};	// infusion
+
+	/// @brief Integral of insulin_on_board_pct over ages [from_age_min, to_age_min], in minutes.  Ages outside
+	/// [0, duration] contribute nothing
+	double insulin_on_board_pct_integral( double from_age_min, double to_age_min, insulin_duration_t const insulin_duration );
+
+	/// @brief IOB and activity at now of the insulin the segment has delivered by now.  Evaluated from the
+	/// integral of the curve, so the cost does not depend on the length of the segment
+	iob_activity_t insulin_on_board_activity( infusion const & item, infusion::timestamp_t const & now );
+}	// namespace ns
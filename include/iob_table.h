@@ -0,0 +1,45 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016 Darrell Wright
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "iob_calc.h"
+
+namespace ns {
+	/// Per-minute lookup tables of the Walsh IOB curves, built at compile time.  Fractional ages are
+	/// linearly interpolated.  Same interface as the polynomial functions in iob_calc.h
+	namespace iob_table {
+		double insulin_on_board_pct( double const time_from_bolus_min, insulin_duration_t const insulin_duration );
+		void insulin_on_board_pct( double const * time_from_bolus_min, insulin_duration_t const * insulin_duration, double * results, size_t const count );
+		double insulin_on_board( double const * amounts, double const * time_from_bolus_min, insulin_duration_t const * insulin_duration, size_t const count );
+
+		/// @brief Curve value at a whole minute age, no interpolation
+		double insulin_on_board_pct_minutes( intmax_t const time_from_bolus_min, insulin_duration_t const insulin_duration );
+
+		/// @brief Size of all tables in bytes
+		size_t table_size( );
+	}	// namespace iob_table
+}	// namespace ns
+
@@ -0,0 +1,46 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016 Darrell Wright
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <vector>
+
+#include "iob_calc.h"
+#include "iob_forecast.h"
+#include "iob_infusion.h"
+
+namespace ns {
+	/// @brief IOB and activity at start + n*step over a past range
+	using iob_timeline_t = iob_forecast_t;
+
+	enum class convolution_method_t { automatic, direct, fft };
+
+	/// @brief IOB and activity at every step of [start, end].  Treatments are binned onto the grid, a dose at the
+	/// first point at or after it was given and an infusion by how much it delivered in each step, and each curve's
+	/// bins are convolved with the curve sampled, or for infusions averaged, over the step.  Doses that are not on
+	/// the grid are off by up to a step in age.  automatic picks direct convolution or FFT by the cost of each
+	iob_timeline_t iob_timeline( dose const * doses, size_t const dose_count, infusion const * infusions, size_t const infusion_count, iob_timeline_t::timestamp_t const & start, iob_timeline_t::timestamp_t const & end, std::chrono::minutes const step = std::chrono::minutes{ 5 }, convolution_method_t const method = convolution_method_t::automatic );
+
+	iob_timeline_t iob_timeline( std::vector<dose> const & doses, std::vector<infusion> const & infusions, iob_timeline_t::timestamp_t const & start, iob_timeline_t::timestamp_t const & end, std::chrono::minutes const step = std::chrono::minutes{ 5 }, convolution_method_t const method = convolution_method_t::automatic );
+}	// namespace ns
@@ -23,6 +23,7 @@
 #pragma once
 
 #include <boost/optional.hpp>
+#include <chrono>
 #include <date/date.h>
 
 #include "data_types.h"
@@ -38,31 +39,51 @@ namespace ns {
 				iob_calc_t( ) noexcept = default;
 			};	// iob_calc_t
 
-			template<typename treatment_t, typename dia_t>
-			iob_calc_t iobCalc( treatment_t const & treatment, dia_t const & dia ) {
-				auto const diaratio = 3.0 / dia;
-				auto const peak = 75;
-				auto const end = 180;
+			template<typename T>
+			constexpr T sqr( T const & value ) {
+				return value * value;
+			}
+
+			/// @brief The parts of the curve that only depend on dia, computed once per evaluation instead of per treatment
+			struct iob_curve_t {
+				static constexpr double peak = 75;
+				static constexpr double end = 180;
+				double dia;
+				double diaratio;
+				double activity_rise;	// 2.0 / dia / 60.0 / peak
+				double activity_peak;	// 2.0 / dia / 60.0
+				double activity_fall;	// 2.0 / dia / 60.0 / (60.0 * dia - peak)
+
+				template<typename dia_t>
+				explicit constexpr iob_curve_t( dia_t const & Dia ):
+						dia{ static_cast<double>(Dia) },
+						diaratio{ 3.0 / static_cast<double>(Dia) },
+						activity_rise{ 2.0 / static_cast<double>(Dia) / 60.0 / peak },
+						activity_peak{ 2.0 / static_cast<double>(Dia) / 60.0 },
+						activity_fall{ 2.0 / static_cast<double>(Dia) / 60.0 / (60.0 * static_cast<double>(Dia) - peak) } { }
+			};	// iob_curve_t
 
+			template<typename treatment_t>
+			iob_calc_t iobCalc( treatment_t const & treatment, timestamp_t const & now, iob_curve_t const & curve ) {
 				if( treatment.insulin ) {
 					using namespace std::chrono;
-					auto const minAgo = diaratio * duration_cast<minutes>(system_clock::now( ) - treatment.date).count( );
+					auto const minAgo = curve.diaratio * duration_cast<minutes>(now - treatment.date).count( );
 
 					/*
 					 * these magic numbers are the result of an excel curve fit to find the insulin activity curve that would result in activity rising linearly 
 					 * from 0 to a peak at 75m and then back to 0 again at DIA. The 75m was for either 3h or 4h DIA, and then that is scaled together with DIA when 
 					 * that changes.
 					 */
-					if( minAgo < peak ) {
+					if( minAgo < iob_curve_t::peak ) {
 						auto const x = minAgo/5.0 + 1.0;
 						insulin_t iobContrib = treatment.insulin * (1.0 - 0.001852 * sqr( x ) + 0.001852 * x);
-						insulin_t activityContrib = treatment.insulin * (2.0 / dia / 60.0 / peak ) * minAgo;
+						insulin_t activityContrib = treatment.insulin * curve.activity_rise * minAgo;
 
 						return { {std::move( iobContrib )}, {std::move( activityContrib )} };
-					} else if( minAgo < end ) {
-						auto const y = (minAgo-peak)/5.0;
+					} else if( minAgo < iob_curve_t::end ) {
+						auto const y = (minAgo-iob_curve_t::peak)/5.0;
 						insulin_t iobContrib = treatment.insulin  * (0.001323 * sqr( y ) - 0.054233 * y + 0.55556);
-						insulin_t activityContrib = treatment.insulin * (2.0 / dia / 60.0 - (minAgo - peak) * 2.0 / dia / 60.0 / (60.0 * dia - peak)); 
+						insulin_t activityContrib = treatment.insulin * (curve.activity_peak - (minAgo - iob_curve_t::peak) * curve.activity_fall); 
 
 						return { {std::move( iobContrib )}, {std::move( activityContrib )} };
 					}
@@ -70,6 +91,36 @@ namespace ns {
 
 				return { };
 			}
+
+			/// @brief Contribution of treatment at now
+			template<typename treatment_t, typename dia_t>
+			iob_calc_t iobCalc( treatment_t const & treatment, timestamp_t const & now, dia_t const & dia ) {
+				return iobCalc( treatment, now, iob_curve_t{ dia } );
+			}
+
+			template<typename treatment_t, typename dia_t>
+			iob_calc_t iobCalc( treatment_t const & treatment, dia_t const & dia ) {
+				return iobCalc( treatment, std::chrono::system_clock::now( ), dia );
+			}
+
+			/// @brief Sum of the contributions of the treatments in [first, last) at now.  Treatments that do not
+			/// contribute add nothing, the sums are 0 when none do
+			template<typename Iterator, typename dia_t>
+			iob_calc_t iobCalc( Iterator first, Iterator const last, timestamp_t const & now, dia_t const & dia ) {
+				iob_curve_t const curve{ dia };
+				insulin_t iob = 0;
+				insulin_t activity = 0;
+				for( ; first != last; ++first ) {
+					auto const contrib = iobCalc( *first, now, curve );
+					if( contrib.iobContrib ) {
+						iob += *contrib.iobContrib;
+					}
+					if( contrib.activityContrib ) {
+						activity += *contrib.activityContrib;
+					}
+				}
+				return { {iob}, {activity} };
+			}
 		}	// namespace iob
 	}	// namespace lib
 }    // namespace ns
@@ -22,21 +22,25 @@
 
 #pragma once
 
-#include <date/date.h>
+#include <chrono>
 #include <cstdint>
+#include <date/date.h>
+#include <vector>
+
+#include "data_types.h"
+#include "tz_cache.h"
 
 namespace ns {
 	namespace lib {
 		namespace iob {
-			auto local_tz( ) {
+			/// @brief Offset of the local time zone from UTC now
+			inline std::chrono::seconds local_tz( ) {
 				using namespace date;
 				using namespace std::chrono;
-				auto const zone = current_zone( );
-				auto const now = floor<milliseconds>( system_clock::now( ) );
-				auto const local = zone->to_local( now );
-
-				return local.second;
+				auto const now = floor<seconds>( system_clock::now( ) );
+				return local_zone( )->get_info( now ).offset;
 			}
+
 			struct temp_bolus_t {
 				timestamp_t timestamp{};
 				insulin_t insulin{};
@@ -51,34 +55,62 @@ namespace ns {
 			enum class pump_history_types { Bolus, TempBasal, TempBasalDuration };
 			enum class pump_temp_basal_types { Percentage, Absolute };
 
+			struct pump_history_t {
+				pump_history_types type;
+				timestamp_t timestamp;
+				insulin_t amount;	// Bolus
+				insulin_t rate;	// TempBasal, U/hr
+				pump_temp_basal_types temp_type;	// TempBasal
+				std::chrono::minutes duration;	// TempBasalDuration
+			};	// pump_history_t
+
+			/// @brief Scheduled basal rate from start minutes after local midnight until the next entry
+			struct basal_profile_entry_t {
+				std::chrono::minutes start;
+				insulin_t rate;	// U/hr
+			};	// basal_profile_entry_t
+
+			struct temp_basal_t {
+				timestamp_t start;
+				timestamp_t end;
+				insulin_t rate;	// U/hr
+			};	// temp_basal_t
+
+			/// @brief Part of a temp basal under a single scheduled rate
+			struct net_basal_t {
+				timestamp_t start;
+				timestamp_t end;
+				insulin_t rate;	// U/hr
+				insulin_t scheduled_rate;	// U/hr
+
+				insulin_t net_rate( ) const noexcept;
+				/// @brief Insulin above (or below when negative) the schedule
+				insulin_t net_insulin( ) const;
+			};	// net_basal_t
+
+			struct temp_treatments_t {
+				std::vector<temp_bolus_t> boluses;
+				std::vector<temp_basal_t> temp_basals;	// sorted by start, not overlapping
+				std::vector<net_basal_t> net_basals;	// sorted by start
+			};	// temp_treatments_t
+
+			/// @brief Split temp at the scheduled basal changes, wrapping at local midnight, appending the pieces to out
+			/// @return number of pieces added
+			size_t split_temp_basal( temp_basal_t const & temp, std::vector<basal_profile_entry_t> const & basal_profile, tz_cache_t const & tz, std::vector<net_basal_t> & out );
+			size_t split_temp_basal( temp_basal_t const & temp, std::vector<basal_profile_entry_t> const & basal_profile, std::chrono::seconds const tz_offset, std::vector<net_basal_t> & out );
+
+			/// @brief Rebuild boluses and temp basals from pump history in one pass.  TempBasal records are paired with
+			/// the TempBasalDuration next to them with the same timestamp, percentage temps are skipped.  A temp is cut
+			/// short by the next one, and is split at the scheduled basal changes into net basal pieces
+			/// @param tz the pump's local time zone, which the basal profile is in
+			temp_treatments_t calc_temp_treatments( pump_history_t const * pump_history, size_t const count, std::vector<basal_profile_entry_t> const & basal_profile, tz_cache_t const & tz );
+			/// @param tz_offset offset of the pump's local time from UTC, fixed across the history
+			temp_treatments_t calc_temp_treatments( pump_history_t const * pump_history, size_t const count, std::vector<basal_profile_entry_t> const & basal_profile, std::chrono::seconds const tz_offset );
+
 			template<typename Inputs>
-			auto calc_temp_treatments( Inputs const & inputs ) {
-				auto const & pump_history = inputs.history;
-				auto const & profile_data = inputs.profile;
-				auto const tz = local_tz( );
-				std::vector<temp_bolus_t> temp_boluses;
-
-				for( index_t i=0; i<pump_history.size( ); ++i ) {
-					auto const & current = pump_history[i];
-					switch( current.type ) {
-					case pump_history_types::Bolus:
-						temp_boluses.emplace_back( current.timestamp, current.amount );
-						break;
-					case pump_history_types::Basal:
-						if( current.temp_type == pump_temp_basal_types::Percentage ) {
-							continue;
-						}
-						auto const & rate = current.rate;
-						auto const & date = current.date;
-						boost::optional<duration_t> duration;
-						if( i != 0 && pump_history[i-1].data == current.date && pump_history[i-1].type == pump_history_types::TempBasalDuration ) {
-							duration = pump_history[i-1].duration;
-						} else if( i+1 < pump_history.size( ) )
-						break;
-					}
-				}
+			temp_treatments_t calc_temp_treatments( Inputs const & inputs ) {
+				return calc_temp_treatments( inputs.history.data( ), inputs.history.size( ), inputs.profile.basal_profile, tz_cache_t::local( ) );
 			}
 		}	// namespace iob
 	}	// namespace lib
 }    // namespace ns
-
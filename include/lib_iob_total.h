@@ -23,38 +23,96 @@
 #pragma once
 
 #include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <unordered_map>
 
 #include "data_types.h"
 
 namespace ns {
-	auto iob_total( object_t const & opts ) {
-		auto now = std::chrono::system_clock::now( );
-		auto iob_calc = opts( "calculate" );
-		if( !opts.has_member( "treatments" ) ) {
-			return { };
-		}
+	struct iob_treatment_t {
+		timestamp_t date;
+		insulin_t insulin;
+		bool is_bolus;	// rather than a piece of temp basal
+	};	// iob_treatment_t
+
+	/// @brief The values of iob_data_t without the JSON bindings
+	struct iob_totals_t {
+		insulin_t iob;
+		double bolussnooze;
+		insulin_t basaliob;
+		insulin_t activity;
+		insulin_t netbasalinsulin;
+		insulin_t hightempinsulin;
+	};	// iob_totals_t
+
+	/// @brief All the iob_data_t fields at now in a single pass over treatments sorted by date.  Treatments that
+	/// ended their action before now are skipped with a binary search and those after now are ignored.  Boluses of
+	/// 0.1U or more also decay into bolussnooze at dia/bolussnooze_dia_divisor, everything else counts towards
+	/// basaliob, netbasalinsulin and, when positive, hightempinsulin
+	/// @param dia insulin action in hours
+	iob_data_t iob_total( iob_treatment_t const * treatments, size_t const count, double const dia, profile_t const & profile, timestamp_t const & now );
+
+	template<typename Container>
+	iob_data_t iob_total( Container const & treatments, double const dia, profile_t const & profile, timestamp_t const & now ) {
+		return iob_total( treatments.data( ), treatments.size( ), dia, profile, now );
+	}
+
+	/// @brief Memoizes iob_total for the repeated calls of a loop cycle.  Entries are keyed on a hash of the
+	/// treatments that contribute at now, dia, bolussnooze_dia_divisor and now, and the least recently used are
+	/// evicted to stay within the byte budget.  Not thread safe
+	class iob_total_cache {
+		struct key_t {
+			uint64_t treatments_hash;
+			size_t treatment_count;
+			timestamp_t::rep now;
+			double dia;
+			double bolussnooze_dia_divisor;
+
+			bool operator==( key_t const & rhs ) const noexcept;
+		};	// key_t
 
-		auto treatments = [&]( ) -> typename json_t::array_t {
-			auto result = opts( "treatments" );
-			if( !result.is_array( ) ) {
-				throw std::runtime_error( "Expected an array" );
-			}
-			return result.get_array( );
-		}( );
+		struct key_hash_t {
+			size_t operator( )( key_t const & key ) const noexcept;
+		};	// key_hash_t
 
-		auto profile_data = opts( "profile" );
-		insulin_t iob = 0;
-		double bolussnooze = 0;
-		insulin_t basaliob = 0;
-		insulin_t activity = 0;
-		insulin_t netbasalinsulin = 0;
-		insulin_t hightempinsulin = 0;
+		struct entry_t {
+			key_t key;
+			iob_totals_t value;
+		};	// entry_t
 
-		for( auto const & treatment: treatments ) {
-			
+		std::list<entry_t> m_entries;	// most recently used first
+		std::unordered_map<key_t, std::list<entry_t>::iterator, key_hash_t> m_index;
+		size_t m_byte_budget;
+		size_t m_hits;
+		size_t m_misses;
 
+		static size_t entry_size( ) noexcept;
 
+	public:
+		explicit iob_total_cache( size_t const byte_budget = 64*1024 );
+
+		~iob_total_cache( ) = default;
+		iob_total_cache( iob_total_cache const & ) = delete;
+		iob_total_cache( iob_total_cache && ) = default;
+		iob_total_cache & operator=( iob_total_cache const & ) = delete;
+		iob_total_cache & operator=( iob_total_cache && ) = default;
+
+		/// @brief iob_total( treatments, count, dia, profile, now ), from the cache when seen before
+		iob_data_t get( iob_treatment_t const * treatments, size_t const count, double const dia, profile_t const & profile, timestamp_t const & now );
+
+		template<typename Container>
+		iob_data_t get( Container const & treatments, double const dia, profile_t const & profile, timestamp_t const & now ) {
+			return get( treatments.data( ), treatments.size( ), dia, profile, now );
 		}
-	}
-}    // namespace ns
 
+		void clear( );
+		size_t size( ) const noexcept;
+		/// @brief Estimate of the memory held by the entries
+		size_t bytes_used( ) const noexcept;
+		size_t byte_budget( ) const noexcept;
+		size_t hits( ) const noexcept;
+		size_t misses( ) const noexcept;
+	};	// iob_total_cache
+}    // namespace ns
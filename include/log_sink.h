@@ -0,0 +1,215 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016 Darrell Wright
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+// Log calls below this level are removed at compile time, 0 keeps all and 5 removes all
+#ifndef OREF0_LOG_LEVEL
+#define OREF0_LOG_LEVEL 0
+#endif
+
+namespace ns {
+	namespace log {
+		enum class level_t: uint8_t { trace, debug, info, warning, error, off };
+		enum class category_t: uint8_t { core, iob, determine_basal, profile, simulator };
+
+		std::ostream & operator<<( std::ostream & os, level_t level );
+		std::ostream & operator<<( std::ostream & os, category_t category );
+
+		constexpr level_t const compiled_min_level = static_cast<level_t>(OREF0_LOG_LEVEL);
+
+		constexpr uint32_t category_bit( category_t category ) noexcept {
+			return uint32_t{ 1 } << static_cast<uint32_t>(category);
+		}
+
+		constexpr uint32_t const all_categories = ~uint32_t{ 0 };
+		constexpr size_t const max_args = 6;
+
+		/// @brief One log call.  The text is not formatted until the record is
+		/// drained, each {} in format is replaced by the next argument
+		struct log_record_t {
+			std::chrono::system_clock::time_point when;
+			char const * format;	// must be a string literal
+			std::array<double, max_args> args;
+			uint8_t arg_count;
+			level_t level;
+			category_t category;
+		};	// log_record_t
+
+		std::ostream & operator<<( std::ostream & os, log_record_t const & record );
+
+		/// @brief Bounded lock-free queue of records, any thread may push or pop.
+		/// Pushing to a full ring fails instead of waiting
+		class log_ring_t {
+			struct slot_t {
+				std::atomic<size_t> sequence;
+				log_record_t record;
+			};	// slot_t
+
+			std::unique_ptr<slot_t[]> m_slots;
+			size_t m_mask;
+			alignas( 64 ) std::atomic<size_t> m_head;
+			alignas( 64 ) std::atomic<size_t> m_tail;
+		public:
+			/// @brief capacity is rounded up to a power of 2
+			explicit log_ring_t( size_t capacity );
+
+			log_ring_t( ) = delete;
+			~log_ring_t( ) = default;
+			log_ring_t( log_ring_t const & ) = delete;
+			log_ring_t( log_ring_t && ) = delete;
+			log_ring_t & operator=( log_ring_t const & ) = delete;
+			log_ring_t & operator=( log_ring_t && ) = delete;
+
+			size_t capacity( ) const noexcept;
+			bool try_push( log_record_t const & record ) noexcept;
+			bool try_pop( log_record_t & record ) noexcept;
+		};	// log_ring_t
+
+		/// @brief What try_log does when the ring is full
+		enum class overflow_t: uint8_t {
+			drop,	// count the record as dropped and return, the default
+			wait	// wake the drain thread and wait for room, for callers that must not lose lines
+		};
+
+		/// @brief Queues records from any thread and writes them from a
+		/// background thread, logging never waits on the output unless the
+		/// overflow policy is wait and the ring is full
+		class log_sink_t {
+			std::unique_ptr<std::ostream> m_file;
+			std::ostream * m_out;
+			log_ring_t m_ring;
+			std::chrono::milliseconds m_interval;
+			std::atomic<level_t> m_min_level;
+			std::atomic<uint32_t> m_categories;
+			std::atomic<overflow_t> m_overflow;
+			std::atomic<size_t> m_dropped;
+			std::atomic<size_t> m_written;
+			std::mutex m_drain_mutex;
+			std::mutex m_wait_mutex;
+			std::condition_variable m_wait;
+			bool m_stop;
+			std::thread m_thread;
+
+			log_sink_t( std::unique_ptr<std::ostream> file, std::ostream * out, size_t capacity, std::chrono::milliseconds interval );
+			log_sink_t( std::unique_ptr<std::ostream> file, size_t capacity, std::chrono::milliseconds interval );
+
+			void drain( );
+			void run( );
+		public:
+			/// @brief Write to out, which must outlive the sink
+			explicit log_sink_t( std::ostream & out, size_t capacity = 4096, std::chrono::milliseconds interval = std::chrono::milliseconds{ 50 } );
+
+			/// @brief Append to file_name
+			explicit log_sink_t( std::string const & file_name, size_t capacity = 4096, std::chrono::milliseconds interval = std::chrono::milliseconds{ 50 } );
+
+			/// @brief Stops the drain thread after writing what is queued, and uninstalls the sink.  Threads still
+			/// logging must stop before the sink is destroyed
+			~log_sink_t( );
+
+			log_sink_t( ) = delete;
+			log_sink_t( log_sink_t const & ) = delete;
+			log_sink_t( log_sink_t && ) = delete;
+			log_sink_t & operator=( log_sink_t const & ) = delete;
+			log_sink_t & operator=( log_sink_t && ) = delete;
+
+			level_t min_level( ) const noexcept;
+			void min_level( level_t level ) noexcept;
+			uint32_t categories( ) const noexcept;
+			void categories( uint32_t category_mask ) noexcept;
+			bool enabled( level_t level, category_t category ) const noexcept;
+			overflow_t overflow( ) const noexcept;
+			void overflow( overflow_t policy ) noexcept;
+
+			/// @brief Queue a record.  When the ring is full it is false and counted as dropped, or with
+			/// overflow_t::wait the drain thread is woken and the caller waits until there is room
+			bool try_log( log_record_t const & record ) noexcept;
+
+			/// @brief Write everything queued so far from the calling thread
+			void flush( );
+
+			size_t dropped( ) const noexcept;
+			size_t written( ) const noexcept;
+		};	// log_sink_t
+
+		/// @brief Make sink the target of write, nullptr stops logging
+		void install( log_sink_t * sink ) noexcept;
+		log_sink_t * installed( ) noexcept;
+
+		/// @brief Log to the installed sink with a time supplied by the caller,
+		/// such as a simulated clock.  Calls below compiled_min_level compile to
+		/// nothing
+		template<level_t Level, typename... Args>
+		void write_at( std::chrono::system_clock::time_point const & when, category_t category, char const * format, Args const &... args ) noexcept {
+			static_assert( sizeof...(Args) <= max_args, "Too many log arguments" );
+			if( Level < compiled_min_level ) {
+				return;
+			}
+			auto const sink = installed( );
+			if( sink == nullptr || !sink->enabled( Level, category ) ) {
+				return;
+			}
+			sink->try_log( log_record_t{ when, format, { { static_cast<double>(args)... } }, static_cast<uint8_t>(sizeof...(Args)), Level, category } );
+		}
+
+		/// @brief Log to the installed sink at the current time
+		template<level_t Level, typename... Args>
+		void write( category_t category, char const * format, Args const &... args ) noexcept {
+			if( Level < compiled_min_level || installed( ) == nullptr ) {
+				return;
+			}
+			write_at<Level>( std::chrono::system_clock::now( ), category, format, args... );
+		}
+
+		template<typename... Args>
+		void debug( category_t category, char const * format, Args const &... args ) noexcept {
+			write<level_t::debug>( category, format, args... );
+		}
+
+		template<typename... Args>
+		void info( category_t category, char const * format, Args const &... args ) noexcept {
+			write<level_t::info>( category, format, args... );
+		}
+
+		template<typename... Args>
+		void warning( category_t category, char const * format, Args const &... args ) noexcept {
+			write<level_t::warning>( category, format, args... );
+		}
+
+		template<typename... Args>
+		void error( category_t category, char const * format, Args const &... args ) noexcept {
+			write<level_t::error>( category, format, args... );
+		}
+	}	// namespace log
+}    // namespace ns
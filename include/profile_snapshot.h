@@ -0,0 +1,52 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016 Darrell Wright
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <boost/optional.hpp>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "compiled_profile.h"
+#include "tz_cache.h"
+
+namespace ns {
+	/// A compiled profile saved with the content hashes of the files it was built from, so a later run can load it
+	/// instead of parsing them again
+	namespace profile_snapshot {
+		constexpr uint32_t const current_version = 1;
+
+		/// @brief FNV-1a hash of the contents of a file
+		uint64_t file_hash( std::string const & file_name );
+
+		/// @brief Hash each input, in order
+		std::vector<uint64_t> file_hashes( std::vector<std::string> const & file_names );
+
+		/// @brief Write profile and the hashes of its inputs.  The file is replaced atomically
+		void save( std::string const & file_name, compiled_profile_t const & profile, std::vector<uint64_t> const & input_hashes );
+
+		/// @brief The profile in the snapshot if it is readable, of this version and was built from inputs with
+		/// exactly these hashes
+		boost::optional<compiled_profile_t> load( std::string const & file_name, std::vector<uint64_t> const & input_hashes, tz_cache_t tz );
+	}	// namespace profile_snapshot
+}    // namespace ns
@@ -22,20 +22,30 @@
 
 #pragma once
 
+#include <algorithm>
+#include <array>
 #include <boost/optional.hpp>
+#include <cassert>
+#include <chrono>
 #include <cmath>
+#include <iomanip>
+#include <sstream>
 #include <string>
 
+#include "bg_prediction.h"
 #include "data_types.h"
+#include "determine_basal_reason.h"
+#include "iob_forecast.h"
+#include "stage_latency.h"
 
 namespace ns {
-	template<typename T, typename U>
+	template<typename T>
 	constexpr auto round_to( T const & value, double digits ) {
 		auto const scale = pow( 10, digits );
 		return round( value * scale )/scale;
 	}
 
-	std::string to_fixed( double d, int8_t digits ) {
+	inline std::string to_fixed( double d, int8_t digits ) {
 		assert( digits >= 0 );
 		std::stringstream ss;
 		ss << std::fixed << std::setprecision( digits ) << d;
@@ -54,82 +64,220 @@ namespace ns {
 		return expected_delta;
 	}
 
-	constexpr auto convert_bg( glucose_t const & value, profile_t const & profile ) {
-		if( profile.out_units == "mmol/L" ) {
+	inline std::string convert_bg( glucose_t const & value, profile_t const & profile ) {
+		if( profile.out_units && *profile.out_units == "mmol/L" ) {
 			return to_fixed( round_to( static_cast<double>(value) * 0.0555, 1 ), 1 );
 		}
 		return to_fixed( value, 0 );
 	}
 
-
-	template<typename F>
-	auto determine_basal( glucose_status_t const & glucose_status, current_temp_t const & current_temp, iob_data_t & iob_data, profile_t const & profile, boost::optional<autosense_data_t> const & autosense_data, meal_data_t const & meal_data, F temp_basal_functions ) {
-		if( !profile.current_basal ) { 	
-			throw determine_basal_exception( "Could not get current basal rate" );
+	/// @brief The highest temp basal allowed, the lowest of max_basal,
+	/// max_daily_basal and current_basal scaled by their safety multipliers
+	template<typename Profile>
+	boost::optional<insulin_t> max_safe_basal( Profile const & profile ) {
+		boost::optional<insulin_t> result;
+		auto const limit = [&result]( insulin_t const value ) {
+			result = result ? std::min( *result, value ) : value;
+		};
+		if( profile.max_basal ) {
+			limit( *profile.max_basal );
+		}
+		if( profile.max_daily_basal ) {
+			limit( *profile.max_daily_basal * profile.max_dialy_safety_multiplier );
+		}
+		if( profile.current_basal ) {
+			limit( *profile.current_basal * profile.current_basal_safety_multiplier );
 		}
+		return result;
+	}
 
-		auto const basal = [&]( ) = {
-			auto result = *profile.current_basal;
-			if( autosense_data ) {
-				result *= autosense_data->ratio;
-				result = round( basal * 100.0 )/100.0;
-				if( result != *profile.current_basal ) {
-					std::clog << "Adjusting basal from " << *(profile.current_basal) << " to " << basal << '\n';
+	namespace impl {
+		/// @brief The rest of determine_basal, predictions start from the insulin
+		/// activity(U/min) at each 5 minute tick in activity
+		template<typename Profile, typename F>
+		requested_temp_t determine_basal( glucose_status_t const & glucose_status, current_temp_t const & current_temp, iob_data_t const & iob_data, double const * activity, size_t const activity_count, Profile const & profile, boost::optional<autosense_data_t> const & autosense_data, meal_data_t const & meal_data, F temp_basal_functions ) {
+			latency::scoped_timer_t const timer{ latency::stage_t::determine_basal };
+			if( !profile.current_basal ) { 	
+				throw determine_basal_exception( "Could not get current basal rate" );
+			}
+			reason_log_t reasons;
+
+			auto const basal = [&]( ) {
+				auto result = *profile.current_basal;
+				if( autosense_data ) {
+					result *= autosense_data->ratio;
+					result = round( result * 100.0 )/100.0;
+					if( result != *profile.current_basal ) {
+						reasons.add( reason_code_t::basal_adjusted_autosens, *profile.current_basal, result );
+					}
+				}
+				return result;
+			}( );
+
+			auto const bg = glucose_status.glucose;
+			// TODO: figure out how to use raw isig data to estimate BG
+			if( bg < 30 ) {	
+				reasons.add( reason_code_t::cgm_calibrating, bg );
+				if( basal <= current_temp.rate ) {
+					reasons.add( reason_code_t::cgm_calibrating_set_basal, basal );
+					return temp_basal_functions.set_temp_basal( basal, std::chrono::minutes{ 30 }, profile, reasons, current_temp );
 				}
+				reasons.add( reason_code_t::cgm_calibrating_temp_below_basal, current_temp.rate, basal );
+				throw determine_basal_exception( to_string( reasons ) );
 			}
-			return result;
-		}( );
-
-		auto const bg = glucose_status.glucose;
-		// TODO: figure out how to use raw isig data to estimate BG
-		if( bg < 30 ) {	
-			std::stringstream reason;
-			reason << "CGM is calibrating or in ??? state";
-			if( basal <= current_temp.rate ) {
-				reason << "; setting current basal of " << basal << " as temp";
-				return temp_basal_functions.set_temp_basal( basal, 30, profile, reason, current_temp );
+
+			// if target_bg is set, great. otherwise, if min and max are set, then set target to their average
+
+			if( !profile.min_bg || !profile.max_bg ) {
+				throw determine_basal_exception( "Missing min/max glucose numbers" );
 			}
-			reason << ", temp " << current_temp.rate << " <~ current basal " << basal << "U/hr";
-			throw determine_basal_exception( reason.str( ) );
-		}
+			auto min_bg = *profile.min_bg;
+			auto max_bg = *profile.max_bg;
 
-		// if target_bg is set, great. otherwise, if min and max are set, then set target to their average
+			glucose_t target_bg = [&]( ) {
+				if( profile.target_bg ) {
+					return *profile.target_bg;
+				} else {
+					return (min_bg + max_bg)/2;
+				} 
+			}( );
 
-		if( !profile.min_bg || !profile.max_bg ) {
-			throw determine_basal_exception( "Missing min/max glucose numbers" );
-		}
-		auto min_bg = *profile.min_bg;
-		auto max_bg = *profile.max_bg;
-
-		glucose_t const target_bg = [&]( ) {
-			if( profile.target_bg ) {
-				return *profile.target_bg;
-			} else {
-				return (min_bg + max_bg)/2;
-			} 
-		}( );
-
-		
-		// adjust min, max, and target BG for sensitivity, such that 50% increase in ISF raises target from 100 to 120
-		if( autosens_data && profile.autosens_adjust_targets ) {
-			if( profile.temp_target_set ) {
-				std::clog << "Temp target set, not adjusting with autosens\n";
-			} else {
-				auto const & ratio = autosens_data->ratio; 
-				min_bg = round( (min_bg - 60)/ratio ) + 60;
-				min_bg = round( (max_bg - 60)/ratio ) + 60;
-				auto new_target_bg = round( (target_bg - 60)/ratio ) + 60;
-				if( target_bg == new_target_bg ) {
-					std::clog << "target_bg unchanged: " << target_bg << '\n';
+			
+			// adjust min, max, and target BG for sensitivity, such that 50% increase in ISF raises target from 100 to 120
+			if( autosense_data && profile.autosens_adjust_targets ) {
+				if( profile.temp_target_set && *profile.temp_target_set ) {
+					reasons.add( reason_code_t::temp_target_set );
 				} else {
-					std::clog << "Adjusting target_bg from " << target_bg << " to " << new_target_bg << '\n';
+					auto const & ratio = autosense_data->ratio; 
+					min_bg = round( (min_bg - 60)/ratio ) + 60;
+					max_bg = round( (max_bg - 60)/ratio ) + 60;
+					auto new_target_bg = round( (target_bg - 60)/ratio ) + 60;
+					if( target_bg == new_target_bg ) {
+						reasons.add( reason_code_t::target_bg_unchanged, target_bg );
+					} else {
+						reasons.add( reason_code_t::target_bg_adjusted, target_bg, new_target_bg );
+					}
+					target_bg = new_target_bg;
+				}
+			}
+			reasons.add( reason_code_t::bg_targets, min_bg, max_bg, target_bg );
+
+			if( !profile.sens ) {
+				throw determine_basal_exception( "Could not get insulin sensitivity" );
+			}
+			auto const sens = autosense_data ? round_to( *profile.sens / autosense_data->ratio, 1 ) : *profile.sens;
+
+			// how far BG is expected to move from the insulin on board and the current deviation from it
+			auto const min_delta = std::min( glucose_status.delta, glucose_status.avg_delta );
+			auto const bgi = round_to( -iob_data.activity * sens * 5.0, 2 );
+			auto deviation = round( 30.0/5.0 * (min_delta - bgi) );
+			if( deviation < 0 ) {
+				deviation = round( 30.0/5.0 * (glucose_status.avg_delta - bgi) );
+			}
+			auto eventual_bg = round( bg - iob_data.iob * sens ) + deviation;
+
+			// the COB curve is used while there are carbs absorbing, the IOB curve otherwise
+			prediction_inputs_t const inputs{ bg, min_delta, sens, profile.carb_ratio.value_or( 0.0 ), meal_data.meal_cob, std::min( meal_data.slope_from_max_deviation, -meal_data.slope_from_min_deviation/3.0 ) };
+			bg_prediction_engine_t engine{ };
+			auto const predictions = engine.predict( inputs, activity, activity_count );
+			auto const has_carbs = meal_data.meal_cob > 0.0 && predictions.carb_impact > 0.0;
+			auto const & curve = has_carbs ? predictions.cob : predictions.iob;
+			if( has_carbs ) {
+				eventual_bg = std::max( eventual_bg, round( curve.eventual_bg ) );
+			}
+			auto const min_pred_bg = std::max( 39.0, round( curve.min_bg ) );
+			reasons.add( reason_code_t::predicted, eventual_bg, min_pred_bg );
+
+			// the current temp is left running when it is already the basal, as the current temp has no duration to renew
+			auto const set_basal = [&]( ) {
+				if( current_temp.rate == basal ) {
+					reasons.add( reason_code_t::no_decision, current_temp.rate );
+					requested_temp_t result{ };
+					result.reason = reasons;
+					return result;
 				}
-				target_bg = new_target_bg;
+				reasons.add( reason_code_t::set_current_basal, basal );
+				return temp_basal_functions.set_temp_basal( basal, std::chrono::minutes{ 30 }, profile, reasons, current_temp );
+			};
+
+			auto const threshold = min_bg - 0.5*(min_bg - 50);
+			if( bg < threshold || curve.min_guard_bg < threshold ) {
+				reasons.add( reason_code_t::low_glucose_suspend, curve.min_guard_bg, threshold );
+				return temp_basal_functions.set_temp_basal( 0.0, std::chrono::minutes{ 30 }, profile, reasons, current_temp );
+			}
+
+			// profile_t::dia does not carry a value, oref0's default of 3 hours is used
+			auto const expected_delta = calculate_expected_delta( 3.0, target_bg, eventual_bg, bgi );
+			if( eventual_bg < min_bg ) {
+				reasons.add( reason_code_t::eventual_bg_below_min, eventual_bg, min_bg );
+				if( min_delta > expected_delta && min_delta > 0 ) {
+					reasons.add( reason_code_t::eventual_bg_below_min_rising, min_delta, expected_delta );
+					return set_basal( );
+				}
+				auto const insulin_req = 2.0 * std::min( 0.0, (eventual_bg - target_bg)/sens );
+				auto const rate = std::max( 0.0, basal + 2.0*insulin_req );
+				return temp_basal_functions.set_temp_basal( rate, std::chrono::minutes{ 30 }, profile, reasons, current_temp );
+			}
+			if( min_delta < expected_delta ) {
+				reasons.add( reason_code_t::delta_below_expected, min_delta, expected_delta );
+				return set_basal( );
 			}
+			if( eventual_bg < max_bg || min_pred_bg < max_bg ) {
+				reasons.add( reason_code_t::in_range, eventual_bg, min_pred_bg );
+				return set_basal( );
+			}
+
+			// eventual BG is above max_bg
+			if( iob_data.iob > profile.max_iob ) {
+				reasons.add( reason_code_t::iob_above_max, iob_data.iob, profile.max_iob );
+				return set_basal( );
+			}
+			auto insulin_req = round_to( (std::min( min_pred_bg, eventual_bg ) - target_bg)/sens, 2 );
+			if( insulin_req > profile.max_iob - iob_data.iob ) {
+				reasons.add( reason_code_t::insulin_req_limited, insulin_req, profile.max_iob - iob_data.iob );
+				insulin_req = profile.max_iob - iob_data.iob;
+			}
+			auto rate = basal + 2.0*insulin_req;
+			auto const max_safe = max_safe_basal( profile );
+			if( max_safe && rate > *max_safe ) {
+				reasons.add( reason_code_t::rate_above_max_safe, rate, *max_safe );
+				rate = *max_safe;
+			}
+			if( current_temp.rate >= rate ) {
+				reasons.add( reason_code_t::temp_above_required, current_temp.rate, rate );
+				reasons.add( reason_code_t::no_decision, current_temp.rate );
+				requested_temp_t result{ };
+				result.reason = reasons;
+				return result;
+			}
+			return temp_basal_functions.set_temp_basal( rate, std::chrono::minutes{ 30 }, profile, reasons, current_temp );
 		}
+	}	// namespace impl
+
+	/// @brief Decide on a temp basal.  The steps taken are recorded as
+	/// reason events in the result instead of text so the decision itself
+	/// does not allocate, use requested_temp_t::reason_text when outputting.
+	/// Profile is a profile_t or any type with the same members, such as a
+	/// profile_variant_t.
+	/// temp_basal_functions.set_temp_basal( rate, duration, profile, reasons, current_temp )
+	/// must return the requested_temp_t.
+	/// BG is predicted with iob_data's activity held for the whole prediction.
+	/// When the current temp is kept the result has no rate or duration and its
+	/// last reason is reason_code_t::no_decision
+	template<typename Profile, typename F>
+	requested_temp_t determine_basal( glucose_status_t const & glucose_status, current_temp_t const & current_temp, iob_data_t const & iob_data, Profile const & profile, boost::optional<autosense_data_t> const & autosense_data, meal_data_t const & meal_data, F temp_basal_functions ) {
+		std::array<double, bg_prediction_engine_t::max_ticks> activity;
+		activity.fill( iob_data.activity );
+		return impl::determine_basal( glucose_status, current_temp, iob_data, activity.data( ), activity.size( ), profile, autosense_data, meal_data, temp_basal_functions );
+	}
 
-		auto iob_array = iob_data;
-		
-		autot
+	/// @brief As above with BG predicted from the activity in forecast, which
+	/// must have a 5 minute step
+	template<typename Profile, typename F>
+	requested_temp_t determine_basal( glucose_status_t const & glucose_status, current_temp_t const & current_temp, iob_data_t const & iob_data, iob_forecast_t const & forecast, Profile const & profile, boost::optional<autosense_data_t> const & autosense_data, meal_data_t const & meal_data, F temp_basal_functions ) {
+		if( forecast.step != std::chrono::minutes{ 5 } ) {
+			throw determine_basal_exception( "BG predictions require a forecast with a 5 minute step" );
+		}
+		return impl::determine_basal( glucose_status, current_temp, iob_data, forecast.activity.data( ), forecast.size( ), profile, autosense_data, meal_data, temp_basal_functions );
 	}
-}    // namespace ns 
+}    // namespace ns
@@ -25,6 +25,6 @@
 #include "data_types.h"
 
 namespace ns {
-	auto round_basal( double const & basal, profile_t const & profile );
+	double round_basal( double const & basal, profile_t const & profile );
 }    // namespace ns 
 
@@ -0,0 +1,126 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016 Darrell Wright
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <vector>
+
+namespace ns {
+	namespace latency {
+		/// @brief The timed stages of a loop cycle
+		enum class stage_t: uint8_t { profile_load, calc_temp_treatments, iob_total, determine_basal };
+		constexpr size_t const stage_count = 4;
+
+		std::ostream & operator<<( std::ostream & os, stage_t stage );
+
+		/// @brief Log-linear latency histogram in nanoseconds, 32 buckets per
+		/// power of 2 so a recorded value is within ~3% of the one reported.
+		/// One thread records, any thread may read
+		class histogram_t {
+		public:
+			static constexpr size_t const sub_buckets = 32;
+			static constexpr size_t const max_exponent = 40;	// about 18 minutes, longer values are clamped
+			static constexpr size_t const bucket_count = (max_exponent - 4) * sub_buckets;
+		private:
+			std::array<std::atomic<uint64_t>, bucket_count> m_buckets;
+			std::atomic<uint64_t> m_count;
+			std::atomic<uint64_t> m_max;
+		public:
+			histogram_t( ) noexcept;
+			~histogram_t( ) = default;
+			histogram_t( histogram_t const & ) = delete;
+			histogram_t( histogram_t && ) = delete;
+			histogram_t & operator=( histogram_t const & ) = delete;
+			histogram_t & operator=( histogram_t && ) = delete;
+
+			static size_t bucket_index( uint64_t value ) noexcept;
+			/// @brief Largest value that falls in the bucket
+			static uint64_t bucket_value( size_t index ) noexcept;
+
+			/// @brief Only the owning thread may record
+			void record( uint64_t value ) noexcept;
+			void reset( ) noexcept;
+			/// @brief Add other's values, the same single writer rule as record applies
+			void merge( histogram_t const & other ) noexcept;
+
+			uint64_t count( ) const noexcept;
+			uint64_t max( ) const noexcept;
+			uint64_t bucket( size_t index ) const noexcept;
+		};	// histogram_t
+
+		struct stage_summary_t {
+			stage_t stage;
+			uint64_t count;
+			std::chrono::nanoseconds p50;
+			std::chrono::nanoseconds p99;
+			std::chrono::nanoseconds max;
+		};	// stage_summary_t
+
+		/// @brief Add a measurement to the calling thread's histogram for stage.
+		/// The first call on a thread claims a slot of histograms, reusing one a
+		/// finished thread left.  After that recording takes no locks and does
+		/// not allocate.  When the thread exits its values are kept in a retired
+		/// total and the slot is freed
+		void record( stage_t stage, std::chrono::nanoseconds elapsed ) noexcept;
+
+		/// @brief Times its own lifetime on the monotonic clock and records it for stage
+		class scoped_timer_t {
+			stage_t m_stage;
+			std::chrono::steady_clock::time_point m_start;
+		public:
+			explicit scoped_timer_t( stage_t stage ) noexcept;
+			~scoped_timer_t( );
+
+			scoped_timer_t( ) = delete;
+			scoped_timer_t( scoped_timer_t const & ) = delete;
+			scoped_timer_t( scoped_timer_t && ) = delete;
+			scoped_timer_t & operator=( scoped_timer_t const & ) = delete;
+			scoped_timer_t & operator=( scoped_timer_t && ) = delete;
+		};	// scoped_timer_t
+
+		/// @brief Every thread's histograms merged, one entry per stage
+		std::vector<stage_summary_t> summarize( );
+
+		/// @brief Start the histograms over.  Other threads are not written to,
+		/// each clears its own histograms on its next record and is left out of
+		/// summaries until then, so recording may continue during a reset
+		void reset( );
+
+		/// @brief Slots of histograms allocated, at most the number of threads
+		/// that recorded at the same time
+		size_t thread_slots( );
+
+		enum class output_formats { text, json };
+
+		void write( std::ostream & os, output_formats format );
+
+		/// @brief Write the summary to stderr when the process exits.  Also
+		/// enabled by setting OREF0_LATENCY to text or json
+		void write_at_exit( output_formats format );
+	}	// namespace latency
+}    // namespace ns
@@ -0,0 +1,73 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016 Darrell Wright
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <vector>
+
+#include "data_types.h"
+#include "lib_iob_history.h"
+#include "tz_cache.h"
+
+namespace ns {
+	namespace lib {
+		namespace iob {
+			/// @brief Append-only log of pump history with the treatments derived from it.  Records newer than the
+			/// log are folded into the treatments and totals as they arrive.  A record older than the newest one
+			/// already logged rebuilds everything with calc_temp_treatments
+			class treatment_log {
+				std::vector<basal_profile_entry_t> m_basal_profile;
+				tz_cache_t m_tz;
+				std::vector<pump_history_t> m_records;	// sorted by timestamp then type
+				std::vector<pump_history_t> m_unpaired;	// temp halves waiting for the other half
+				temp_treatments_t m_treatments;
+				insulin_t m_bolus_insulin;
+				insulin_t m_net_basal_insulin;
+				size_t m_rebuilds;
+
+				void append( pump_history_t const & record );
+				void append_temp( temp_basal_t const & temp );
+				void rebuild( );
+
+			public:
+				treatment_log( std::vector<basal_profile_entry_t> basal_profile, tz_cache_t tz );
+				treatment_log( std::vector<basal_profile_entry_t> basal_profile, std::chrono::seconds const tz_offset );
+
+				/// @brief Add records in any order, records already logged with the same timestamp and type are skipped
+				/// @return number of records added
+				size_t ingest( pump_history_t const * records, size_t const count );
+				size_t ingest( std::vector<pump_history_t> const & records );
+
+				temp_treatments_t const & treatments( ) const noexcept;
+				insulin_t bolus_insulin( ) const noexcept;
+				/// @brief Sum of the net insulin of every net basal piece
+				insulin_t net_basal_insulin( ) const noexcept;
+
+				size_t size( ) const noexcept;
+				/// @brief Number of times out of order records forced a full rebuild
+				size_t rebuilds( ) const noexcept;
+			};	// treatment_log
+		}	// namespace iob
+	}	// namespace lib
+}    // namespace ns
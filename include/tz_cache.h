@@ -0,0 +1,80 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016 Darrell Wright
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <chrono>
+#include <date/tz.h>
+#include <string>
+#include <vector>
+
+#include "data_types.h"
+
+namespace ns {
+	/// @brief The local time zone, resolved from the tz database on first use only
+	date::time_zone const * local_zone( );
+
+	/// @brief UTC offsets of a time zone over a window of time.  Lookups inside the window are a search of the
+	/// cached transitions, outside it they ask the zone.  A fixed offset or a replayed list of transitions never
+	/// touches the tz database
+	class tz_cache_t {
+	public:
+		struct transition_t {
+			timestamp_t begin;
+			std::chrono::seconds offset;	// local - UTC from begin until the next transition
+		};	// transition_t
+
+	private:
+		date::time_zone const * m_zone;
+		std::vector<transition_t> m_transitions;	// sorted by begin
+		timestamp_t m_end;	// end of the window the transitions cover
+		std::chrono::seconds m_fixed_offset;
+
+	public:
+		explicit tz_cache_t( std::chrono::seconds const fixed_offset );
+		/// @param transitions sorted by begin, the first also applies before its begin and the last forever after
+		explicit tz_cache_t( std::vector<transition_t> transitions );
+		tz_cache_t( date::time_zone const * zone, timestamp_t const & from, timestamp_t const & to );
+		tz_cache_t( std::string const & zone_name, timestamp_t const & from, timestamp_t const & to );
+
+		~tz_cache_t( ) = default;
+		tz_cache_t( tz_cache_t const & ) = default;
+		tz_cache_t( tz_cache_t && ) = default;
+		tz_cache_t & operator=( tz_cache_t const & ) = default;
+		tz_cache_t & operator=( tz_cache_t && ) = default;
+
+		/// @brief The local zone over the couple of days around now that a loop looks at
+		static tz_cache_t local( );
+
+		/// @brief Grow the window to include [from, to), a no-op without a zone
+		void cover( timestamp_t const & from, timestamp_t const & to );
+
+		std::chrono::seconds offset( timestamp_t const & utc ) const;
+		/// @brief Local wall clock time since the local epoch
+		timestamp_t::duration to_local( timestamp_t const & utc ) const;
+		/// @brief UTC time of a local wall clock time.  Times skipped by a transition use the offset before it so
+		/// land after it, times repeated by one resolve to either
+		timestamp_t from_local( timestamp_t::duration const & local ) const;
+
+		std::vector<transition_t> const & transitions( ) const noexcept;
+	};	// tz_cache_t
+}    // namespace ns
@@ -0,0 +1,180 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016 Darrell Wright
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <algorithm>
+#include <chrono>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <daw/json/daw_json_link.h>
+
+#include "basal_schedule.h"
+#include "data_types.h"
+#include "lib_iob_history.h"
+#include "tz_cache.h"
+
+namespace ns {
+	namespace lib {
+		namespace iob {
+			namespace {
+				using namespace std::chrono;
+				constexpr size_t const minutes_per_day = 24*60;
+
+				struct basal_profile_json_t: public daw::json::JsonLink<basal_profile_json_t> {
+					double minutes;
+					double rate;
+
+					basal_profile_json_t( ):
+							daw::json::JsonLink<basal_profile_json_t>{ },
+							minutes{ 0.0 },
+							rate{ 0.0 } {
+
+						link_real( "minutes", minutes );
+						link_real( "rate", rate );
+					}
+
+					~basal_profile_json_t( ) = default;
+					basal_profile_json_t( basal_profile_json_t const & ) = default;
+					basal_profile_json_t( basal_profile_json_t && ) = default;
+					basal_profile_json_t & operator=( basal_profile_json_t const & ) = default;
+					basal_profile_json_t & operator=( basal_profile_json_t && ) = default;
+				};	// basal_profile_json_t
+
+				/// Split local into whole days and the time into the day
+				void split_day( timestamp_t::duration const & local, timestamp_t::duration::rep & day, timestamp_t::duration & time_of_day ) {
+					constexpr timestamp_t::duration const one_day = hours{ 24 };
+					day = local / one_day;
+					time_of_day = local % one_day;
+					if( time_of_day < timestamp_t::duration::zero( ) ) {
+						--day;
+						time_of_day += one_day;
+					}
+				}
+			}	// namespace anonymous
+
+			basal_schedule_t::basal_schedule_t( std::vector<basal_profile_entry_t> const & basal_profile ):
+					m_rates( minutes_per_day ),
+					m_cumulative( minutes_per_day + 1 ) {
+
+				if( basal_profile.empty( ) || basal_profile.front( ).start != minutes{ 0 } ) {
+					throw std::runtime_error( "Basal profile must start at midnight" );
+				}
+				for( size_t n = 0; n < basal_profile.size( ); ++n ) {
+					auto const first = static_cast<size_t>(basal_profile[n].start.count( ));
+					auto const last = n + 1 < basal_profile.size( ) ? static_cast<size_t>(basal_profile[n + 1].start.count( )) : minutes_per_day;
+					if( first >= last || last > minutes_per_day ) {
+						throw std::runtime_error( "Basal profile must be sorted and within a day" );
+					}
+					std::fill( m_rates.begin( ) + static_cast<std::ptrdiff_t>(first), m_rates.begin( ) + static_cast<std::ptrdiff_t>(last), basal_profile[n].rate );
+				}
+				for( size_t n = 0; n < minutes_per_day; ++n ) {
+					m_cumulative[n + 1] = m_cumulative[n] + m_rates[n]/60.0;
+				}
+			}
+
+			insulin_t basal_schedule_t::rate_at( timestamp_t::duration const & local ) const {
+				timestamp_t::duration::rep day;
+				timestamp_t::duration time_of_day;
+				split_day( local, day, time_of_day );
+				return m_rates[static_cast<size_t>(duration_cast<minutes>( time_of_day ).count( ))];
+			}
+
+			insulin_t basal_schedule_t::rate_at( timestamp_t const & utc, tz_cache_t const & tz ) const {
+				return rate_at( tz.to_local( utc ) );
+			}
+
+			insulin_t basal_schedule_t::cumulative_in_day( timestamp_t::duration const & time_of_day ) const {
+				auto const minute = duration_cast<minutes>( time_of_day );
+				auto const n = static_cast<size_t>(minute.count( ));
+				// rates only change on the minute
+				return m_cumulative[n] + m_rates[n] * duration<double, hours::period>( time_of_day - minute ).count( );
+			}
+
+			insulin_t basal_schedule_t::cumulative( timestamp_t::duration const & local ) const {
+				timestamp_t::duration::rep day;
+				timestamp_t::duration time_of_day;
+				split_day( local, day, time_of_day );
+				return static_cast<insulin_t>(day) * daily_total( ) + cumulative_in_day( time_of_day );
+			}
+
+			insulin_t basal_schedule_t::scheduled_insulin( timestamp_t::duration const & local_from, timestamp_t::duration const & local_to ) const {
+				// the difference of the days first, cumulative( local ) is large enough to lose precision
+				timestamp_t::duration::rep from_day, to_day;
+				timestamp_t::duration from_time, to_time;
+				split_day( local_from, from_day, from_time );
+				split_day( local_to, to_day, to_time );
+				return static_cast<insulin_t>(to_day - from_day) * daily_total( ) + (cumulative_in_day( to_time ) - cumulative_in_day( from_time ));
+			}
+
+			insulin_t basal_schedule_t::scheduled_insulin( timestamp_t const & from, timestamp_t const & to, tz_cache_t const & tz ) const {
+				if( to <= from ) {
+					return 0;
+				}
+				auto const from_offset = tz.offset( from );
+				auto const to_offset = tz.offset( to );
+				if( from_offset == to_offset ) {
+					return scheduled_insulin( from.time_since_epoch( ) + from_offset, to.time_since_epoch( ) + from_offset );
+				}
+				// find the change to the closing offset and count each side in its own wall clock time
+				auto first = from;
+				auto last = to;
+				while( last - first > seconds{ 1 } ) {
+					auto const middle = first + (last - first)/2;
+					if( tz.offset( middle ) == to_offset ) {
+						last = middle;
+					} else {
+						first = middle;
+					}
+				}
+				auto const change = timestamp_t{ duration_cast<seconds>( last.time_since_epoch( ) ) };
+				if( change <= from || change >= to ) {
+					return scheduled_insulin( from.time_since_epoch( ) + from_offset, to.time_since_epoch( ) + from_offset );
+				}
+				return scheduled_insulin( from, change, tz ) + scheduled_insulin( change, to, tz );
+			}
+
+			insulin_t basal_schedule_t::daily_total( ) const {
+				return m_cumulative.back( );
+			}
+
+			insulin_t basal_schedule_t::max_rate( ) const {
+				return *std::max_element( m_rates.begin( ), m_rates.end( ) );
+			}
+
+			insulin_t net_basal_insulin( temp_basal_t const & temp, basal_schedule_t const & schedule, tz_cache_t const & tz ) {
+				if( temp.end <= temp.start ) {
+					return 0;
+				}
+				return temp.rate * duration<double, hours::period>( temp.end - temp.start ).count( ) - schedule.scheduled_insulin( temp.start, temp.end, tz );
+			}
+
+			std::vector<basal_profile_entry_t> basal_profile_from_file( std::string const & file_name ) {
+				std::vector<basal_profile_entry_t> result;
+				for( auto const & item: daw::json::array_from_file<basal_profile_json_t>( file_name ) ) {
+					result.push_back( { minutes{ static_cast<minutes::rep>(item.minutes) }, item.rate } );
+				}
+				return result;
+			}
+		}	// namespace iob
+	}	// namespace lib
+}    // namespace ns
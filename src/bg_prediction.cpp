@@ -0,0 +1,161 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016 Darrell Wright
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <algorithm>
+#include <chrono>
+#include <limits>
+#include <stdexcept>
+
+#include "bg_prediction.h"
+#include "iob_forecast.h"
+
+namespace ns {
+	namespace {
+		constexpr double const ticks_per_hour = 12.0;
+
+		struct curve_scan_t {
+			double min_bg;
+			double min_guard_bg;
+			double max_bg;
+
+			explicit curve_scan_t( double bg ) noexcept:
+					min_bg{ bg },
+					min_guard_bg{ bg },
+					max_bg{ bg } { }
+		};	// curve_scan_t
+
+		prediction_curve_summary_t to_summary( curve_scan_t const & scan, bool has_min, double const eventual_bg ) noexcept {
+			return { has_min ? scan.min_bg : eventual_bg, scan.min_guard_bg, scan.max_bg, eventual_bg };
+		}
+	}	// namespace anonymous
+
+	prediction_inputs_t::prediction_inputs_t( double BG, double minDelta, double Sens, double carbRatio, double mealCob, double slopeFromDeviations ):
+			bg{ BG },
+			min_delta{ minDelta },
+			sens{ Sens },
+			carb_ratio{ carbRatio },
+			meal_cob{ mealCob },
+			slope_from_deviations{ slopeFromDeviations },
+			remaining_carb_time{ std::chrono::hours{ 3 } },
+			min_bg_after{ std::chrono::minutes{ 90 } } { }
+
+	constexpr size_t const bg_prediction_engine_t::max_ticks;
+
+	bg_prediction_engine_t::bg_prediction_engine_t( ) noexcept:
+			m_iob{ },
+			m_cob{ },
+			m_uam{ },
+			m_size{ 0 } { }
+
+	prediction_summary_t bg_prediction_engine_t::predict( prediction_inputs_t const & inputs, double const * activity, size_t count ) noexcept {
+		count = std::min( count, max_ticks );
+		m_size = count + 1;
+		auto const & sens = inputs.sens;
+		// BG impact of insulin, mg/dL per 5m tick
+		auto const bgi = count > 0 ? -activity[0] * sens * 5.0 : 0.0;
+		auto const ci = inputs.min_delta - bgi;
+		auto const uci = ci;
+		// how many ticks the carbs on board last at the current carb impact
+		auto const csf = inputs.carb_ratio > 0.0 ? sens / inputs.carb_ratio : 0.0;
+		auto const max_cid = static_cast<double>(inputs.remaining_carb_time.count( )) / 5.0 / 2.0;
+		auto const cid = ci > 0.0 ? std::min( max_cid, std::max( 0.0, inputs.meal_cob * csf / ci ) ) : 0.0;
+		auto const ci_positive = std::max( 0.0, ci );
+		auto const cid_ticks = std::max( cid * 2.0, 1.0 );
+		auto const uam_ticks = 3.0 * ticks_per_hour;
+		auto const & slope = inputs.slope_from_deviations;
+
+		// Per tick changes first.  Nothing here depends on the previous tick so it vectorizes
+		double * const iob_delta = m_iob.data( ) + 1;
+		double * const cob_delta = m_cob.data( ) + 1;
+		double * const uam_delta = m_uam.data( ) + 1;
+		for( size_t n = 0; n < count; ++n ) {
+			auto const tick = static_cast<double>(n + 1);
+			auto const pred_bgi = -activity[n] * sens * 5.0;
+			// deviations decay linearly to zero over an hour
+			auto const pred_dev = ci * (1.0 - std::min( 1.0, tick / ticks_per_hour ));
+			auto const neg_dev = std::min( 0.0, pred_dev );
+			// carb impact decays linearly to zero over twice the carb duration
+			auto const pred_ci = std::max( 0.0, ci_positive * (1.0 - tick / cid_ticks) );
+			// unannounced meal impact follows the deviation slope, but decays to zero within 3 hours at most
+			auto const pred_uci_slope = std::max( 0.0, uci + tick * slope );
+			auto const pred_uci_max = std::max( 0.0, uci * (1.0 - tick / uam_ticks) );
+			auto const pred_uci = std::min( pred_uci_slope, pred_uci_max );
+
+			iob_delta[n] = pred_bgi + pred_dev;
+			cob_delta[n] = pred_bgi + neg_dev + pred_ci;
+			uam_delta[n] = pred_bgi + neg_dev + pred_uci;
+		}
+
+		// Then one pass accumulating all three curves and their summaries.  min_bg starts at the point min_bg_after
+		// from now, as oref0 only takes a point once IOBpredBGs.length > 18 after pushing it
+		auto const min_start = static_cast<size_t>(inputs.min_bg_after.count( ) / 5);
+		m_iob[0] = m_cob[0] = m_uam[0] = inputs.bg;
+		curve_scan_t iob_scan{ inputs.bg };
+		curve_scan_t cob_scan{ inputs.bg };
+		curve_scan_t uam_scan{ inputs.bg };
+		auto const has_min = count >= min_start;
+		if( has_min ) {
+			iob_scan.min_bg = cob_scan.min_bg = uam_scan.min_bg = std::numeric_limits<double>::max( );
+		}
+		for( size_t n = 1; n <= count; ++n ) {
+			auto const iob_bg = m_iob[n] += m_iob[n - 1];
+			auto const cob_bg = m_cob[n] += m_cob[n - 1];
+			auto const uam_bg = m_uam[n] += m_uam[n - 1];
+			auto const in_min_range = n >= min_start;
+			iob_scan.min_guard_bg = std::min( iob_scan.min_guard_bg, iob_bg );
+			cob_scan.min_guard_bg = std::min( cob_scan.min_guard_bg, cob_bg );
+			uam_scan.min_guard_bg = std::min( uam_scan.min_guard_bg, uam_bg );
+			iob_scan.max_bg = std::max( iob_scan.max_bg, iob_bg );
+			cob_scan.max_bg = std::max( cob_scan.max_bg, cob_bg );
+			uam_scan.max_bg = std::max( uam_scan.max_bg, uam_bg );
+			if( in_min_range ) {
+				iob_scan.min_bg = std::min( iob_scan.min_bg, iob_bg );
+				cob_scan.min_bg = std::min( cob_scan.min_bg, cob_bg );
+				uam_scan.min_bg = std::min( uam_scan.min_bg, uam_bg );
+			}
+		}
+		return { bgi, ci, cid, to_summary( iob_scan, has_min, m_iob[count] ), to_summary( cob_scan, has_min, m_cob[count] ), to_summary( uam_scan, has_min, m_uam[count] ) };
+	}
+
+	prediction_summary_t bg_prediction_engine_t::predict( prediction_inputs_t const & inputs, iob_forecast_t const & forecast ) {
+		if( forecast.step != std::chrono::minutes{ 5 } ) {
+			throw std::runtime_error( "BG predictions require a forecast with a 5 minute step" );
+		}
+		return predict( inputs, forecast.activity.data( ), forecast.size( ) );
+	}
+
+	size_t bg_prediction_engine_t::size( ) const noexcept {
+		return m_size;
+	}
+
+	double const * bg_prediction_engine_t::iob_curve( ) const noexcept {
+		return m_iob.data( );
+	}
+
+	double const * bg_prediction_engine_t::cob_curve( ) const noexcept {
+		return m_cob.data( );
+	}
+
+	double const * bg_prediction_engine_t::uam_curve( ) const noexcept {
+		return m_uam.data( );
+	}
+}	// namespace ns
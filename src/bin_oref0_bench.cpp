@@ -0,0 +1,364 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016 Darrell Wright
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <daw/json/daw_json_link.h>
+
+#include "basal_schedule.h"
+#include "bg_prediction.h"
+#include "carb_dose.h"
+#include "data_types.h"
+#include "iob_accumulator.h"
+#include "iob_calc.h"
+#include "iob_table.h"
+#include "lib_iob_calculate.h"
+#include "lib_iob_history.h"
+#include "requested_temp.h"
+#include "round_basal.h"
+#include "tz_cache.h"
+
+// Every allocation in the process is counted so the benchmarks can report allocations/op
+namespace {
+	std::atomic<size_t> s_allocations{ 0 };
+}
+
+void * operator new( size_t size ) {
+	++s_allocations;
+	if( auto result = std::malloc( size == 0 ? 1 : size ) ) {
+		return result;
+	}
+	throw std::bad_alloc{ };
+}
+
+void operator delete( void * ptr ) noexcept {
+	std::free( ptr );
+}
+
+void operator delete( void * ptr, size_t ) noexcept {
+	std::free( ptr );
+}
+
+namespace {
+	using namespace std::chrono;
+
+	/// Results are written here so the work is not optimized away
+	volatile double s_sink = 0.0;
+
+	// fixed so every run sees the same data
+	system_clock::time_point const s_now{ hours{ 24*365*47 } };
+	constexpr ns::insulin_duration_t const s_durations[] = { ns::insulin_duration_t::t180, ns::insulin_duration_t::t210, ns::insulin_duration_t::t240, ns::insulin_duration_t::t300, ns::insulin_duration_t::t360 };
+
+	struct bench_result_t {
+		std::string name;
+		size_t iterations;
+		double ns_per_op;
+		double allocations_per_op;
+	};	// bench_result_t
+
+	struct bench_t {
+		std::string name;
+		size_t ops_per_call;	// operations done by one call of func
+		std::function<double( )> func;
+	};	// bench_t
+
+	bench_result_t run( bench_t const & bench ) {
+		auto const time_calls = [&]( size_t const calls ) {
+			auto const start = steady_clock::now( );
+			for( size_t n = 0; n < calls; ++n ) {
+				s_sink = s_sink + bench.func( );
+			}
+			return duration<double, std::nano>( steady_clock::now( ) - start ).count( );
+		};
+		// grow the call count until a sample takes 20ms
+		size_t calls = 1;
+		while( time_calls( calls ) < 20.0e6 && calls < (size_t{ 1 } << 30) ) {
+			calls *= 2;
+		}
+		std::vector<double> samples;
+		for( size_t n = 0; n < 7; ++n ) {
+			samples.push_back( time_calls( calls ) );
+		}
+		std::sort( samples.begin( ), samples.end( ) );
+		auto const ops = static_cast<double>(calls * bench.ops_per_call);
+
+		auto const allocations_before = s_allocations.load( );
+		time_calls( calls );
+		auto const allocations = static_cast<double>(s_allocations.load( ) - allocations_before);
+
+		return { bench.name, calls * bench.ops_per_call, samples[samples.size( )/2]/ops, allocations/ops };
+	}
+
+	struct temp_basal_functions_t {
+		ns::requested_temp_t set_temp_basal( ns::insulin_t rate, minutes duration, ns::profile_t const &, ns::reason_log_t const & reasons, ns::current_temp_t const & ) const {
+			ns::requested_temp_t result{ };
+			result.rate = rate;
+			result.duration = duration;
+			result.reason = reasons;
+			return result;
+		}
+	};	// temp_basal_functions_t
+
+	struct treatment_t {
+		ns::insulin_t insulin;
+		ns::timestamp_t date;
+	};	// treatment_t
+
+	std::vector<bench_t> make_benches( ) {
+		std::vector<bench_t> result;
+		std::mt19937 rng{ 1 };
+
+		// scalar curve across its whole age range
+		for( auto const duration: s_durations ) {
+			std::vector<double> ages;
+			for( double age = 0.0; age < static_cast<double>(duration); age += 0.5 ) {
+				ages.push_back( age );
+			}
+			result.push_back( { "insulin_on_board_pct/" + std::to_string( static_cast<int>(duration) ), ages.size( ), [ages, duration]( ) {
+				double sum = 0.0;
+				for( auto const age: ages ) {
+					sum += ns::insulin_on_board_pct( age, duration );
+				}
+				return sum;
+			} } );
+		}
+
+		size_t const count = 4096;
+		std::uniform_real_distribution<double> age_dist{ 0.0, 360.0 };
+		std::uniform_int_distribution<size_t> duration_dist{ 0, 4 };
+		auto ages = std::make_shared<std::vector<double>>( count );
+		auto durations = std::make_shared<std::vector<ns::insulin_duration_t>>( count );
+		auto amounts = std::make_shared<std::vector<double>>( count, 1.0 );
+		for( size_t n = 0; n < count; ++n ) {
+			(*ages)[n] = age_dist( rng );
+			(*durations)[n] = s_durations[duration_dist( rng )];
+		}
+		result.push_back( { "insulin_on_board/batch", count, [=]( ) {
+			return ns::insulin_on_board( amounts->data( ), ages->data( ), durations->data( ), count );
+		} } );
+		result.push_back( { "insulin_on_board_activity/batch", count, [=]( ) {
+			return ns::insulin_on_board_activity( amounts->data( ), ages->data( ), durations->data( ), count ).iob;
+		} } );
+		result.push_back( { "iob_table::insulin_on_board/batch", count, [=]( ) {
+			return ns::iob_table::insulin_on_board( amounts->data( ), ages->data( ), durations->data( ), count );
+		} } );
+
+		// 4 hours of 5 minute predictions along all three curves
+		auto const prediction_activity = std::make_shared<std::vector<double>>( );
+		for( size_t n = 0; n < ns::bg_prediction_engine_t::max_ticks; ++n ) {
+			prediction_activity->push_back( 0.02 * std::exp( -static_cast<double>(n)/20.0 ) );
+		}
+		result.push_back( { "bg_prediction_engine_t/predict", 1, [prediction_activity, engine = std::make_shared<ns::bg_prediction_engine_t>( )]( ) {
+			ns::prediction_inputs_t const inputs{ 140.0, 2.5, 45.0, 10.0, 30.0, -0.2 };
+			return engine->predict( inputs, prediction_activity->data( ), prediction_activity->size( ) ).cob.eventual_bg;
+		} } );
+
+		// per-minute basal on board for the whole curve and queued for a day, built before timing.  Each op queues 5
+		// more minutes at the far end and advances one 5 minute tick, so every op sees the same number of doses
+		auto const accumulator = std::make_shared<ns::iob_accumulator>( s_now );
+		for( int minute = 1 - static_cast<int>(ns::insulin_duration_t::t240); minute <= 24*60; ++minute ) {
+			accumulator->add( ns::dose{ 0.02, ns::insulin_duration_t::t240, s_now + minutes{ minute } } );
+		}
+		result.push_back( { "iob_accumulator/advance_5min", 1, [accumulator, now = std::make_shared<system_clock::time_point>( s_now )]( ) {
+			for( int minute = 1; minute <= 5; ++minute ) {
+				accumulator->add( ns::dose{ 0.02, ns::insulin_duration_t::t240, *now + hours{ 24 } + minutes{ minute } } );
+			}
+			*now += minutes{ 5 };
+			accumulator->advance( *now );
+			return accumulator->iob( );
+		} } );
+
+		// a day of treatments every 5 minutes
+		auto treatments = std::make_shared<std::vector<treatment_t>>( );
+		for( int n = 0; n < 288; ++n ) {
+			treatments->push_back( { 0.05 * (n%7 + 1), s_now - minutes{ 5*n } } );
+		}
+		result.push_back( { "lib::iob::iobCalc/treatment", treatments->size( ), [treatments]( ) {
+			double sum = 0.0;
+			for( auto const & treatment: *treatments ) {
+				auto const contrib = ns::lib::iob::iobCalc( treatment, s_now, 3.0 );
+				sum += contrib.iobContrib ? *contrib.iobContrib : 0.0;
+			}
+			return sum;
+		} } );
+		result.push_back( { "lib::iob::iobCalc/range", treatments->size( ), [treatments]( ) {
+			return *ns::lib::iob::iobCalc( treatments->begin( ), treatments->end( ), s_now, 3.0 ).iobContrib;
+		} } );
+
+		// scheduled insulin under a day of 30 minute temps, walking the profile or from the prefix sums
+		auto const basal_profile = std::make_shared<std::vector<ns::lib::iob::basal_profile_entry_t>>( );
+		for( int n = 0; n < 24; ++n ) {
+			basal_profile->push_back( { hours{ n }, 0.5 + 0.05*n } );
+		}
+		auto const temps = std::make_shared<std::vector<ns::lib::iob::temp_basal_t>>( );
+		for( int n = 0; n < 48; ++n ) {
+			temps->push_back( { s_now + minutes{ 30*n + 7 }, s_now + minutes{ 30*n + 37 }, 1.5 } );
+		}
+		auto const tz = std::make_shared<ns::tz_cache_t>( hours{ -5 } );
+		result.push_back( { "lib::iob::split_temp_basal/net_insulin", temps->size( ), [basal_profile, temps, tz, pieces = std::make_shared<std::vector<ns::lib::iob::net_basal_t>>( )]( ) {
+			double sum = 0.0;
+			for( auto const & temp: *temps ) {
+				pieces->clear( );
+				ns::lib::iob::split_temp_basal( temp, *basal_profile, *tz, *pieces );
+				for( auto const & piece: *pieces ) {
+					sum += piece.net_insulin( );
+				}
+			}
+			return sum;
+		} } );
+		auto const schedule = std::make_shared<ns::lib::iob::basal_schedule_t>( *basal_profile );
+		result.push_back( { "lib::iob::basal_schedule_t/net_insulin", temps->size( ), [schedule, temps, tz]( ) {
+			double sum = 0.0;
+			for( auto const & temp: *temps ) {
+				sum += ns::lib::iob::net_basal_insulin( temp, *schedule, *tz );
+			}
+			return sum;
+		} } );
+
+		auto carbs = std::make_shared<std::vector<ns::carb_dose_t>>( );
+		for( int n = 0; n < 100; ++n ) {
+			carbs->emplace_back( s_now - minutes{ 3*n }, 5.0 + n%40, 0.5 );
+		}
+		result.push_back( { "carb_dose_t::calc_cob", carbs->size( ), [carbs]( ) {
+			double sum = 0.0;
+			for( auto const & carb: *carbs ) {
+				sum += ns::carb_dose_t::calc_cob( carb, s_now );
+			}
+			return sum;
+		} } );
+
+		auto profile = std::make_shared<ns::profile_t>( );
+		profile->model = std::string{ "554" };
+		result.push_back( { "round_basal", 400, [profile]( ) {
+			double sum = 0.0;
+			for( int n = 1; n <= 400; ++n ) {
+				sum += ns::round_basal( 0.0337 * n, *profile );
+			}
+			return sum;
+		} } );
+
+		// the decision path is expected to make no allocations
+		auto basal_profile_data = std::make_shared<ns::profile_t>( );
+		basal_profile_data->current_basal = 0.9;
+		basal_profile_data->min_bg = 100.0;
+		basal_profile_data->max_bg = 120.0;
+		basal_profile_data->sens = 45.0;
+		result.push_back( { "determine_basal/autosens", 1, [basal_profile_data, iob_data = std::make_shared<ns::iob_data_t>( )]( ) {
+			auto const temp = ns::determine_basal( { 110.0, 1.0, 0.5 }, { 0.9 }, *iob_data, *basal_profile_data, ns::autosense_data_t{ 1.2 }, { }, temp_basal_functions_t{ } );
+			return static_cast<double>(temp.reason.size( ));
+		} } );
+		result.push_back( { "determine_basal/cgm_calibrating", 1, [basal_profile_data, iob_data = std::make_shared<ns::iob_data_t>( )]( ) {
+			auto const temp = ns::determine_basal( { 20.0, 0.0, 0.0 }, { 1.5 }, *iob_data, *basal_profile_data, boost::none, { }, temp_basal_functions_t{ } );
+			return *temp.rate;
+		} } );
+
+		auto const profile_json = std::make_shared<std::string>( profile->to_string( ) );
+		result.push_back( { "profile_t/serialize", 1, [profile]( ) {
+			return static_cast<double>(profile->to_string( ).size( ));
+		} } );
+		result.push_back( { "profile_t/parse", 1, [profile_json]( ) {
+			return daw::json::from_string<ns::profile_t>( *profile_json ).autosens_max;
+		} } );
+
+		auto const iob_data = std::make_shared<ns::iob_data_t>( 0.5, 0.01, 2.5, 1.2, 0.3, 0.1 );
+		auto const iob_data_json = std::make_shared<std::string>( iob_data->to_string( ) );
+		result.push_back( { "iob_data_t/serialize", 1, [iob_data]( ) {
+			return static_cast<double>(iob_data->to_string( ).size( ));
+		} } );
+		result.push_back( { "iob_data_t/parse", 1, [iob_data_json]( ) {
+			return daw::json::from_string<ns::iob_data_t>( *iob_data_json ).iob;
+		} } );
+		return result;
+	}
+
+	enum class output_formats { text, json, csv };
+
+	void show_help( char const * name ) {
+		std::cout << name << " [--json|--csv] [--filter=<substring>]\n";
+		std::cout << "--json - Write the results as a JSON array\n";
+		std::cout << "--csv - Write the results as CSV\n";
+		std::cout << "--filter=<substring> - Only run benchmarks whose name contains substring" << std::endl;
+	}
+}	// namespace anonymous
+
+int main( int argc, char ** argv ) {
+	auto format = output_formats::text;
+	std::string filter;
+	for( int n = 1; n < argc; ++n ) {
+		std::string const arg{ argv[n] };
+		if( arg == "--json" ) {
+			format = output_formats::json;
+		} else if( arg == "--csv" ) {
+			format = output_formats::csv;
+		} else if( arg.compare( 0, 9, "--filter=" ) == 0 ) {
+			filter = arg.substr( 9 );
+		} else {
+			show_help( argv[0] );
+			return arg == "--help" ? EXIT_SUCCESS : EXIT_FAILURE;
+		}
+	}
+
+	std::vector<bench_result_t> results;
+	for( auto const & bench: make_benches( ) ) {
+		if( !filter.empty( ) && bench.name.find( filter ) == std::string::npos ) {
+			continue;
+		}
+		results.push_back( run( bench ) );
+		if( format == output_formats::text ) {
+			auto const & result = results.back( );
+			std::cout << std::left << std::setw( 40 ) << result.name << std::right << std::fixed << std::setprecision( 2 ) << std::setw( 12 ) << result.ns_per_op << " ns/op" << std::setw( 10 ) << std::setprecision( 3 ) << result.allocations_per_op << " allocs/op\n";
+		}
+	}
+
+	switch( format ) {
+	case output_formats::text:
+		break;
+	case output_formats::json:
+		std::cout << "[\n";
+		for( size_t n = 0; n < results.size( ); ++n ) {
+			auto const & result = results[n];
+			std::cout << "\t{ \"name\": \"" << result.name << "\", \"iterations\": " << result.iterations << std::setprecision( 6 ) << ", \"ns_per_op\": " << result.ns_per_op << ", \"allocations_per_op\": " << result.allocations_per_op << " }" << (n + 1 < results.size( ) ? ",\n" : "\n");
+		}
+		std::cout << "]" << std::endl;
+		break;
+	case output_formats::csv:
+		std::cout << "name,iterations,ns_per_op,allocations_per_op\n";
+		for( auto const & result: results ) {
+			std::cout << result.name << ',' << result.iterations << ',' << std::setprecision( 6 ) << result.ns_per_op << ',' << result.allocations_per_op << '\n';
+		}
+		std::cout << std::flush;
+		break;
+	}
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,177 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016 Darrell Wright
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <boost/algorithm/string/split.hpp>
+#include <boost/algorithm/string/classification.hpp>
+#include <boost/lexical_cast.hpp>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <daw/json/daw_json_link.h>
+
+#include "data_types.h"
+#include "determine_basal_reason.h"
+#include "determine_basal_sweep.h"
+
+namespace {
+	void show_help( char const * name ) {
+		std::cout << name << " <profile.json> --bg=<glucose> [options]\n";
+		std::cout << "Runs determine_basal for every combination of the grid values against one snapshot and writes a tab separated table\n\n";
+		std::cout << "Snapshot\n";
+		std::cout << "--bg=<glucose> - Current BG\n";
+		std::cout << "--delta=<glucose> --avg_delta=<glucose> - BG deltas, default 0\n";
+		std::cout << "--temp_rate=<U/hr> - Rate of the running temp, default 0\n";
+		std::cout << "--iob=<U> --activity=<U/min> - Insulin on board and activity, default 0\n";
+		std::cout << "--meal_cob=<g> - Carbs on board, default 0\n";
+		std::cout << "--autosens_ratio=<ratio> - Autosens ratio, no autosens when omitted\n\n";
+		std::cout << "Grid, comma separated values.  An omitted list keeps the profile's value\n";
+		std::cout << "--targets=<min:max,...> - BG target ranges\n";
+		std::cout << "--autosens_min=<list> --autosens_max=<list>\n";
+		std::cout << "--safety_multiplier=<list> - current_basal_safety_multiplier\n";
+		std::cout << "--threads=<count> - Worker threads, default every core" << std::endl;
+	}
+
+	std::vector<std::string> split_list( std::string const & str, char const * separators ) {
+		std::vector<std::string> result;
+		boost::split( result, str, boost::is_any_of( separators ) );
+		return result;
+	}
+
+	template<typename T>
+	std::vector<T> parse_list( std::string const & str ) {
+		std::vector<T> result;
+		for( auto const & item: split_list( str, "," ) ) {
+			result.push_back( boost::lexical_cast<T>( item ) );
+		}
+		return result;
+	}
+
+	std::vector<ns::target_range_t> parse_targets( std::string const & str ) {
+		std::vector<ns::target_range_t> result;
+		for( auto const & item: split_list( str, "," ) ) {
+			auto const range = split_list( item, ":" );
+			if( range.size( ) != 2 ) {
+				throw std::runtime_error( "Target ranges must be min:max, got " + item );
+			}
+			result.push_back( { boost::lexical_cast<ns::glucose_t>( range[0] ), boost::lexical_cast<ns::glucose_t>( range[1] ) } );
+		}
+		return result;
+	}
+
+	void write_results( ns::sweep_result_t const * results, size_t const count, ns::sweep_grid_t const & grid, ns::profile_variant_t const & base ) {
+		std::ostringstream ss;
+		for( size_t n = 0; n < count; ++n ) {
+			auto const & result = results[n];
+			auto const variant = grid.variant( base, result.index );
+			ss << result.index << '\t' << variant.min_bg.value_or( 0 ) << '\t' << variant.max_bg.value_or( 0 ) << '\t' << variant.autosens_min << '\t' << variant.autosens_max << '\t' << variant.current_basal_safety_multiplier << '\t';
+			if( result.failed ) {
+				ss << "-\t-\t-\t-\t-\terror\t-\n";
+				continue;
+			}
+			ss << result.min_bg << '\t' << result.max_bg << '\t' << result.target_bg << '\t';
+			if( result.rate ) {
+				ss << *result.rate << '\t' << result.duration.count( ) << '\t';
+			} else {
+				ss << "-\t-\t";
+			}
+			if( result.reason_count > 0 ) {
+				ss << result.last_reason.code << '\t' << result.last_reason << '\n';
+			} else {
+				ss << "-\t-\n";
+			}
+		}
+		std::cout << ss.str( );
+	}
+}	// namespace anonymous
+
+int main( int argc, char ** argv ) {
+	std::string profile_file;
+	std::unordered_map<std::string, std::string> options;
+	for( int n = 1; n < argc; ++n ) {
+		std::string const arg{ argv[n] };
+		if( arg == "--help" ) {
+			show_help( argv[0] );
+			return EXIT_SUCCESS;
+		}
+		if( arg.compare( 0, 2, "--" ) == 0 ) {
+			auto const sep = arg.find( '=' );
+			if( sep == std::string::npos ) {
+				show_help( argv[0] );
+				return EXIT_FAILURE;
+			}
+			options[arg.substr( 2, sep - 2 )] = arg.substr( sep + 1 );
+		} else {
+			profile_file = arg;
+		}
+	}
+	if( profile_file.empty( ) || options.count( "bg" ) == 0 ) {
+		show_help( argv[0] );
+		return EXIT_FAILURE;
+	}
+	auto const option = [&options]( std::string const & name, double const default_value ) {
+		auto const pos = options.find( name );
+		return pos == options.end( ) ? default_value : boost::lexical_cast<double>( pos->second );
+	};
+
+	try {
+		// the profile is parsed once, variants copy only the values they use
+		ns::profile_variant_t const base{ daw::json::from_file<ns::profile_t>( profile_file ) };
+
+		ns::sweep_snapshot_t snapshot{ { option( "bg", 0 ), option( "delta", 0 ), option( "avg_delta", 0 ) }, { option( "temp_rate", 0 ) }, ns::iob_data_t{ }, boost::none, { } };
+		snapshot.iob_data.iob = option( "iob", 0 );
+		snapshot.iob_data.activity = option( "activity", 0 );
+		snapshot.meal_data.meal_cob = option( "meal_cob", 0 );
+		if( options.count( "autosens_ratio" ) != 0 ) {
+			snapshot.autosense_data = ns::autosense_data_t{ option( "autosens_ratio", 1 ) };
+		}
+
+		ns::sweep_grid_t grid{ };
+		if( options.count( "targets" ) != 0 ) {
+			grid.target_ranges = parse_targets( options["targets"] );
+		}
+		if( options.count( "autosens_min" ) != 0 ) {
+			grid.autosens_min = parse_list<double>( options["autosens_min"] );
+		}
+		if( options.count( "autosens_max" ) != 0 ) {
+			grid.autosens_max = parse_list<double>( options["autosens_max"] );
+		}
+		if( options.count( "safety_multiplier" ) != 0 ) {
+			grid.current_basal_safety_multiplier = parse_list<double>( options["safety_multiplier"] );
+		}
+		auto const threads = static_cast<size_t>(option( "threads", 0 ));
+
+		std::cout << "index\tmin_bg\tmax_bg\tautosens_min\tautosens_max\tsafety_multiplier\tadjusted_min_bg\tadjusted_max_bg\tadjusted_target_bg\trate\tduration\treason\treason_text\n";
+		ns::sweep_determine_basal( snapshot, base, grid, [&]( ns::sweep_result_t const * results, size_t const count ) {
+			write_results( results, count, grid, base );
+		}, threads );
+		std::cout << std::flush;
+	} catch( std::exception const & ex ) {
+		std::cerr << "Error: " << ex.what( ) << std::endl;
+		return EXIT_FAILURE;
+	}
+	return EXIT_SUCCESS;
+}
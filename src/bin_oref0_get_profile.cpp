@@ -22,9 +22,11 @@
 
 #include <boost/algorithm/string/predicate.hpp>
 #include <boost/algorithm/string/trim.hpp>
+#include <boost/filesystem.hpp>
 #include <boost/lexical_cast.hpp>
 #include <boost/optional.hpp>
 #include <boost/utility/string_view.hpp>
+#include <chrono>
 #include <cstdlib>
 #include <iostream>
 #include <unordered_map>
@@ -33,7 +35,12 @@
 
 #include <daw/daw_bounded_stack.h>
 
+#include "basal_schedule.h"
+#include "compiled_profile.h"
 #include "data_types.h"
+#include "profile_snapshot.h"
+#include "stage_latency.h"
+#include "tz_cache.h"
 
 std::pair<std::string, std::string> parse_kv_string( boost::string_view line ) {
 	daw::bounded_stack_t<char, 2> ch_stack;
@@ -123,6 +130,9 @@ struct unnamed_parameters {
 			return { };
 		}
 		auto const dist = static_cast<size_t>(std::distance( optional.begin( ), pos )) + required.size( );
+		if( dist >= param.ordered_parameters.size( ) ) {
+			return { };
+		}
 		return { param.ordered_parameters[dist] };
 	}
 };
@@ -139,7 +149,9 @@ void show_help( char const * name, unnamed_parameters const & unnamed ) {
 	std::cout << "--help - Display this help message\n";
 	std::cout << "--model=<pump model> - Model of pump\n";
 	std::cout << "--exportDefaults\n";
-	std::cout << "--updatePreferences=<true|false>" << std::endl;
+	std::cout << "--updatePreferences=<true|false>\n";
+	std::cout << "--snapshot=<file> - Compiled profile snapshot, defaults to oref0_profile.snapshot next to the basal profile\n";
+	std::cout << "--latency=<text|json> - Write stage latencies to stderr on exit" << std::endl;
 }
 
 int main( int argc, char** argv ) {
@@ -151,6 +163,9 @@ int main( int argc, char** argv ) {
 		return EXIT_SUCCESS;
 	}
 	auto const model = params.kv_get( "model" );	
+	if( auto const latency = params.kv_get( "latency" ) ) {
+		ns::latency::write_at_exit( *latency == "json" ? ns::latency::output_formats::json : ns::latency::output_formats::text );
+	}
 
 	if( params.kv_get( "exportDefaults" ) ) {
 		std::cout << (ns::profile_t{ }).to_string( ) << std::endl;
@@ -179,5 +194,43 @@ int main( int argc, char** argv ) {
 		show_help( argv[0], unnamed );
 		return EXIT_SUCCESS;
 	}
+
+	auto const compile = [&]( ns::tz_cache_t tz ) {
+		auto const carb_ratios_file = unnamed.find( params, "carb_ratios" );
+		auto const carb_ratios = carb_ratios_file ? ns::carb_ratios_from_file( *carb_ratios_file ) : std::vector<ns::schedule_entry_t>{ };
+		return ns::compiled_profile_t{ ns::lib::iob::basal_profile_from_file( *unnamed.find( params, "basal_profile" ) ), ns::isf_from_file( *unnamed.find( params, "insulin_sensitivities" ) ), carb_ratios, ns::bg_targets_from_file( *unnamed.find( params, "bg_targets" ) ), std::move( tz ) };
+	};
+
+	ns::profile_t profile{ };
+	try {
+		ns::latency::scoped_timer_t const timer{ ns::latency::stage_t::profile_load };
+		auto const snapshot_file = params.kv_get( "snapshot" ).value_or( (boost::filesystem::path{ *unnamed.find( params, "basal_profile" ) }.parent_path( ) / "oref0_profile.snapshot").string( ) );
+		// any change to an input means parsing them all again
+		auto const input_hashes = ns::profile_snapshot::file_hashes( params.ordered_parameters );
+		auto const tz = ns::tz_cache_t::local( );
+		auto compiled = ns::profile_snapshot::load( snapshot_file, input_hashes, tz );
+		if( !compiled ) {
+			compiled = compile( tz );
+			try {
+				ns::profile_snapshot::save( snapshot_file, *compiled, input_hashes );
+			} catch( std::exception const & ex ) {
+				std::cerr << "Error writing profile snapshot\n" << ex.what( ) << std::endl;
+			}
+		}
+		auto const & current = compiled->at( std::chrono::system_clock::now( ) );
+		profile.current_basal = current.basal;
+		profile.max_daily_basal = compiled->basal_schedule( ).max_rate( );
+		profile.sens = current.isf;
+		if( current.carb_ratio > 0.0 ) {
+			profile.carb_ratio = current.carb_ratio;
+		}
+		profile.min_bg = current.min_bg;
+		profile.max_bg = current.max_bg;
+		profile.target_bg = current.target_bg( );
+	} catch( std::exception const & ex ) {
+		std::cerr << "Error importing pump schedules\n" << ex.what( ) << std::endl;
+		exit( EXIT_FAILURE );
+	}
+	std::cout << profile.to_string( ) << std::endl;
 	return EXIT_SUCCESS;
 }
@@ -0,0 +1,153 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016 Darrell Wright
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <algorithm>
+#include <boost/lexical_cast.hpp>
+#include <boost/optional.hpp>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <date/date.h>
+#include <daw/json/daw_json_link.h>
+
+#include "data_types.h"
+#include "history_archive.h"
+#include "lib_iob_history.h"
+#include "tz_cache.h"
+
+using namespace ns::lib::iob;
+
+/// Converts pump history JSON (newest first, as read from the pump) into a history archive, appending the records
+/// newer than those already archived
+struct pump_history_json_t: public daw::json::JsonLink<pump_history_json_t> {
+	std::string type;
+	std::string timestamp;
+	double amount;
+	double rate;
+	std::string temp;
+	double duration;
+
+	pump_history_json_t( ):
+			daw::json::JsonLink<pump_history_json_t>{ },
+			type{ },
+			timestamp{ },
+			amount{ 0.0 },
+			rate{ 0.0 },
+			temp{ },
+			duration{ 0.0 } {
+
+		link_string( "_type", type );
+		link_string( "timestamp", timestamp );
+		link_real( "amount", amount );
+		link_real( "rate", rate );
+		link_string( "temp", temp );
+		link_real( "duration (min)", duration );
+	}
+
+	~pump_history_json_t( ) = default;
+	pump_history_json_t( pump_history_json_t const & ) = default;
+	pump_history_json_t( pump_history_json_t && ) = default;
+	pump_history_json_t & operator=( pump_history_json_t const & ) = default;
+	pump_history_json_t & operator=( pump_history_json_t && ) = default;
+};	// pump_history_json_t
+
+/// @brief Parse a pump timestamp, YYYY-MM-DDTHH:MM:SS with an optional Z or +HH:MM suffix.  Timestamps without
+/// one are pump local time, converted with the offset in effect at that time
+ns::timestamp_t parse_timestamp( std::string const & str, ns::tz_cache_t const & tz ) {
+	int y, mo, d, h, mi, s;
+	char sign = 0;
+	int off_h = 0, off_m = 0;
+	auto const fields = std::sscanf( str.c_str( ), "%d-%d-%dT%d:%d:%d%c%d:%d", &y, &mo, &d, &h, &mi, &s, &sign, &off_h, &off_m );
+	if( fields < 6 ) {
+		throw std::runtime_error( "Invalid timestamp " + str );
+	}
+	auto const day = date::sys_days{ date::year{ y }/mo/d };
+	auto const wall_clock = ns::timestamp_t{ day }.time_since_epoch( ) + std::chrono::hours{ h } + std::chrono::minutes{ mi } + std::chrono::seconds{ s };
+	if( fields >= 7 && sign == 'Z' ) {
+		return ns::timestamp_t{ wall_clock };
+	} else if( fields == 9 && (sign == '+' || sign == '-') ) {
+		auto offset = std::chrono::hours{ off_h } + std::chrono::minutes{ off_m };
+		if( sign == '-' ) {
+			offset = -offset;
+		}
+		return ns::timestamp_t{ wall_clock - offset };
+	}
+	return tz.from_local( wall_clock );
+}
+
+boost::optional<pump_history_t> to_history( pump_history_json_t const & item, ns::tz_cache_t const & tz ) {
+	auto const when = parse_timestamp( item.timestamp, tz );
+	if( item.type == "Bolus" ) {
+		return pump_history_t{ pump_history_types::Bolus, when, item.amount, 0.0, pump_temp_basal_types::Absolute, std::chrono::minutes{ 0 } };
+	} else if( item.type == "TempBasal" ) {
+		auto const temp_type = item.temp == "percent" ? pump_temp_basal_types::Percentage : pump_temp_basal_types::Absolute;
+		return pump_history_t{ pump_history_types::TempBasal, when, 0.0, item.rate, temp_type, std::chrono::minutes{ 0 } };
+	} else if( item.type == "TempBasalDuration" ) {
+		auto const length = std::chrono::minutes{ static_cast<std::chrono::minutes::rep>(item.duration) };
+		return pump_history_t{ pump_history_types::TempBasalDuration, when, 0.0, 0.0, pump_temp_basal_types::Absolute, length };
+	}
+	return boost::none;
+}
+
+int main( int argc, char ** argv ) {
+	if( argc < 3 ) {
+		std::cerr << "Usage: " << argv[0] << " <pump_history.json> <archive> [local_utc_offset_minutes]\n";
+		return EXIT_FAILURE;
+	}
+	// history can span a DST change, so without a fixed offset each timestamp gets the local zone's offset at that time
+	auto const tz = argc > 3 ? ns::tz_cache_t{ std::chrono::minutes{ boost::lexical_cast<int>( argv[3] ) } } : ns::tz_cache_t::local( );
+
+	std::vector<pump_history_t> history;
+	for( auto const & item: daw::json::array_from_file<pump_history_json_t>( argv[1] ) ) {
+		if( auto record = to_history( item, tz ) ) {
+			history.push_back( *record );
+		}
+	}
+	// pump history is newest first, keep a temp and its duration in pump order
+	std::reverse( history.begin( ), history.end( ) );
+	std::stable_sort( history.begin( ), history.end( ), []( auto const & lhs, auto const & rhs ) {
+		return lhs.timestamp < rhs.timestamp;
+	} );
+
+	ns::history_archive::writer archive{ argv[2] };
+	if( archive.size( ) > 0 ) {
+		// a temp and its duration share a timestamp and an earlier run may have stopped between them, so records at
+		// the newest time are only skipped when a record of that type is already archived at it
+		auto const newest = archive.newest( );
+		std::vector<pump_history_types> archived_types;
+		for( auto const & record: ns::history_archive::reader{ argv[2] }.range( newest, newest + std::chrono::milliseconds{ 1 } ) ) {
+			archived_types.push_back( static_cast<pump_history_types>(record.type) );
+		}
+		history.erase( std::remove_if( history.begin( ), history.end( ), [&]( auto const & item ) {
+			return item.timestamp < newest || (item.timestamp == newest && std::find( archived_types.begin( ), archived_types.end( ), item.type ) != archived_types.end( ));
+		} ), history.end( ) );
+	}
+	archive.append( history );
+	archive.flush( );
+	std::cout << "Appended " << history.size( ) << " records, " << archive.size( ) << " in archive\n";
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,61 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016 Darrell Wright
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <chrono>
+
+#include "carb_dose.h"
+
+namespace ns {
+	double calc_duration( std::chrono::system_clock::time_point const & lhs, std::chrono::system_clock::time_point const & rhs ) {
+		using namespace std::chrono;
+		return duration_cast<minutes>( rhs - lhs ).count( );
+	}
+
+	carb_dose_t::carb_dose_t( timestamp_t doseTime, double Amount, double absorptionRate ):
+			amount{ Amount < 0 ? 0 : Amount },
+			absorption_rate{ absorptionRate < 0 ? 0 : absorptionRate },
+			dose_time{ doseTime } { }
+
+	double carb_dose_t::calc_cob( carb_dose_t const & item, timestamp_t const & current_ts ) {
+		// Used formula from https://github.com/Perceptus/GlucoDyn/blob/master/basic_math.pdf
+		auto const t = calc_duration( item.dose_time, current_ts );
+		if( t < 0 ) {
+			return item.amount;
+		}
+		double const AT = item.amount/item.absorption_rate;
+		auto const & D = item.amount;
+		auto result = D - [&]( ) { 
+			if( t < AT/2.0 ) {
+				return (2.0*D*t*t)/(AT*AT);
+			} else if( t <= AT ) {
+				return ((4.0*D)/AT)*(t - (t*t)/(2*AT)) - D;
+			}
+			return D;
+		}( );
+		//std::cout << "~~~~calc_cob: AT=" << AT << " D=" << D << " cob=" << result << " %=" << ((result/item.amount)*100) << '\n';
+		return result;
+	}
+
+	double carb_dose_t::tick( timestamp_t const & current_ts ) const {
+		return calc_cob( *this, current_ts ); 
+	}
+}	// namespace ns
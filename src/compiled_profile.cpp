@@ -0,0 +1,243 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016 Darrell Wright
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <algorithm>
+#include <chrono>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <daw/json/daw_json_link.h>
+
+#include "basal_schedule.h"
+#include "compiled_profile.h"
+#include "data_types.h"
+#include "lib_iob_history.h"
+#include "tz_cache.h"
+
+namespace ns {
+	namespace {
+		using namespace std::chrono;
+		constexpr size_t const minutes_per_day = 24*60;
+
+		/// Calls func( values_first, values_last, entry ) for the minutes each entry of a schedule covers
+		template<typename Entry, typename Function>
+		void for_each_entry( std::vector<profile_values_t> & values, std::vector<Entry> const & schedule, char const * name, Function func ) {
+			if( schedule.empty( ) || schedule.front( ).start != minutes{ 0 } ) {
+				throw std::runtime_error( std::string{ name } + " schedule must start at midnight" );
+			}
+			for( size_t n = 0; n < schedule.size( ); ++n ) {
+				auto const first = static_cast<size_t>(schedule[n].start.count( ));
+				auto const last = n + 1 < schedule.size( ) ? static_cast<size_t>(schedule[n + 1].start.count( )) : minutes_per_day;
+				if( first >= last || last > minutes_per_day ) {
+					throw std::runtime_error( std::string{ name } + " schedule must be sorted and within a day" );
+				}
+				std::for_each( values.begin( ) + static_cast<std::ptrdiff_t>(first), values.begin( ) + static_cast<std::ptrdiff_t>(last), [&]( profile_values_t & value ) {
+					func( value, schedule[n] );
+				} );
+			}
+		}
+
+		struct isf_json_t: public daw::json::JsonLink<isf_json_t> {
+			double offset;
+			double sensitivity;
+
+			isf_json_t( ):
+					daw::json::JsonLink<isf_json_t>{ },
+					offset{ 0.0 },
+					sensitivity{ 0.0 } {
+
+				link_real( "offset", offset );
+				link_real( "sensitivity", sensitivity );
+			}
+		};	// isf_json_t
+
+		struct isf_file_json_t: public daw::json::JsonLink<isf_file_json_t> {
+			std::vector<isf_json_t> sensitivities;
+
+			isf_file_json_t( ):
+					daw::json::JsonLink<isf_file_json_t>{ },
+					sensitivities{ } {
+
+				link_array( "sensitivities", sensitivities );
+			}
+		};	// isf_file_json_t
+
+		struct carb_ratio_json_t: public daw::json::JsonLink<carb_ratio_json_t> {
+			double offset;
+			double ratio;
+
+			carb_ratio_json_t( ):
+					daw::json::JsonLink<carb_ratio_json_t>{ },
+					offset{ 0.0 },
+					ratio{ 0.0 } {
+
+				link_real( "offset", offset );
+				link_real( "ratio", ratio );
+			}
+		};	// carb_ratio_json_t
+
+		struct carb_ratios_file_json_t: public daw::json::JsonLink<carb_ratios_file_json_t> {
+			std::vector<carb_ratio_json_t> schedule;
+
+			carb_ratios_file_json_t( ):
+					daw::json::JsonLink<carb_ratios_file_json_t>{ },
+					schedule{ } {
+
+				link_array( "schedule", schedule );
+			}
+		};	// carb_ratios_file_json_t
+
+		struct bg_target_json_t: public daw::json::JsonLink<bg_target_json_t> {
+			double offset;
+			double low;
+			double high;
+
+			bg_target_json_t( ):
+					daw::json::JsonLink<bg_target_json_t>{ },
+					offset{ 0.0 },
+					low{ 0.0 },
+					high{ 0.0 } {
+
+				link_real( "offset", offset );
+				link_real( "low", low );
+				link_real( "high", high );
+			}
+		};	// bg_target_json_t
+
+		struct bg_targets_file_json_t: public daw::json::JsonLink<bg_targets_file_json_t> {
+			std::vector<bg_target_json_t> targets;
+
+			bg_targets_file_json_t( ):
+					daw::json::JsonLink<bg_targets_file_json_t>{ },
+					targets{ } {
+
+				link_array( "targets", targets );
+			}
+		};	// bg_targets_file_json_t
+
+		/// The basal profile entries the per minute rates came from
+		std::vector<lib::iob::basal_profile_entry_t> basal_entries( std::vector<profile_values_t> const & values ) {
+			if( values.size( ) != minutes_per_day ) {
+				throw std::runtime_error( "Expected a value for each minute of the day" );
+			}
+			std::vector<lib::iob::basal_profile_entry_t> result;
+			for( size_t n = 0; n < values.size( ); ++n ) {
+				if( n == 0 || values[n].basal != values[n - 1].basal ) {
+					result.push_back( { minutes{ static_cast<minutes::rep>(n) }, values[n].basal } );
+				}
+			}
+			return result;
+		}
+
+		minutes to_minutes( double const offset ) {
+			return minutes{ static_cast<minutes::rep>(offset) };
+		}
+	}	// namespace anonymous
+
+	glucose_t profile_values_t::target_bg( ) const noexcept {
+		return (min_bg + max_bg)/2.0;
+	}
+
+	compiled_profile_t::compiled_profile_t( std::vector<lib::iob::basal_profile_entry_t> const & basal_profile, std::vector<schedule_entry_t> const & isf, std::vector<schedule_entry_t> const & carb_ratios, std::vector<bg_target_entry_t> const & bg_targets, tz_cache_t tz ):
+			m_values( minutes_per_day, profile_values_t{ 0, 0, 0, 0, 0 } ),
+			m_basal_schedule{ basal_profile },
+			m_tz{ std::move( tz ) } {
+
+		for( size_t n = 0; n < minutes_per_day; ++n ) {
+			m_values[n].basal = m_basal_schedule.rate_at( minutes{ static_cast<minutes::rep>(n) } );
+		}
+		for_each_entry( m_values, isf, "ISF", []( profile_values_t & value, schedule_entry_t const & entry ) {
+			value.isf = entry.value;
+		} );
+		if( !carb_ratios.empty( ) ) {
+			for_each_entry( m_values, carb_ratios, "Carb ratio", []( profile_values_t & value, schedule_entry_t const & entry ) {
+				value.carb_ratio = entry.value;
+			} );
+		}
+		for_each_entry( m_values, bg_targets, "BG target", []( profile_values_t & value, bg_target_entry_t const & entry ) {
+			value.min_bg = entry.low;
+			value.max_bg = entry.high;
+		} );
+	}
+
+	compiled_profile_t::compiled_profile_t( std::vector<profile_values_t> values, tz_cache_t tz ):
+			m_values{ },
+			m_basal_schedule{ basal_entries( values ) },
+			m_tz{ std::move( tz ) } {
+
+		m_values = std::move( values );
+	}
+
+	profile_values_t const & compiled_profile_t::at_minute( minutes const minute_of_day ) const {
+		return m_values[static_cast<size_t>(minute_of_day.count( ))];
+	}
+
+	profile_values_t const & compiled_profile_t::at_local( timestamp_t::duration const & local ) const {
+		constexpr timestamp_t::duration const one_day = hours{ 24 };
+		auto time_of_day = local % one_day;
+		if( time_of_day < timestamp_t::duration::zero( ) ) {
+			time_of_day += one_day;
+		}
+		return at_minute( duration_cast<minutes>( time_of_day ) );
+	}
+
+	profile_values_t const & compiled_profile_t::at( timestamp_t const & utc ) const {
+		return at_local( m_tz.to_local( utc ) );
+	}
+
+	std::vector<profile_values_t> const & compiled_profile_t::values( ) const noexcept {
+		return m_values;
+	}
+
+	lib::iob::basal_schedule_t const & compiled_profile_t::basal_schedule( ) const noexcept {
+		return m_basal_schedule;
+	}
+
+	tz_cache_t const & compiled_profile_t::tz( ) const noexcept {
+		return m_tz;
+	}
+
+	std::vector<schedule_entry_t> isf_from_file( std::string const & file_name ) {
+		std::vector<schedule_entry_t> result;
+		for( auto const & item: daw::json::from_file<isf_file_json_t>( file_name ).sensitivities ) {
+			result.push_back( { to_minutes( item.offset ), item.sensitivity } );
+		}
+		return result;
+	}
+
+	std::vector<schedule_entry_t> carb_ratios_from_file( std::string const & file_name ) {
+		std::vector<schedule_entry_t> result;
+		for( auto const & item: daw::json::from_file<carb_ratios_file_json_t>( file_name ).schedule ) {
+			result.push_back( { to_minutes( item.offset ), item.ratio } );
+		}
+		return result;
+	}
+
+	std::vector<bg_target_entry_t> bg_targets_from_file( std::string const & file_name ) {
+		std::vector<bg_target_entry_t> result;
+		for( auto const & item: daw::json::from_file<bg_targets_file_json_t>( file_name ).targets ) {
+			result.push_back( { to_minutes( item.offset ), item.low, item.high } );
+		}
+		return result;
+	}
+}    // namespace ns
@@ -48,6 +48,7 @@ namespace ns {
 			activity{ std::move( Activity ) },
 			iob{ std::move( Iob ) },
 			basaliob{ std::move( basalIob ) },
+			netbasalinsulin{ std::move( netBasalInsulin ) },
 			hightempinsulin{ std::move( highTempInsulin ) } {
 
 		link_real( "bolussnooze", bolussnooze );
@@ -63,4 +64,8 @@ namespace ns {
 
 	iob_data_t::~iob_data_t( ) { }
 
+	std::string requested_temp_t::reason_text( ) const {
+		return to_string( reason );
+	}
+
 }    // namespace ns 
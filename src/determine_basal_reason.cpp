@@ -0,0 +1,192 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016 Darrell Wright
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <algorithm>
+#include <ostream>
+#include <sstream>
+
+#include "determine_basal_reason.h"
+
+namespace ns {
+	std::ostream & operator<<( std::ostream & os, reason_code_t code ) {
+		switch( code ) {
+		case reason_code_t::basal_adjusted_autosens:
+			return os << "basal_adjusted_autosens";
+		case reason_code_t::cgm_calibrating:
+			return os << "cgm_calibrating";
+		case reason_code_t::cgm_calibrating_set_basal:
+			return os << "cgm_calibrating_set_basal";
+		case reason_code_t::cgm_calibrating_temp_below_basal:
+			return os << "cgm_calibrating_temp_below_basal";
+		case reason_code_t::temp_target_set:
+			return os << "temp_target_set";
+		case reason_code_t::target_bg_unchanged:
+			return os << "target_bg_unchanged";
+		case reason_code_t::target_bg_adjusted:
+			return os << "target_bg_adjusted";
+		case reason_code_t::bg_targets:
+			return os << "bg_targets";
+		case reason_code_t::predicted:
+			return os << "predicted";
+		case reason_code_t::low_glucose_suspend:
+			return os << "low_glucose_suspend";
+		case reason_code_t::eventual_bg_below_min:
+			return os << "eventual_bg_below_min";
+		case reason_code_t::eventual_bg_below_min_rising:
+			return os << "eventual_bg_below_min_rising";
+		case reason_code_t::delta_below_expected:
+			return os << "delta_below_expected";
+		case reason_code_t::in_range:
+			return os << "in_range";
+		case reason_code_t::iob_above_max:
+			return os << "iob_above_max";
+		case reason_code_t::insulin_req_limited:
+			return os << "insulin_req_limited";
+		case reason_code_t::rate_above_max_safe:
+			return os << "rate_above_max_safe";
+		case reason_code_t::temp_above_required:
+			return os << "temp_above_required";
+		case reason_code_t::set_current_basal:
+			return os << "set_current_basal";
+		case reason_code_t::no_decision:
+			return os << "no_decision";
+		}
+		return os << "unknown(" << static_cast<int>(code) << ")";
+	}
+
+	std::ostream & operator<<( std::ostream & os, reason_event_t const & event ) {
+		switch( event.code ) {
+		case reason_code_t::basal_adjusted_autosens:
+			return os << "Adjusting basal from " << event[0] << " to " << event[1];
+		case reason_code_t::cgm_calibrating:
+			return os << "CGM is calibrating or in ??? state";
+		case reason_code_t::cgm_calibrating_set_basal:
+			return os << "setting current basal of " << event[0] << " as temp";
+		case reason_code_t::cgm_calibrating_temp_below_basal:
+			return os << "temp " << event[0] << " <~ current basal " << event[1] << "U/hr";
+		case reason_code_t::temp_target_set:
+			return os << "Temp target set, not adjusting with autosens";
+		case reason_code_t::target_bg_unchanged:
+			return os << "target_bg unchanged: " << event[0];
+		case reason_code_t::target_bg_adjusted:
+			return os << "Adjusting target_bg from " << event[0] << " to " << event[1];
+		case reason_code_t::bg_targets:
+			return os << "min_bg " << event[0] << ", max_bg " << event[1] << ", target_bg " << event[2];
+		case reason_code_t::predicted:
+			return os << "eventualBG " << event[0] << ", minPredBG " << event[1];
+		case reason_code_t::low_glucose_suspend:
+			return os << "minGuardBG " << event[0] << " < threshold " << event[1] << ", setting 0 temp";
+		case reason_code_t::eventual_bg_below_min:
+			return os << "Eventual BG " << event[0] << " < " << event[1];
+		case reason_code_t::eventual_bg_below_min_rising:
+			return os << "but Delta " << event[0] << " > Exp. Delta " << event[1];
+		case reason_code_t::delta_below_expected:
+			return os << "Eventual BG > min_bg but Delta " << event[0] << " < Exp. Delta " << event[1];
+		case reason_code_t::in_range:
+			return os << event[0] << "-" << event[1] << " in range: no temp required";
+		case reason_code_t::iob_above_max:
+			return os << "IOB " << event[0] << " > max_iob " << event[1];
+		case reason_code_t::insulin_req_limited:
+			return os << "insulinReq " << event[0] << " limited to max_iob - IOB " << event[1];
+		case reason_code_t::rate_above_max_safe:
+			return os << "adj. req. rate: " << event[0] << " to maxSafeBasal: " << event[1];
+		case reason_code_t::temp_above_required:
+			return os << "temp " << event[0] << " >~ req " << event[1] << "U/hr";
+		case reason_code_t::set_current_basal:
+			return os << "setting current basal of " << event[0] << " as temp";
+		case reason_code_t::no_decision:
+			return os << "no change, temp " << event[0] << "U/hr left running";
+		}
+		return os << event.code;
+	}
+
+	constexpr size_t const reason_log_t::capacity;
+
+	reason_log_t::reason_log_t( ) noexcept:
+			m_events{ },
+			m_size{ 0 },
+			m_dropped{ 0 } { }
+
+	void reason_log_t::add( reason_code_t code, double operand0, double operand1, double operand2 ) noexcept {
+		if( m_size == capacity ) {
+			++m_dropped;
+			return;
+		}
+		m_events[m_size++] = reason_event_t{ { { operand0, operand1, operand2 } }, code };
+	}
+
+	void reason_log_t::clear( ) noexcept {
+		m_size = 0;
+		m_dropped = 0;
+	}
+
+	reason_log_t::const_iterator reason_log_t::begin( ) const noexcept {
+		return m_events.begin( );
+	}
+
+	reason_log_t::const_iterator reason_log_t::end( ) const noexcept {
+		return std::next( m_events.begin( ), static_cast<std::ptrdiff_t>(m_size) );
+	}
+
+	size_t reason_log_t::size( ) const noexcept {
+		return m_size;
+	}
+
+	bool reason_log_t::empty( ) const noexcept {
+		return m_size == 0;
+	}
+
+	bool reason_log_t::contains( reason_code_t code ) const noexcept {
+		return std::any_of( begin( ), end( ), [code]( auto const & event ) {
+			return event.code == code;
+		} );
+	}
+
+	size_t reason_log_t::dropped( ) const noexcept {
+		return m_dropped;
+	}
+
+	reason_event_t const & reason_log_t::operator[]( size_t pos ) const noexcept {
+		return m_events[pos];
+	}
+
+	std::ostream & operator<<( std::ostream & os, reason_log_t const & reasons ) {
+		bool is_first = true;
+		for( auto const & event: reasons ) {
+			if( !is_first ) {
+				os << "; ";
+			}
+			is_first = false;
+			os << event;
+		}
+		if( reasons.dropped( ) > 0 ) {
+			os << (is_first ? "" : "; ") << reasons.dropped( ) << " more";
+		}
+		return os;
+	}
+
+	std::string to_string( reason_log_t const & reasons ) {
+		std::stringstream ss;
+		ss << reasons;
+		return ss.str( );
+	}
+}    // namespace ns
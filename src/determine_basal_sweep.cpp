@@ -0,0 +1,188 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016 Darrell Wright
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "data_types.h"
+#include "determine_basal_sweep.h"
+#include "requested_temp.h"
+
+namespace ns {
+	namespace {
+		// blocks per thread when the block size is picked, enough that a thread with slow variants does not hold up the rest
+		constexpr size_t const blocks_per_thread = 8;
+		constexpr size_t const max_block_size = 1024;
+
+		struct sweep_temp_basal_functions_t {
+			requested_temp_t set_temp_basal( insulin_t rate, std::chrono::minutes duration, profile_variant_t const & profile, reason_log_t const & reasons, current_temp_t const & ) const {
+				if( auto const max_rate = max_safe_basal( profile ) ) {
+					rate = std::min( rate, *max_rate );
+				}
+				requested_temp_t result{ };
+				result.rate = std::max( rate, 0.0 );
+				result.duration = duration;
+				result.reason = reasons;
+				return result;
+			}
+		};	// sweep_temp_basal_functions_t
+
+		size_t extent( size_t const size ) noexcept {
+			return std::max<size_t>( size, 1 );
+		}
+
+		/// @brief The value at the next digit of index, or the base value when there are none to choose from
+		template<typename T>
+		void select( std::vector<T> const & values, size_t & index, T & value ) {
+			if( !values.empty( ) ) {
+				value = values[index % values.size( )];
+			}
+			index /= extent( values.size( ) );
+		}
+
+		sweep_result_t evaluate( sweep_snapshot_t const & snapshot, profile_variant_t const & variant, size_t const index ) {
+			auto autosense_data = snapshot.autosense_data;
+			if( autosense_data ) {
+				autosense_data->ratio = std::min( std::max( autosense_data->ratio, variant.autosens_min ), variant.autosens_max );
+			}
+			sweep_result_t result{ index, boost::none, std::chrono::minutes{ 0 }, 0.0, 0.0, 0.0, reason_event_t{ }, 0, false };
+			try {
+				auto const temp = determine_basal( snapshot.glucose_status, snapshot.current_temp, snapshot.iob_data, variant, autosense_data, snapshot.meal_data, sweep_temp_basal_functions_t{ } );
+				result.rate = temp.rate;
+				result.duration = temp.duration.value_or( std::chrono::minutes{ 0 } );
+				result.reason_count = static_cast<uint8_t>(temp.reason.size( ));
+				for( auto const & event: temp.reason ) {
+					if( event.code == reason_code_t::bg_targets ) {
+						result.min_bg = event[0];
+						result.max_bg = event[1];
+						result.target_bg = event[2];
+					}
+				}
+				if( !temp.reason.empty( ) ) {
+					result.last_reason = temp.reason[temp.reason.size( ) - 1];
+				}
+			} catch( determine_basal_exception const & ) {
+				result.failed = true;
+			}
+			return result;
+		}
+	}	// namespace anonymous
+
+	profile_variant_t::profile_variant_t( profile_t const & profile ):
+			autosens_adjust_targets{ profile.autosens_adjust_targets },
+			temp_target_set{ profile.temp_target_set },
+			max_bg{ profile.max_bg },
+			min_bg{ profile.min_bg },
+			target_bg{ profile.target_bg },
+			current_basal{ profile.current_basal },
+			max_basal{ profile.max_basal },
+			max_daily_basal{ profile.max_daily_basal },
+			sens{ profile.sens },
+			carb_ratio{ profile.carb_ratio },
+			autosens_max{ profile.autosens_max },
+			autosens_min{ profile.autosens_min },
+			current_basal_safety_multiplier{ profile.current_basal_safety_multiplier },
+			max_dialy_safety_multiplier{ profile.max_dialy_safety_multiplier },
+			max_iob{ profile.max_iob } { }
+
+	size_t sweep_grid_t::size( ) const noexcept {
+		return extent( target_ranges.size( ) ) * extent( autosens_min.size( ) ) * extent( autosens_max.size( ) ) * extent( current_basal_safety_multiplier.size( ) );
+	}
+
+	profile_variant_t sweep_grid_t::variant( profile_variant_t const & base, size_t index ) const {
+		auto result = base;
+		select( current_basal_safety_multiplier, index, result.current_basal_safety_multiplier );
+		select( autosens_max, index, result.autosens_max );
+		select( autosens_min, index, result.autosens_min );
+		if( !target_ranges.empty( ) ) {
+			auto const & range = target_ranges[index % target_ranges.size( )];
+			result.min_bg = range.min_bg;
+			result.max_bg = range.max_bg;
+			result.target_bg = boost::none;
+		}
+		return result;
+	}
+
+	void sweep_determine_basal( sweep_snapshot_t const & snapshot, profile_variant_t const & base, sweep_grid_t const & grid, sweep_callback_t const & on_results, size_t threads, size_t block_size ) {
+		auto const count = grid.size( );
+		if( threads == 0 ) {
+			threads = std::max( 1u, std::thread::hardware_concurrency( ) );
+		}
+		if( block_size == 0 ) {
+			block_size = std::min( std::max<size_t>( count/(threads*blocks_per_thread), 1 ), max_block_size );
+		}
+		auto const blocks = (count + block_size - 1)/block_size;
+		threads = std::max<size_t>( std::min( threads, blocks ), 1 );
+
+		// idle workers take the next block, so uneven blocks do not leave cores waiting
+		std::atomic<size_t> next_block{ 0 };
+		std::exception_ptr error;
+		std::mutex output_mutex;
+		auto const worker = [&]( ) {
+			try {
+				std::vector<sweep_result_t> results;
+				results.reserve( block_size );
+				for( auto block = next_block++; block < blocks; block = next_block++ ) {
+					auto const first = block * block_size;
+					auto const last = std::min( count, first + block_size );
+					results.clear( );
+					for( auto index = first; index < last; ++index ) {
+						results.push_back( evaluate( snapshot, grid.variant( base, index ), index ) );
+					}
+					std::lock_guard<std::mutex> lock{ output_mutex };
+					on_results( results.data( ), results.size( ) );
+				}
+			} catch( ... ) {
+				std::lock_guard<std::mutex> lock{ output_mutex };
+				if( !error ) {
+					error = std::current_exception( );
+				}
+				next_block = blocks;
+			}
+		};
+		std::vector<std::thread> workers;
+		workers.reserve( threads - 1 );
+		for( size_t n = 1; n < threads; ++n ) {
+			workers.emplace_back( worker );
+		}
+		worker( );
+		for( auto & t: workers ) {
+			t.join( );
+		}
+		if( error ) {
+			std::rethrow_exception( error );
+		}
+	}
+
+	std::vector<sweep_result_t> sweep_determine_basal( sweep_snapshot_t const & snapshot, profile_variant_t const & base, sweep_grid_t const & grid, size_t threads, size_t block_size ) {
+		std::vector<sweep_result_t> result( grid.size( ) );
+		sweep_determine_basal( snapshot, base, grid, [&result]( sweep_result_t const * results, size_t const count ) {
+			std::copy( results, results + count, result.begin( ) + static_cast<std::ptrdiff_t>(results->index) );
+		}, threads, block_size );
+		return result;
+	}
+}    // namespace ns
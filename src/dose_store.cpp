@@ -0,0 +1,161 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016 Darrell Wright
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+#include "dose_store.h"
+#include "iob_calc.h"
+#include "iob_curves.h"
+
+namespace ns {
+	namespace {
+		int32_t to_minutes( dose_store::timestamp_t const & ts ) {
+			using namespace std::chrono;
+			return static_cast<int32_t>(duration_cast<minutes>( ts.time_since_epoch( ) ).count( ));
+		}
+
+		// ages are handed to the batch kernels this many at a time
+		constexpr size_t const chunk_size = 256;
+
+		/// Spare room to leave after growing or trimming, an eighth keeps the columns close to their contents
+		size_t spare_for( size_t const count ) noexcept {
+			return count/8 + 1;
+		}
+
+		template<typename T>
+		void set_capacity( std::vector<T> & values, size_t const capacity ) {
+			std::vector<T> result;
+			result.reserve( capacity );
+			result.assign( values.begin( ), values.end( ) );
+			values.swap( result );
+		}
+	}	// namespace anonymous
+
+	dose_store::columns_t::columns_t( ):
+			amounts{ },
+			times{ } { }
+
+	size_t dose_store::columns_t::size( ) const noexcept {
+		return times.size( );
+	}
+
+	/// Grow by an eighth instead of letting the vectors double
+	void dose_store::columns_t::reserve_for_one( ) {
+		if( times.size( ) < times.capacity( ) ) {
+			return;
+		}
+		auto const capacity = times.size( ) + spare_for( times.size( ) );
+		set_capacity( amounts, capacity );
+		set_capacity( times, capacity );
+	}
+
+	dose_store::dose_store( ):
+			m_curves{ } { }
+
+	void dose_store::push_back( dose const & item ) {
+		auto & curve = m_curves[impl::insulin_duration_to_index( item.dose_dia )];
+		auto const time = to_minutes( item.dose_time );
+		curve.reserve_for_one( );
+		if( curve.times.empty( ) || curve.times.back( ) <= time ) {
+			curve.amounts.push_back( static_cast<float>(item.amount) );
+			curve.times.push_back( time );
+			return;
+		}
+		auto const pos = std::upper_bound( curve.times.begin( ), curve.times.end( ), time );
+		auto const offset = std::distance( curve.times.begin( ), pos );
+		curve.amounts.insert( curve.amounts.begin( ) + offset, static_cast<float>(item.amount) );
+		curve.times.insert( pos, time );
+	}
+
+	void dose_store::expire( timestamp_t const & now ) {
+		auto const now_minutes = to_minutes( now );
+		for( size_t idx = 0; idx < m_curves.size( ); ++idx ) {
+			auto & curve = m_curves[idx];
+			auto const oldest_active = now_minutes - static_cast<int32_t>(impl::insulin_durations[idx]);
+			auto const expired = std::distance( curve.times.begin( ), std::upper_bound( curve.times.begin( ), curve.times.end( ), oldest_active ) );
+			if( expired == 0 ) {
+				continue;
+			}
+			// erasing the prefix moves the live doses once, which on_board reads anyway
+			curve.amounts.erase( curve.amounts.begin( ), curve.amounts.begin( ) + expired );
+			curve.times.erase( curve.times.begin( ), curve.times.begin( ) + expired );
+			auto const count = curve.times.size( );
+			if( curve.times.capacity( ) > count + 2*spare_for( count ) ) {
+				set_capacity( curve.amounts, count + spare_for( count ) );
+				set_capacity( curve.times, count + spare_for( count ) );
+			}
+		}
+	}
+
+	iob_activity_t dose_store::on_board( timestamp_t const & now ) const {
+		auto const now_minutes = to_minutes( now );
+		iob_activity_t result{ 0.0, 0.0 };
+		std::array<double, chunk_size> amounts;
+		std::array<double, chunk_size> ages;
+		std::array<insulin_duration_t, chunk_size> durations;
+		for( size_t idx = 0; idx < m_curves.size( ); ++idx ) {
+			auto const & curve = m_curves[idx];
+			// doses older than the curve are 0, skip them without reading their amounts
+			auto const oldest_active = now_minutes - static_cast<int32_t>(impl::insulin_durations[idx]);
+			auto pos = static_cast<size_t>(std::distance( curve.times.begin( ), std::upper_bound( curve.times.begin( ), curve.times.end( ), oldest_active ) ));
+			durations.fill( impl::insulin_durations[idx] );
+			while( pos < curve.times.size( ) ) {
+				auto const count = std::min( chunk_size, curve.times.size( ) - pos );
+				for( size_t n = 0; n < count; ++n ) {
+					amounts[n] = static_cast<double>(curve.amounts[pos + n]);
+					ages[n] = static_cast<double>(now_minutes - curve.times[pos + n]);
+				}
+				result += insulin_on_board_activity( amounts.data( ), ages.data( ), durations.data( ), count );
+				pos += count;
+			}
+		}
+		return result;
+	}
+
+	size_t dose_store::size( ) const noexcept {
+		size_t result = 0;
+		for( auto const & curve: m_curves ) {
+			result += curve.size( );
+		}
+		return result;
+	}
+
+	size_t dose_store::size( insulin_duration_t const duration ) const noexcept {
+		return m_curves[impl::insulin_duration_to_index( duration )].size( );
+	}
+
+	bool dose_store::empty( ) const noexcept {
+		return size( ) == 0;
+	}
+
+	size_t dose_store::memory_used( ) const noexcept {
+		size_t result = 0;
+		for( auto const & curve: m_curves ) {
+			result += curve.amounts.capacity( ) * sizeof( float ) + curve.times.capacity( ) * sizeof( int32_t );
+		}
+		return result;
+	}
+}	// namespace ns
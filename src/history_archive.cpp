@@ -0,0 +1,241 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016 Darrell Wright
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <algorithm>
+#include <boost/filesystem.hpp>
+#include <boost/iostreams/device/mapped_file.hpp>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "data_types.h"
+#include "history_archive.h"
+#include "lib_iob_history.h"
+
+namespace ns {
+	namespace history_archive {
+		namespace {
+			constexpr char const magic[8] = { 'O', 'R', 'E', 'F', 'H', 'I', 'S', 'T' };
+
+			static_assert( sizeof( record_t ) == 24, "record_t is part of the file format" );
+			static_assert( sizeof( header_t ) == 32, "header_t is part of the file format" );
+
+			std::string index_path( std::string const & path ) {
+				return path + ".idx";
+			}
+
+			int64_t to_ms( timestamp_t const & ts ) {
+				using namespace std::chrono;
+				return duration_cast<milliseconds>( ts.time_since_epoch( ) ).count( );
+			}
+
+			void check_header( header_t const & header ) {
+				if( !std::equal( std::begin( magic ), std::end( magic ), header.magic ) ) {
+					throw std::runtime_error( "Not a pump history archive" );
+				} else if( header.version != current_version || header.record_size != sizeof( record_t ) ) {
+					throw std::runtime_error( "Unsupported pump history archive version" );
+				} else if( header.index_stride == 0 ) {
+					throw std::runtime_error( "Invalid pump history archive index stride" );
+				}
+			}
+		}	// namespace anonymous
+
+		record_t record_t::from_history( lib::iob::pump_history_t const & item ) {
+			record_t result{ };
+			result.time_ms = to_ms( item.timestamp );
+			result.value = item.type == lib::iob::pump_history_types::Bolus ? item.amount : item.rate;
+			result.duration_min = static_cast<int32_t>(item.duration.count( ));
+			result.type = static_cast<uint8_t>(item.type);
+			result.temp_type = static_cast<uint8_t>(item.temp_type);
+			return result;
+		}
+
+		lib::iob::pump_history_t record_t::to_history( ) const {
+			auto const history_type = static_cast<lib::iob::pump_history_types>(type);
+			auto const is_bolus = history_type == lib::iob::pump_history_types::Bolus;
+			return { history_type, timestamp( ), is_bolus ? value : 0.0, is_bolus ? 0.0 : value, static_cast<lib::iob::pump_temp_basal_types>(temp_type), std::chrono::minutes{ duration_min } };
+		}
+
+		timestamp_t record_t::timestamp( ) const {
+			return timestamp_t{ std::chrono::milliseconds{ time_ms } };
+		}
+
+		record_t const * range_t::begin( ) const noexcept {
+			return first;
+		}
+
+		record_t const * range_t::end( ) const noexcept {
+			return last;
+		}
+
+		size_t range_t::size( ) const noexcept {
+			return static_cast<size_t>(last - first);
+		}
+
+		bool range_t::empty( ) const noexcept {
+			return first == last;
+		}
+
+		writer::writer( std::string path, uint32_t const index_stride ):
+				m_path{ std::move( path ) },
+				m_records{ },
+				m_index{ },
+				m_header{ },
+				m_last_time_ms{ std::numeric_limits<int64_t>::min( ) } {
+
+			auto const mode = std::ios::in | std::ios::out | std::ios::binary;
+			if( !boost::filesystem::exists( m_path ) ) {
+				std::copy( std::begin( magic ), std::end( magic ), m_header.magic );
+				m_header.version = current_version;
+				m_header.record_size = sizeof( record_t );
+				m_header.index_stride = index_stride;
+				std::ofstream records{ m_path, std::ios::binary | std::ios::trunc };
+				records.write( reinterpret_cast<char const *>(&m_header), sizeof( m_header ) );
+				std::ofstream index{ index_path( m_path ), std::ios::binary | std::ios::trunc };
+			}
+			m_records.open( m_path, mode );
+			m_index.open( index_path( m_path ), mode );
+			if( !m_records || !m_index ) {
+				throw std::runtime_error( "Could not open pump history archive " + m_path );
+			}
+			m_records.read( reinterpret_cast<char *>(&m_header), sizeof( m_header ) );
+			check_header( m_header );
+			if( m_header.count > 0 ) {
+				record_t last;
+				m_records.seekg( static_cast<std::streamoff>(sizeof( header_t ) + (m_header.count - 1) * sizeof( record_t )) );
+				m_records.read( reinterpret_cast<char *>(&last), sizeof( last ) );
+				m_last_time_ms = last.time_ms;
+			}
+		}
+
+		void writer::append( lib::iob::pump_history_t const * items, size_t const count ) {
+			std::vector<record_t> records;
+			records.reserve( count );
+			for( size_t n = 0; n < count; ++n ) {
+				records.push_back( record_t::from_history( items[n] ) );
+				if( records.back( ).time_ms < (n == 0 ? m_last_time_ms : records[n - 1].time_ms) ) {
+					throw std::runtime_error( "Pump history archive records must be appended in time order" );
+				}
+			}
+			m_records.seekp( static_cast<std::streamoff>(sizeof( header_t ) + m_header.count * sizeof( record_t )) );
+			m_records.write( reinterpret_cast<char const *>(records.data( )), static_cast<std::streamsize>(records.size( ) * sizeof( record_t )) );
+			m_index.seekp( 0, std::ios::end );
+			for( size_t n = 0; n < records.size( ); ++n ) {
+				if( (m_header.count + n) % m_header.index_stride == 0 ) {
+					m_index.write( reinterpret_cast<char const *>(&records[n].time_ms), sizeof( int64_t ) );
+				}
+			}
+			if( !records.empty( ) ) {
+				m_header.count += records.size( );
+				m_last_time_ms = records.back( ).time_ms;
+				m_records.seekp( 0 );
+				m_records.write( reinterpret_cast<char const *>(&m_header), sizeof( m_header ) );
+			}
+			if( !m_records || !m_index ) {
+				throw std::runtime_error( "Error writing pump history archive " + m_path );
+			}
+		}
+
+		void writer::append( std::vector<lib::iob::pump_history_t> const & items ) {
+			append( items.data( ), items.size( ) );
+		}
+
+		void writer::flush( ) {
+			m_records.flush( );
+			m_index.flush( );
+		}
+
+		size_t writer::size( ) const noexcept {
+			return static_cast<size_t>(m_header.count);
+		}
+
+		timestamp_t writer::newest( ) const {
+			return timestamp_t{ std::chrono::milliseconds{ m_last_time_ms } };
+		}
+
+		reader::reader( std::string const & path ):
+				m_records{ path },
+				m_index{ },
+				m_header{ } {
+
+			if( m_records.size( ) < sizeof( header_t ) ) {
+				throw std::runtime_error( "Not a pump history archive" );
+			}
+			std::memcpy( &m_header, m_records.data( ), sizeof( m_header ) );
+			check_header( m_header );
+			if( m_records.size( ) < sizeof( header_t ) + m_header.count * sizeof( record_t ) ) {
+				throw std::runtime_error( "Truncated pump history archive" );
+			}
+			// an empty file cannot be mapped
+			if( boost::filesystem::file_size( index_path( path ) ) > 0 ) {
+				m_index.open( index_path( path ) );
+			}
+		}
+
+		record_t const * reader::records( ) const noexcept {
+			return reinterpret_cast<record_t const *>(m_records.data( ) + sizeof( header_t ));
+		}
+
+		int64_t const * reader::index( ) const noexcept {
+			return reinterpret_cast<int64_t const *>(m_index.data( ));
+		}
+
+		size_t reader::index_size( ) const noexcept {
+			// entries for records written after the header was updated are ignored
+			auto const entries = m_index.is_open( ) ? m_index.size( )/sizeof( int64_t ) : 0;
+			return std::min<size_t>( entries, static_cast<size_t>((m_header.count + m_header.index_stride - 1)/m_header.index_stride) );
+		}
+
+		range_t reader::range( timestamp_t const & t0, timestamp_t const & t1 ) const {
+			auto const first_ms = to_ms( t0 );
+			auto const last_ms = to_ms( t1 );
+			if( last_ms <= first_ms ) {
+				return { records( ), records( ) };
+			}
+			auto const count = size( );
+			auto const stride = static_cast<size_t>(m_header.index_stride);
+			// the block of records holding the first record at or after ms
+			auto const find = [&]( int64_t const ms ) {
+				auto const entries = index( );
+				auto const block = static_cast<size_t>(std::distance( entries, std::lower_bound( entries, entries + index_size( ), ms ) ));
+				auto const from = block == 0 ? 0 : (block - 1) * stride;
+				auto const to = std::min( count, block * stride + 1 );
+				return std::lower_bound( records( ) + from, records( ) + to, ms, []( record_t const & lhs, int64_t const rhs ) {
+					return lhs.time_ms < rhs;
+				} );
+			};
+			return { find( first_ms ), find( last_ms ) };
+		}
+
+		range_t reader::all( ) const noexcept {
+			return { records( ), records( ) + size( ) };
+		}
+
+		size_t reader::size( ) const noexcept {
+			return static_cast<size_t>(m_header.count);
+		}
+	}	// namespace history_archive
+}    // namespace ns
@@ -0,0 +1,333 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016 Darrell Wright
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <stdexcept>
+#include <vector>
+
+#include "iob_accumulator.h"
+#include "iob_calc.h"
+#include "iob_curves.h"
+#include "iob_infusion.h"
+
+namespace ns {
+	namespace {
+		using impl::coefficients;
+
+		intmax_t to_minutes( iob_accumulator::timestamp_t const & ts ) {
+			using namespace std::chrono;
+			return duration_cast<minutes>( ts.time_since_epoch( ) ).count( );
+		}
+
+		double walsh_unclamped( double const t, size_t const slot ) {
+			return ((((coefficients[4][slot] * t + coefficients[3][slot]) * t + coefficients[2][slot]) * t + coefficients[1][slot]) * t + coefficients[0][slot])/100.0;
+		}
+
+		/// iob and activity per unit at each whole minute age of a curve
+		struct curve_weights_t {
+			std::vector<double> iob;
+			std::vector<double> activity;
+			size_t poly_begin;	// ages from here to the end of the curve are on the unclamped polynomial
+
+			explicit curve_weights_t( insulin_duration_t const duration ):
+					iob( static_cast<size_t>(duration) ),
+					activity( static_cast<size_t>(duration) ),
+					poly_begin{ static_cast<size_t>(duration) } {
+
+				for( size_t age = 0; age < iob.size( ); ++age ) {
+					auto const pct = insulin_on_board_activity_pct( static_cast<double>(age), duration );
+					iob[age] = pct.iob;
+					activity[age] = pct.activity;
+				}
+				// age 0 is always fully on board, so it is never part of the polynomial
+				auto const slot = impl::insulin_duration_to_slot( duration );
+				while( poly_begin > 1 ) {
+					auto const value = walsh_unclamped( static_cast<double>(poly_begin - 1), slot );
+					if( value < 0.0 || value > 1.0 ) {
+						break;
+					}
+					--poly_begin;
+				}
+			}
+		};	// curve_weights_t
+
+		std::array<curve_weights_t, 5> const & weights( ) {
+			static std::array<curve_weights_t, 5> const result = { {
+				curve_weights_t{ insulin_duration_t::t180 },
+				curve_weights_t{ insulin_duration_t::t210 },
+				curve_weights_t{ insulin_duration_t::t240 },
+				curve_weights_t{ insulin_duration_t::t300 },
+				curve_weights_t{ insulin_duration_t::t360 } } };
+			return result;
+		}
+
+		intmax_t slot_of( intmax_t const minute, intmax_t const duration ) {
+			return ((minute % duration) + duration) % duration;
+		}
+
+		void add_moments( std::array<double, 5> & moments, double const amount, intmax_t const offset ) {
+			auto power = amount;
+			for( auto & moment: moments ) {
+				moment += power;
+				power *= static_cast<double>(offset);
+			}
+		}
+
+		/// iob and activity of the buckets on the polynomial part of a curve.  With age = t - offset each
+		/// sum of amount * age^j expands binomially into the moments, t is now - origin
+		iob_activity_t from_moments( std::array<double, 5> const & moments, double const t, size_t const slot ) {
+			static constexpr double const binomial[5][5] = { { 1 }, { 1, 1 }, { 1, 2, 1 }, { 1, 3, 3, 1 }, { 1, 4, 6, 4, 1 } };
+			std::array<double, 5> age_sums;
+			for( size_t j = 0; j < age_sums.size( ); ++j ) {
+				double sum = 0.0;
+				double t_power = 1.0;
+				for( auto m = static_cast<intmax_t>(j); m >= 0; --m ) {
+					auto const term = binomial[j][m] * t_power * moments[static_cast<size_t>(m)];
+					sum += m % 2 == 0 ? term : -term;
+					t_power *= t;
+				}
+				age_sums[j] = sum;
+			}
+			iob_activity_t result{ 0.0, 0.0 };
+			for( size_t j = 0; j < age_sums.size( ); ++j ) {
+				result.iob += coefficients[j][slot] * age_sums[j];
+			}
+			// activity is the negated derivative
+			for( size_t j = 1; j < age_sums.size( ); ++j ) {
+				result.activity -= static_cast<double>(j) * coefficients[j][slot] * age_sums[j - 1];
+			}
+			result.iob /= 100.0;
+			result.activity /= 100.0;
+			return result;
+		}
+	}	// namespace anonymous
+
+	iob_accumulator::curve_buckets_t::curve_buckets_t( size_t const duration ):
+			amounts( duration, 0.0 ),
+			active{ 0 },
+			moments{ { 0.0, 0.0, 0.0, 0.0, 0.0 } } { }
+
+	iob_accumulator::iob_accumulator( timestamp_t now ):
+			m_curves{ {
+				curve_buckets_t{ static_cast<size_t>(insulin_duration_t::t180) },
+				curve_buckets_t{ static_cast<size_t>(insulin_duration_t::t210) },
+				curve_buckets_t{ static_cast<size_t>(insulin_duration_t::t240) },
+				curve_buckets_t{ static_cast<size_t>(insulin_duration_t::t300) },
+				curve_buckets_t{ static_cast<size_t>(insulin_duration_t::t360) } } },
+			m_pending{ },
+			m_infusions{ },
+			m_now{ to_minutes( now ) },
+			m_origin{ m_now },
+			m_pending_iob{ 0.0 },
+			m_totals{ 0.0, 0.0 } { }
+
+	void iob_accumulator::add( dose const & item ) {
+		auto const minute = to_minutes( item.dose_time );
+		if( minute > m_now ) {
+			auto const pos = std::upper_bound( m_pending.begin( ), m_pending.end( ), item, []( auto const & lhs, auto const & rhs ) {
+				return lhs.dose_time < rhs.dose_time;
+			} );
+			m_pending.insert( pos, item );
+			m_pending_iob += item.amount;
+			m_totals.iob += item.amount;
+			return;
+		}
+		auto const duration = static_cast<intmax_t>(item.dose_dia);
+		auto const age = m_now - minute;
+		if( age >= duration ) {
+			return;
+		}
+		auto const idx = impl::insulin_duration_to_index( item.dose_dia );
+		auto & curve = m_curves[idx];
+		auto & bucket = curve.amounts[static_cast<size_t>(slot_of( minute, duration ))];
+		if( bucket == 0.0 ) {
+			++curve.active;
+		}
+		bucket += item.amount;
+		if( static_cast<size_t>(age) >= weights( )[idx].poly_begin ) {
+			add_moments( curve.moments, item.amount, minute - m_origin );
+		}
+		m_totals.iob += item.amount * weights( )[idx].iob[static_cast<size_t>(age)];
+		m_totals.activity += item.amount * weights( )[idx].activity[static_cast<size_t>(age)];
+	}
+
+	void iob_accumulator::add( infusion const & item ) {
+		if( !m_infusions.empty( ) ) {
+			auto & last = m_infusions.back( );
+			if( last.end == item.start && last.rate == item.rate && last.dose_dia == item.dose_dia ) {
+				auto const before = insulin_on_board_activity( last, now( ) );
+				last.end = item.end;
+				auto const after = insulin_on_board_activity( last, now( ) );
+				m_totals.iob += after.iob - before.iob;
+				m_totals.activity += after.activity - before.activity;
+				return;
+			}
+		}
+		if( item.expires( ) <= now( ) ) {
+			return;
+		}
+		m_infusions.push_back( item );
+		m_totals += insulin_on_board_activity( item, now( ) );
+	}
+
+	void iob_accumulator::advance( timestamp_t now ) {
+		auto const new_now = to_minutes( now );
+		if( new_now < m_now ) {
+			throw std::runtime_error( "iob_accumulator cannot move backwards in time" );
+		} else if( new_now == m_now ) {
+			return;
+		}
+		for( size_t idx = 0; idx < m_curves.size( ); ++idx ) {
+			auto & curve = m_curves[idx];
+			if( curve.active == 0 ) {
+				continue;
+			}
+			auto const duration = static_cast<intmax_t>(curve.amounts.size( ));
+			if( new_now - m_now >= duration ) {
+				std::fill( curve.amounts.begin( ), curve.amounts.end( ), 0.0 );
+				curve.active = 0;
+				curve.moments.fill( 0.0 );
+				continue;
+			}
+			// buckets that reach the polynomial part of the curve and are not expiring join the moments
+			auto const poly_begin = static_cast<intmax_t>(weights( )[idx].poly_begin);
+			for( auto minute = std::max( m_now - poly_begin + 1, new_now - duration + 1 ); minute <= std::min( new_now - poly_begin, m_now ); ++minute ) {
+				auto const amount = curve.amounts[static_cast<size_t>(slot_of( minute, duration ))];
+				if( amount != 0.0 ) {
+					add_moments( curve.moments, amount, minute - m_origin );
+				}
+			}
+			// the slots that expire are the ones the new minutes map to
+			for( auto minute = m_now + 1; minute <= new_now && curve.active > 0; ++minute ) {
+				auto & bucket = curve.amounts[static_cast<size_t>(slot_of( minute, duration ))];
+				if( bucket != 0.0 ) {
+					auto const given = minute - duration;
+					if( m_now - given >= poly_begin ) {
+						add_moments( curve.moments, -bucket, given - m_origin );
+					}
+					bucket = 0.0;
+					--curve.active;
+				}
+			}
+			if( curve.active == 0 ) {
+				curve.moments.fill( 0.0 );
+			}
+		}
+		m_now = new_now;
+		if( m_now - m_origin >= static_cast<intmax_t>(insulin_duration_t::t360) ) {
+			rebase( );
+		}
+
+		m_infusions.erase( std::remove_if( m_infusions.begin( ), m_infusions.end( ), [&]( auto const & item ) {
+			return item.expires( ) <= this->now( );
+		} ), m_infusions.end( ) );
+
+		auto const last_due = std::find_if( m_pending.begin( ), m_pending.end( ), [&]( auto const & item ) {
+			return to_minutes( item.dose_time ) > m_now;
+		} );
+		std::vector<dose> due{ m_pending.begin( ), last_due };
+		m_pending.erase( m_pending.begin( ), last_due );
+		for( auto const & item: due ) {
+			m_pending_iob -= item.amount;
+			add( item );
+		}
+		if( m_pending.empty( ) ) {
+			m_pending_iob = 0.0;
+		}
+		update_totals( );
+	}
+
+	/// Move the origin to now and rebuild the moments from the rings, which keeps the powers small and drops
+	/// the rounding left by buckets that joined and expired
+	void iob_accumulator::rebase( ) {
+		m_origin = m_now;
+		for( size_t idx = 0; idx < m_curves.size( ); ++idx ) {
+			auto & curve = m_curves[idx];
+			curve.moments.fill( 0.0 );
+			if( curve.active == 0 ) {
+				continue;
+			}
+			auto const duration = static_cast<intmax_t>(curve.amounts.size( ));
+			for( auto age = static_cast<intmax_t>(weights( )[idx].poly_begin); age < duration; ++age ) {
+				auto const minute = m_now - age;
+				auto const amount = curve.amounts[static_cast<size_t>(slot_of( minute, duration ))];
+				if( amount != 0.0 ) {
+					add_moments( curve.moments, amount, minute - m_origin );
+				}
+			}
+		}
+	}
+
+	/// Only the buckets younger than the polynomial part of their curve are visited, the rest come from the moments
+	void iob_accumulator::update_totals( ) {
+		iob_activity_t totals{ m_pending_iob, 0.0 };
+		for( size_t idx = 0; idx < m_curves.size( ); ++idx ) {
+			auto const & curve = m_curves[idx];
+			if( curve.active == 0 ) {
+				continue;
+			}
+			auto const & weight = weights( )[idx];
+			auto const duration = static_cast<intmax_t>(curve.amounts.size( ));
+			for( size_t age = 0; age < weight.poly_begin; ++age ) {
+				auto const amount = curve.amounts[static_cast<size_t>(slot_of( m_now - static_cast<intmax_t>(age), duration ))];
+				totals.iob += amount * weight.iob[age];
+				totals.activity += amount * weight.activity[age];
+			}
+			totals += from_moments( curve.moments, static_cast<double>(m_now - m_origin), impl::insulin_duration_to_slot( impl::insulin_durations[idx] ) );
+		}
+		for( auto const & item: m_infusions ) {
+			totals += insulin_on_board_activity( item, now( ) );
+		}
+		m_totals = totals;
+	}
+
+	iob_accumulator::timestamp_t iob_accumulator::now( ) const {
+		return timestamp_t{ std::chrono::minutes{ m_now } };
+	}
+
+	double iob_accumulator::iob( ) const noexcept {
+		return m_totals.iob;
+	}
+
+	double iob_accumulator::activity( ) const noexcept {
+		return m_totals.activity;
+	}
+
+	iob_activity_t const & iob_accumulator::on_board( ) const noexcept {
+		return m_totals;
+	}
+
+	size_t iob_accumulator::size( ) const noexcept {
+		size_t result = m_pending.size( ) + m_infusions.size( );
+		for( auto const & curve: m_curves ) {
+			result += curve.active;
+		}
+		return result;
+	}
+
+	bool iob_accumulator::empty( ) const noexcept {
+		return size( ) == 0;
+	}
+}	// namespace ns
+
@@ -0,0 +1,173 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016 Darrell Wright
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <exception>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "data_types.h"
+#include "iob_backfill.h"
+#include "lib_iob_history.h"
+#include "lib_iob_total.h"
+#include "tz_cache.h"
+
+namespace ns {
+	namespace lib {
+		namespace iob {
+			namespace {
+				using namespace std::chrono;
+				constexpr hours const chunk_length{ 24 };
+				constexpr insulin_t const temp_bolus_size = 0.05;
+
+				bool record_less( pump_history_t const & lhs, pump_history_t const & rhs ) {
+					return lhs.timestamp < rhs.timestamp;
+				}
+			}	// namespace anonymous
+
+			backfill_t::backfill_t( timestamp_t start_time, minutes step_size, size_t const count ):
+					start{ std::move( start_time ) },
+					step{ std::move( step_size ) },
+					iob( count ),
+					activity( count ),
+					bolussnooze( count ),
+					basaliob( count ),
+					netbasalinsulin( count ),
+					hightempinsulin( count ) { }
+
+			size_t backfill_t::size( ) const noexcept {
+				return iob.size( );
+			}
+
+			timestamp_t backfill_t::time_at( size_t const n ) const {
+				return start + step * static_cast<minutes::rep>(n);
+			}
+
+			std::vector<iob_treatment_t> iob_treatments( temp_treatments_t const & treatments ) {
+				std::vector<iob_treatment_t> result;
+				result.reserve( treatments.boluses.size( ) );
+				for( auto const & bolus: treatments.boluses ) {
+					result.push_back( { bolus.timestamp, bolus.insulin, true } );
+				}
+				for( auto const & piece: treatments.net_basals ) {
+					auto const net = piece.net_insulin( );
+					auto const bolus_count = static_cast<long>(std::round( std::abs( net )/temp_bolus_size ));
+					if( bolus_count == 0 ) {
+						continue;
+					}
+					auto const spacing = (piece.end - piece.start)/bolus_count;
+					auto const size = std::copysign( temp_bolus_size, net );
+					for( long n = 0; n < bolus_count; ++n ) {
+						result.push_back( { piece.start + spacing*n, size, false } );
+					}
+				}
+				std::stable_sort( result.begin( ), result.end( ), []( iob_treatment_t const & lhs, iob_treatment_t const & rhs ) {
+					return lhs.date < rhs.date;
+				} );
+				return result;
+			}
+
+			backfill_t backfill_iob( pump_history_t const * pump_history, size_t const count, std::vector<basal_profile_entry_t> const & basal_profile, tz_cache_t const & tz, double const dia, profile_t const & profile, timestamp_t const & start, timestamp_t const & end, minutes const step, size_t threads ) {
+				if( step <= minutes{ 0 } ) {
+					throw std::runtime_error( "Backfill step must be positive" );
+				}
+				auto const points = end > start ? static_cast<size_t>((end - start + step - nanoseconds{ 1 })/step) : 0;
+				backfill_t result{ start, step, points };
+				if( points == 0 ) {
+					return result;
+				}
+
+				std::vector<pump_history_t> history{ pump_history, pump_history + count };
+				std::stable_sort( history.begin( ), history.end( ), record_less );
+				minutes longest_temp{ 0 };
+				for( auto const & record: history ) {
+					if( record.type == pump_history_types::TempBasalDuration ) {
+						longest_temp = std::max( longest_temp, record.duration );
+					}
+				}
+				auto const before = minutes{ static_cast<minutes::rep>(std::ceil( 60.0 * dia )) } + longest_temp;
+
+				auto const chunk_points = std::max<size_t>( 1, static_cast<size_t>(duration_cast<minutes>( chunk_length )/step) );
+				auto const chunks = (points + chunk_points - 1)/chunk_points;
+
+				auto const process = [&]( size_t const chunk ) {
+					auto const first = chunk * chunk_points;
+					auto const last = std::min( points, first + chunk_points );
+					auto const from = result.time_at( first ) - before;
+					auto const to = result.time_at( last ) + longest_temp;
+					auto const slice_first = std::lower_bound( history.begin( ), history.end( ), pump_history_t{ pump_history_types::Bolus, from, 0, 0, pump_temp_basal_types::Absolute, minutes{ 0 } }, record_less );
+					auto const slice_last = std::upper_bound( slice_first, history.end( ), pump_history_t{ pump_history_types::Bolus, to, 0, 0, pump_temp_basal_types::Absolute, minutes{ 0 } }, record_less );
+					auto const treatments = iob_treatments( calc_temp_treatments( history.data( ) + std::distance( history.begin( ), slice_first ), static_cast<size_t>(std::distance( slice_first, slice_last )), basal_profile, tz ) );
+					for( auto n = first; n < last; ++n ) {
+						auto const total = iob_total( treatments, dia, profile, result.time_at( n ) );
+						result.iob[n] = total.iob;
+						result.activity[n] = total.activity;
+						result.bolussnooze[n] = total.bolussnooze;
+						result.basaliob[n] = total.basaliob.value_or( 0 );
+						result.netbasalinsulin[n] = total.netbasalinsulin.value_or( 0 );
+						result.hightempinsulin[n] = total.hightempinsulin.value_or( 0 );
+					}
+				};
+
+				if( threads == 0 ) {
+					threads = std::max( 1u, std::thread::hardware_concurrency( ) );
+				}
+				threads = std::min( threads, chunks );
+				// chunks write disjoint parts of result, so the order they finish in does not matter
+				std::atomic<size_t> next_chunk{ 0 };
+				std::exception_ptr error;
+				std::mutex error_mutex;
+				auto const worker = [&]( ) {
+					try {
+						for( auto chunk = next_chunk++; chunk < chunks; chunk = next_chunk++ ) {
+							process( chunk );
+						}
+					} catch( ... ) {
+						std::lock_guard<std::mutex> lock{ error_mutex };
+						if( !error ) {
+							error = std::current_exception( );
+						}
+						next_chunk = chunks;
+					}
+				};
+				std::vector<std::thread> workers;
+				workers.reserve( threads - 1 );
+				for( size_t n = 1; n < threads; ++n ) {
+					workers.emplace_back( worker );
+				}
+				worker( );
+				for( auto & t: workers ) {
+					t.join( );
+				}
+				if( error ) {
+					std::rethrow_exception( error );
+				}
+				return result;
+			}
+		}	// namespace iob
+	}	// namespace lib
+}    // namespace ns
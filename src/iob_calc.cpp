@@ -29,22 +29,19 @@
 #include <cstdio>
 #include <iostream>
 
+#if defined( __AVX2__ ) || defined( __SSE2__ )
+#include <immintrin.h>
+#endif
+
 #include <date/date.h>
 
 #include "iob_calc.h"
+#include "iob_curves.h"
 
 namespace ns {
 	namespace {
-		constexpr size_t insulin_duration_to_idx( insulin_duration_t const duration ) {	
-			switch( duration ) {
-				case insulin_duration_t::t180: return 0;
-				case insulin_duration_t::t210: return 1;
-				case insulin_duration_t::t240: return 2;
-				case insulin_duration_t::t300: return 3;
-				case insulin_duration_t::t360: return 4;
-				default: return std::numeric_limits<size_t>::max( );	// should never happen but may as well go for the stars
-			}
-		}
+		using impl::coefficients;
+		using impl::insulin_duration_to_slot;
 
 		template<size_t N>
 			constexpr double to_power( double const & value ) {
@@ -55,29 +52,109 @@ namespace ns {
 				}
 				return result;
 			}
+
+#if defined( __AVX2__ )
+		inline __m256d gather( double const * column, __m128i const slot ) {
+			auto const all = _mm256_castsi256_pd( _mm256_set1_epi64x( -1 ) );
+			return _mm256_mask_i32gather_pd( _mm256_setzero_pd( ), column, slot, all, 8 );
+		}
+
+		/// Evaluate 4 doses starting at pos
+		inline __m256d insulin_on_board_pct4( double const * time_from_bolus_min, insulin_duration_t const * insulin_duration, size_t const pos ) {
+			auto const t = _mm256_loadu_pd( time_from_bolus_min + pos );
+			auto const dur_i32 = _mm_cvtepi16_epi32( _mm_loadl_epi64( reinterpret_cast<__m128i const *>(insulin_duration + pos) ) );
+			auto const dur = _mm256_cvtepi32_pd( dur_i32 );
+			auto const slot = _mm256_cvtpd_epi32( _mm256_mul_pd( _mm256_sub_pd( dur, _mm256_set1_pd( 180.0 ) ), _mm256_set1_pd( 1.0/30.0 ) ) );
+
+			auto result = gather( coefficients[4], slot );
+			result = _mm256_add_pd( _mm256_mul_pd( result, t ), gather( coefficients[3], slot ) );
+			result = _mm256_add_pd( _mm256_mul_pd( result, t ), gather( coefficients[2], slot ) );
+			result = _mm256_add_pd( _mm256_mul_pd( result, t ), gather( coefficients[1], slot ) );
+			result = _mm256_add_pd( _mm256_mul_pd( result, t ), gather( coefficients[0], slot ) );
+			result = _mm256_div_pd( result, _mm256_set1_pd( 100.0 ) );
+
+			// clamp value
+			auto const zero = _mm256_setzero_pd( );
+			auto const one = _mm256_set1_pd( 1.0 );
+			result = _mm256_min_pd( _mm256_max_pd( result, zero ), one );
+			// expired and future/current doses
+			result = _mm256_blendv_pd( result, zero, _mm256_cmp_pd( t, dur, _CMP_GE_OQ ) );
+			result = _mm256_blendv_pd( result, one, _mm256_cmp_pd( t, zero, _CMP_LE_OQ ) );
+			return result;
+		}
+
+		/// Evaluate iob and activity of 4 doses starting at pos.  The derivative is carried along in the Horner loop
+		inline void insulin_on_board_activity_pct4( double const * time_from_bolus_min, insulin_duration_t const * insulin_duration, size_t const pos, __m256d & iob, __m256d & activity ) {
+			auto const t = _mm256_loadu_pd( time_from_bolus_min + pos );
+			auto const dur_i32 = _mm_cvtepi16_epi32( _mm_loadl_epi64( reinterpret_cast<__m128i const *>(insulin_duration + pos) ) );
+			auto const dur = _mm256_cvtepi32_pd( dur_i32 );
+			auto const slot = _mm256_cvtpd_epi32( _mm256_mul_pd( _mm256_sub_pd( dur, _mm256_set1_pd( 180.0 ) ), _mm256_set1_pd( 1.0/30.0 ) ) );
+
+			auto p = gather( coefficients[4], slot );
+			auto d = p;
+			p = _mm256_add_pd( _mm256_mul_pd( p, t ), gather( coefficients[3], slot ) );
+			d = _mm256_add_pd( _mm256_mul_pd( d, t ), p );
+			p = _mm256_add_pd( _mm256_mul_pd( p, t ), gather( coefficients[2], slot ) );
+			d = _mm256_add_pd( _mm256_mul_pd( d, t ), p );
+			p = _mm256_add_pd( _mm256_mul_pd( p, t ), gather( coefficients[1], slot ) );
+			d = _mm256_add_pd( _mm256_mul_pd( d, t ), p );
+			p = _mm256_add_pd( _mm256_mul_pd( p, t ), gather( coefficients[0], slot ) );
+			p = _mm256_div_pd( p, _mm256_set1_pd( 100.0 ) );
+			d = _mm256_div_pd( d, _mm256_set1_pd( -100.0 ) );
+
+			auto const zero = _mm256_setzero_pd( );
+			auto const one = _mm256_set1_pd( 1.0 );
+			auto const expired = _mm256_cmp_pd( t, dur, _CMP_GE_OQ );
+			auto const current = _mm256_cmp_pd( t, zero, _CMP_LE_OQ );
+			// activity only where the curve is not clamped
+			auto const clamped = _mm256_or_pd( _mm256_cmp_pd( p, one, _CMP_GT_OQ ), _mm256_cmp_pd( p, zero, _CMP_LT_OQ ) );
+			iob = _mm256_min_pd( _mm256_max_pd( p, zero ), one );
+			iob = _mm256_blendv_pd( iob, zero, expired );
+			iob = _mm256_blendv_pd( iob, one, current );
+			activity = _mm256_andnot_pd( _mm256_or_pd( clamped, _mm256_or_pd( expired, current ) ), d );
+		}
+#elif defined( __SSE2__ )
+		/// Evaluate 2 doses starting at pos
+		inline __m128d insulin_on_board_pct2( double const * time_from_bolus_min, insulin_duration_t const * insulin_duration, size_t const pos ) {
+			auto const t = _mm_loadu_pd( time_from_bolus_min + pos );
+			auto const s0 = insulin_duration_to_slot( insulin_duration[pos] );
+			auto const s1 = insulin_duration_to_slot( insulin_duration[pos + 1] );
+			auto const dur = _mm_set_pd( static_cast<double>(insulin_duration[pos + 1]), static_cast<double>(insulin_duration[pos]) );
+
+			auto result = _mm_set_pd( coefficients[4][s1], coefficients[4][s0] );
+			result = _mm_add_pd( _mm_mul_pd( result, t ), _mm_set_pd( coefficients[3][s1], coefficients[3][s0] ) );
+			result = _mm_add_pd( _mm_mul_pd( result, t ), _mm_set_pd( coefficients[2][s1], coefficients[2][s0] ) );
+			result = _mm_add_pd( _mm_mul_pd( result, t ), _mm_set_pd( coefficients[1][s1], coefficients[1][s0] ) );
+			result = _mm_add_pd( _mm_mul_pd( result, t ), _mm_set_pd( coefficients[0][s1], coefficients[0][s0] ) );
+			result = _mm_div_pd( result, _mm_set1_pd( 100.0 ) );
+
+			// clamp value
+			auto const zero = _mm_setzero_pd( );
+			auto const one = _mm_set1_pd( 1.0 );
+			result = _mm_min_pd( _mm_max_pd( result, zero ), one );
+			// expired and future/current doses, no blendv in SSE2
+			auto const expired = _mm_cmpge_pd( t, dur );
+			result = _mm_andnot_pd( expired, result );
+			auto const current = _mm_cmple_pd( t, zero );
+			result = _mm_or_pd( _mm_andnot_pd( current, result ), _mm_and_pd( current, one ) );
+			return result;
+		}
+#endif
 	}
 
 	double insulin_on_board_pct( double const time_from_bolus_min, insulin_duration_t const insulin_duration ) {
-		double const params[5][5] = {
-			{  99.951000000,  0.092550000, -0.01759000,  0.000135400, -0.00000032030 },	// t=180
-			{  99.924242424,  0.282046657, -0.01489899,  0.000087168, -0.00000015900 },	// t=210 
-			{  99.950000000, -0.090860000, -0.00551000,  0.000025300, -0.00000003310 },	// t=240
-			{  99.300000000,  0.044900000, -0.00555000,  0.000023200, -0.00000002950 }, // t=300
-			{  99.700000000,  0.063650000, -0.00409500,  0.000014130, -0.00000001493 }	// t=360
-		};
-
 		if( time_from_bolus_min <= 0 ) {
 			return 1.0;
 		} else if( time_from_bolus_min >= static_cast<double>(insulin_duration) ) {
 			return 0.0;
 		} 
-		auto const & param = params[insulin_duration_to_idx( insulin_duration )];
-		auto const p1 = param[1] * time_from_bolus_min;
-		auto const p2 = param[2] * to_power<2>( time_from_bolus_min );
-		auto const p3 = param[3] * to_power<3>( time_from_bolus_min );
-		auto const p4 = param[4] * to_power<4>( time_from_bolus_min );
+		auto const slot = insulin_duration_to_slot( insulin_duration );
+		auto const p1 = coefficients[1][slot] * time_from_bolus_min;
+		auto const p2 = coefficients[2][slot] * to_power<2>( time_from_bolus_min );
+		auto const p3 = coefficients[3][slot] * to_power<3>( time_from_bolus_min );
+		auto const p4 = coefficients[4][slot] * to_power<4>( time_from_bolus_min );
 
-		auto percentage = (p4 + p3 + p2 + p1 + param[0])/100.0;
+		auto percentage = (p4 + p3 + p2 + p1 + coefficients[0][slot])/100.0;
 
 		// clamp value
 		if( percentage > 1.0 ) {
@@ -88,6 +165,124 @@ namespace ns {
 		return percentage;
 	}
 
+	iob_activity_t insulin_on_board_activity_pct( double const time_from_bolus_min, insulin_duration_t const insulin_duration ) {
+		if( time_from_bolus_min <= 0 ) {
+			return { 1.0, 0.0 };
+		} else if( time_from_bolus_min >= static_cast<double>(insulin_duration) ) {
+			return { 0.0, 0.0 };
+		}
+		auto const slot = insulin_duration_to_slot( insulin_duration );
+		auto const & t = time_from_bolus_min;
+		auto p = coefficients[4][slot];
+		auto d = p;
+		p = p * t + coefficients[3][slot];
+		d = d * t + p;
+		p = p * t + coefficients[2][slot];
+		d = d * t + p;
+		p = p * t + coefficients[1][slot];
+		d = d * t + p;
+		p = p * t + coefficients[0][slot];
+
+		auto const percentage = p/100.0;
+		// clamped parts of the curve are flat
+		if( percentage > 1.0 ) {
+			return { 1.0, 0.0 };
+		} else if( percentage < 0.0 ) {
+			return { 0.0, 0.0 };
+		}
+		return { percentage, -d/100.0 };
+	}
+
+	void insulin_on_board_pct( double const * time_from_bolus_min, insulin_duration_t const * insulin_duration, double * results, size_t const count ) {
+		size_t pos = 0;
+#if defined( __AVX2__ )
+		for( ; pos + 4 <= count; pos += 4 ) {
+			_mm256_storeu_pd( results + pos, insulin_on_board_pct4( time_from_bolus_min, insulin_duration, pos ) );
+		}
+#elif defined( __SSE2__ )
+		for( ; pos + 2 <= count; pos += 2 ) {
+			_mm_storeu_pd( results + pos, insulin_on_board_pct2( time_from_bolus_min, insulin_duration, pos ) );
+		}
+#endif
+		for( ; pos < count; ++pos ) {
+			results[pos] = insulin_on_board_pct( time_from_bolus_min[pos], insulin_duration[pos] );
+		}
+	}
+
+	double insulin_on_board( double const * amounts, double const * time_from_bolus_min, insulin_duration_t const * insulin_duration, size_t const count ) {
+		size_t pos = 0;
+		double result = 0.0;
+#if defined( __AVX2__ )
+		auto sum = _mm256_setzero_pd( );
+		for( ; pos + 4 <= count; pos += 4 ) {
+			auto const pct = insulin_on_board_pct4( time_from_bolus_min, insulin_duration, pos );
+			sum = _mm256_add_pd( sum, _mm256_mul_pd( _mm256_loadu_pd( amounts + pos ), pct ) );
+		}
+		alignas( 32 ) double lanes[4];
+		_mm256_store_pd( lanes, sum );
+		result = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+#elif defined( __SSE2__ )
+		auto sum = _mm_setzero_pd( );
+		for( ; pos + 2 <= count; pos += 2 ) {
+			auto const pct = insulin_on_board_pct2( time_from_bolus_min, insulin_duration, pos );
+			sum = _mm_add_pd( sum, _mm_mul_pd( _mm_loadu_pd( amounts + pos ), pct ) );
+		}
+		alignas( 16 ) double lanes[2];
+		_mm_store_pd( lanes, sum );
+		result = lanes[0] + lanes[1];
+#endif
+		for( ; pos < count; ++pos ) {
+			result += amounts[pos] * insulin_on_board_pct( time_from_bolus_min[pos], insulin_duration[pos] );
+		}
+		return result;
+	}
+
+	void insulin_on_board_activity_pct( double const * time_from_bolus_min, insulin_duration_t const * insulin_duration, double * iob_results, double * activity_results, size_t const count ) {
+		size_t pos = 0;
+#if defined( __AVX2__ )
+		for( ; pos + 4 <= count; pos += 4 ) {
+			__m256d iob;
+			__m256d activity;
+			insulin_on_board_activity_pct4( time_from_bolus_min, insulin_duration, pos, iob, activity );
+			_mm256_storeu_pd( iob_results + pos, iob );
+			_mm256_storeu_pd( activity_results + pos, activity );
+		}
+#endif
+		for( ; pos < count; ++pos ) {
+			auto const result = insulin_on_board_activity_pct( time_from_bolus_min[pos], insulin_duration[pos] );
+			iob_results[pos] = result.iob;
+			activity_results[pos] = result.activity;
+		}
+	}
+
+	iob_activity_t insulin_on_board_activity( double const * amounts, double const * time_from_bolus_min, insulin_duration_t const * insulin_duration, size_t const count ) {
+		size_t pos = 0;
+		iob_activity_t result{ 0.0, 0.0 };
+#if defined( __AVX2__ )
+		auto iob_sum = _mm256_setzero_pd( );
+		auto activity_sum = _mm256_setzero_pd( );
+		for( ; pos + 4 <= count; pos += 4 ) {
+			__m256d iob;
+			__m256d activity;
+			insulin_on_board_activity_pct4( time_from_bolus_min, insulin_duration, pos, iob, activity );
+			auto const amount = _mm256_loadu_pd( amounts + pos );
+			iob_sum = _mm256_add_pd( iob_sum, _mm256_mul_pd( amount, iob ) );
+			activity_sum = _mm256_add_pd( activity_sum, _mm256_mul_pd( amount, activity ) );
+		}
+		alignas( 32 ) double lanes[4];
+		_mm256_store_pd( lanes, iob_sum );
+		result.iob = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+		_mm256_store_pd( lanes, activity_sum );
+		result.activity = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+#endif
+		for( ; pos < count; ++pos ) {
+			auto const pct = insulin_on_board_activity_pct( time_from_bolus_min[pos], insulin_duration[pos] );
+			result.iob += amounts[pos] * pct.iob;
+			result.activity += amounts[pos] * pct.activity;
+		}
+		return result;
+	}
+
 	dose::dose( double how_much, insulin_duration_t dia, timestamp_t when ):
 			amount{ how_much },
 			dose_time{ when },
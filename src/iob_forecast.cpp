@@ -0,0 +1,101 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016 Darrell Wright
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <stdexcept>
+#include <vector>
+
+#include "iob_calc.h"
+#include "iob_forecast.h"
+#include "iob_infusion.h"
+
+namespace ns {
+	iob_forecast_t::iob_forecast_t( timestamp_t start_time, std::chrono::minutes step_size, size_t const count ):
+			start{ start_time },
+			step{ step_size },
+			iob( count, 0.0 ),
+			activity( count, 0.0 ) { }
+
+	size_t iob_forecast_t::size( ) const noexcept {
+		return iob.size( );
+	}
+
+	iob_forecast_t::timestamp_t iob_forecast_t::time_at( size_t const n ) const {
+		return start + step * static_cast<intmax_t>(n);
+	}
+
+	iob_forecast_t forecast_iob( dose const * doses, size_t const dose_count, infusion const * infusions, size_t const infusion_count, iob_forecast_t::timestamp_t const & start, std::chrono::minutes const horizon, std::chrono::minutes const step ) {
+		using namespace std::chrono;
+		if( step.count( ) <= 0 ) {
+			throw std::runtime_error( "forecast step must be positive" );
+		}
+		auto const count = static_cast<size_t>(std::max<intmax_t>( horizon.count( )/step.count( ), 0 ));
+		iob_forecast_t result{ start, step, count };
+		auto const step_min = static_cast<double>(step.count( ));
+
+		// scratch for one dose
+		std::vector<double> ages( count );
+		std::vector<insulin_duration_t> dias( count );
+		std::vector<double> iob( count );
+		std::vector<double> activity( count );
+
+		for( size_t n=0; n<dose_count; ++n ) {
+			auto const & item = doses[n];
+			auto const first_age = duration<double, minutes::period>( start - item.dose_time ).count( );
+			auto const dia = static_cast<double>(item.dose_dia);
+			if( first_age >= dia ) {
+				continue;
+			}
+			// only the points before the dose expires contribute
+			auto const active = std::min( count, static_cast<size_t>(std::ceil( (dia - first_age)/step_min )) );
+			for( size_t k=0; k<active; ++k ) {
+				ages[k] = first_age + static_cast<double>(k) * step_min;
+			}
+			std::fill( dias.begin( ), dias.begin( ) + static_cast<intmax_t>(active), item.dose_dia );
+			insulin_on_board_activity_pct( ages.data( ), dias.data( ), iob.data( ), activity.data( ), active );
+			for( size_t k=0; k<active; ++k ) {
+				result.iob[k] += item.amount * iob[k];
+				result.activity[k] += item.amount * activity[k];
+			}
+		}
+
+		for( size_t n=0; n<infusion_count; ++n ) {
+			auto const & item = infusions[n];
+			for( size_t k=0; k<count; ++k ) {
+				auto const when = result.time_at( k );
+				if( when >= item.expires( ) ) {
+					break;
+				}
+				auto const on_board = insulin_on_board_activity( item, when );
+				result.iob[k] += on_board.iob;
+				result.activity[k] += on_board.activity;
+			}
+		}
+		return result;
+	}
+
+	iob_forecast_t forecast_iob( std::vector<dose> const & doses, std::vector<infusion> const & infusions, iob_forecast_t::timestamp_t const & start, std::chrono::minutes const horizon, std::chrono::minutes const step ) {
+		return forecast_iob( doses.data( ), doses.size( ), infusions.data( ), infusions.size( ), start, horizon, step );
+	}
+}	// namespace ns
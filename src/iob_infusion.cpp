@@ -0,0 +1,164 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016 Darrell Wright
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <chrono>
+#include <vector>
+
+#include "iob_calc.h"
+#include "iob_curves.h"
+#include "iob_infusion.h"
+
+namespace ns {
+	namespace {
+		using impl::coefficients;
+
+		/// Antiderivative of the unclamped curve, as a fraction
+		double walsh_integral( double const t, size_t const slot ) {
+			auto const result = ((((coefficients[4][slot]/5.0 * t + coefficients[3][slot]/4.0) * t + coefficients[2][slot]/3.0) * t + coefficients[1][slot]/2.0) * t + coefficients[0][slot]) * t;
+			return result/100.0;
+		}
+
+		double walsh_unclamped( double const t, size_t const slot ) {
+			return ((((coefficients[4][slot] * t + coefficients[3][slot]) * t + coefficients[2][slot]) * t + coefficients[1][slot]) * t + coefficients[0][slot])/100.0;
+		}
+
+		/// Parts of a curve that are either the polynomial or clamped to 0/1
+		struct curve_piece_t {
+			double begin;
+			double end;
+			double level;	// value when clamped
+			bool clamped;
+		};	// curve_piece_t
+
+		int clamp_state( double const t, size_t const slot ) {
+			auto const value = walsh_unclamped( t, slot );
+			return value > 1.0 ? 2 : (value < 0.0 ? 0 : 1);
+		}
+
+		std::vector<curve_piece_t> make_pieces( insulin_duration_t const duration ) {
+			auto const slot = impl::insulin_duration_to_slot( duration );
+			auto const last = static_cast<double>(duration);
+			double const step = 0.25;
+			std::vector<curve_piece_t> result;
+			double begin = 0.0;
+			auto state = clamp_state( 0.0, slot );
+			auto const close = [&]( double const end ) {
+				result.push_back( { begin, end, state == 2 ? 1.0 : 0.0, state != 1 } );
+			};
+			for( double t = step; t <= last; t += step ) {
+				auto const next_state = clamp_state( t, slot );
+				if( next_state == state ) {
+					continue;
+				}
+				// crossing is between t - step and t
+				double lo = t - step;
+				double hi = t;
+				for( size_t n=0; n<40; ++n ) {
+					auto const mid = (lo + hi)/2.0;
+					if( clamp_state( mid, slot ) == state ) {
+						lo = mid;
+					} else {
+						hi = mid;
+					}
+				}
+				close( hi );
+				begin = hi;
+				state = next_state;
+			}
+			close( last );
+			return result;
+		}
+
+		std::vector<curve_piece_t> const & pieces( insulin_duration_t const duration ) {
+			static std::array<std::vector<curve_piece_t>, 5> const result = { {
+				make_pieces( insulin_duration_t::t180 ),
+				make_pieces( insulin_duration_t::t210 ),
+				make_pieces( insulin_duration_t::t240 ),
+				make_pieces( insulin_duration_t::t300 ),
+				make_pieces( insulin_duration_t::t360 ) } };
+			return result[impl::insulin_duration_to_index( duration )];
+		}
+
+		double to_minutes( std::chrono::system_clock::duration const & value ) {
+			return std::chrono::duration<double, std::chrono::minutes::period>( value ).count( );
+		}
+	}	// namespace anonymous
+
+	infusion::infusion( double rate_per_hr, timestamp_t start_time, timestamp_t end_time, insulin_duration_t dia ):
+			rate{ rate_per_hr },
+			start{ start_time },
+			end{ end_time },
+			dose_dia{ dia } {
+
+		assert( rate >= 0.0 );
+		assert( start <= end );
+	}
+
+	double infusion::amount( ) const {
+		return rate * to_minutes( end - start )/60.0;
+	}
+
+	infusion::timestamp_t infusion::expires( ) const {
+		return end + std::chrono::minutes{ static_cast<intmax_t>(dose_dia) };
+	}
+
+	double insulin_on_board_pct_integral( double from_age_min, double to_age_min, insulin_duration_t const insulin_duration ) {
+		from_age_min = std::max( from_age_min, 0.0 );
+		to_age_min = std::min( to_age_min, static_cast<double>(insulin_duration) );
+		if( from_age_min >= to_age_min ) {
+			return 0.0;
+		}
+		auto const slot = impl::insulin_duration_to_slot( insulin_duration );
+		double result = 0.0;
+		for( auto const & piece: pieces( insulin_duration ) ) {
+			auto const lo = std::max( from_age_min, piece.begin );
+			auto const hi = std::min( to_age_min, piece.end );
+			if( lo >= hi ) {
+				continue;
+			}
+			if( piece.clamped ) {
+				result += piece.level * (hi - lo);
+			} else {
+				result += walsh_integral( hi, slot ) - walsh_integral( lo, slot );
+			}
+		}
+		return result;
+	}
+
+	iob_activity_t insulin_on_board_activity( infusion const & item, infusion::timestamp_t const & now ) {
+		auto const duration = static_cast<double>(item.dose_dia);
+		// ages of the newest and oldest insulin delivered so far
+		auto const newest = std::max( to_minutes( now - item.end ), 0.0 );
+		auto const oldest = std::min( to_minutes( now - item.start ), duration );
+		if( newest >= oldest ) {
+			return { 0.0, 0.0 };
+		}
+		auto const rate_per_min = item.rate/60.0;
+		// activity is the negated slope of the curve, so its integral is the drop across the ages.  The
+		// endpoints use insulin_on_board_pct, all of it on board at age 0 and none at age >= duration
+		return { rate_per_min * insulin_on_board_pct_integral( newest, oldest, item.dose_dia ),
+			rate_per_min * (insulin_on_board_pct( newest, item.dose_dia ) - insulin_on_board_pct( oldest, item.dose_dia )) };
+	}
+}	// namespace ns
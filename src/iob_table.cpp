@@ -0,0 +1,98 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016 Darrell Wright
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <cstddef>
+#include <cstdint>
+
+#include "iob_calc.h"
+#include "iob_curves.h"
+#include "iob_table.h"
+
+namespace ns {
+	namespace iob_table {
+		namespace {
+			// one entry per minute from 0 to duration inclusive for each curve
+			constexpr size_t const table_offsets[7] = { 0, 181, 392, 0, 633, 0, 934 };
+			constexpr size_t const table_entries = 181 + 211 + 241 + 301 + 361;
+
+			struct tables_t {
+				float values[table_entries];
+
+				constexpr tables_t( ): values{ } {
+					for( auto const duration: impl::insulin_durations ) {
+						auto const slot = impl::insulin_duration_to_slot( duration );
+						auto const last = static_cast<intmax_t>(duration);
+						// age 0 and age duration hold the limits of the curve so interpolation next to them is
+						// not pulled toward the 1.0/0.0 special cases
+						for( intmax_t age = 0; age <= last; ++age ) {
+							values[table_offsets[slot] + static_cast<size_t>(age)] = static_cast<float>(impl::walsh_pct( static_cast<double>(age), slot ));
+						}
+					}
+				}
+			};	// tables_t
+
+			constexpr tables_t const tables{ };
+		}	// namespace anonymous
+
+		double insulin_on_board_pct( double const time_from_bolus_min, insulin_duration_t const insulin_duration ) {
+			if( time_from_bolus_min <= 0 ) {
+				return 1.0;
+			} else if( time_from_bolus_min >= static_cast<double>(insulin_duration) ) {
+				return 0.0;
+			}
+			auto const row = tables.values + table_offsets[impl::insulin_duration_to_slot( insulin_duration )];
+			auto const age = static_cast<size_t>(time_from_bolus_min);
+			auto const fraction = time_from_bolus_min - static_cast<double>(age);
+			double const lower = row[age];
+			double const upper = row[age + 1];
+			return lower + (upper - lower) * fraction;
+		}
+
+		double insulin_on_board_pct_minutes( intmax_t const time_from_bolus_min, insulin_duration_t const insulin_duration ) {
+			if( time_from_bolus_min <= 0 ) {
+				return 1.0;
+			} else if( time_from_bolus_min >= static_cast<intmax_t>(insulin_duration) ) {
+				return 0.0;
+			}
+			return tables.values[table_offsets[impl::insulin_duration_to_slot( insulin_duration )] + static_cast<size_t>(time_from_bolus_min)];
+		}
+
+		void insulin_on_board_pct( double const * time_from_bolus_min, insulin_duration_t const * insulin_duration, double * results, size_t const count ) {
+			for( size_t pos = 0; pos < count; ++pos ) {
+				results[pos] = iob_table::insulin_on_board_pct( time_from_bolus_min[pos], insulin_duration[pos] );
+			}
+		}
+
+		double insulin_on_board( double const * amounts, double const * time_from_bolus_min, insulin_duration_t const * insulin_duration, size_t const count ) {
+			double result = 0.0;
+			for( size_t pos = 0; pos < count; ++pos ) {
+				result += amounts[pos] * iob_table::insulin_on_board_pct( time_from_bolus_min[pos], insulin_duration[pos] );
+			}
+			return result;
+		}
+
+		size_t table_size( ) {
+			return sizeof( tables );
+		}
+	}	// namespace iob_table
+}	// namespace ns
+
@@ -0,0 +1,245 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016 Darrell Wright
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <complex>
+#include <stdexcept>
+#include <vector>
+
+#include "iob_calc.h"
+#include "iob_curves.h"
+#include "iob_infusion.h"
+#include "iob_timeline.h"
+
+namespace ns {
+	namespace {
+		using cplx_t = std::complex<double>;
+
+		/// In place iterative radix-2 FFT, values.size( ) must be a power of 2
+		void fft( std::vector<cplx_t> & values, bool const inverse ) {
+			auto const size = values.size( );
+			for( size_t i = 1, j = 0; i < size; ++i ) {
+				auto bit = size >> 1;
+				for( ; j & bit; bit >>= 1 ) {
+					j ^= bit;
+				}
+				j ^= bit;
+				if( i < j ) {
+					std::swap( values[i], values[j] );
+				}
+			}
+			auto const pi = std::acos( -1.0 );
+			std::vector<cplx_t> twiddles( size/2 );
+			for( size_t k = 0; k < twiddles.size( ); ++k ) {
+				auto const angle = 2.0 * pi * static_cast<double>(k) / static_cast<double>(size) * (inverse ? 1.0 : -1.0);
+				twiddles[k] = cplx_t{ std::cos( angle ), std::sin( angle ) };
+			}
+			for( size_t len = 2; len <= size; len <<= 1 ) {
+				auto const half = len/2;
+				auto const stride = size/len;
+				for( size_t i = 0; i < size; i += len ) {
+					for( size_t k = 0; k < half; ++k ) {
+						// plain multiply, std::complex's operator* checks for inf/nan
+						auto const & w = twiddles[k * stride];
+						auto const & x = values[i + k + half];
+						cplx_t const v{ x.real( ) * w.real( ) - x.imag( ) * w.imag( ), x.real( ) * w.imag( ) + x.imag( ) * w.real( ) };
+						auto const u = values[i + k];
+						values[i + k] = u + v;
+						values[i + k + half] = u - v;
+					}
+				}
+			}
+			if( inverse ) {
+				for( auto & value: values ) {
+					value /= static_cast<double>(size);
+				}
+			}
+		}
+
+		size_t fft_size( size_t const count ) {
+			size_t result = 1;
+			while( result < count ) {
+				result <<= 1;
+			}
+			return result;
+		}
+
+		bool use_fft( size_t const signal_size, size_t const used_bins, size_t const kernel_size, convolution_method_t const method ) {
+			switch( method ) {
+			case convolution_method_t::direct:
+				return false;
+			case convolution_method_t::fft:
+				return true;
+			case convolution_method_t::automatic:
+			default:
+				auto const size = static_cast<double>(fft_size( signal_size + kernel_size - 1 ));
+				// three transforms against a multiply-add per tap of each non-empty bin.  A butterfly costs about
+				// 30 vectorized multiply-adds
+				return static_cast<double>(used_bins * kernel_size) > 3.0 * 30.0 * size/2.0 * std::log2( size );
+			}
+		}
+
+		/// Adds the convolution of bins with the iob and activity kernels to iob and activity
+		void convolve( std::vector<double> const & bins, std::vector<double> const & iob_kernel, std::vector<double> const & activity_kernel, std::vector<double> & iob, std::vector<double> & activity, convolution_method_t const method ) {
+			auto const count = bins.size( );
+			auto const taps = iob_kernel.size( );
+			auto const used_bins = static_cast<size_t>(std::count_if( bins.begin( ), bins.end( ), []( double const value ) {
+				return value != 0.0;
+			} ));
+			if( !use_fft( count, used_bins, taps, method ) ) {
+				for( size_t n = 0; n < count; ++n ) {
+					if( bins[n] == 0.0 ) {
+						continue;
+					}
+					auto const last = std::min( taps, count - n );
+					for( size_t k = 0; k < last; ++k ) {
+						iob[n + k] += bins[n] * iob_kernel[k];
+						activity[n + k] += bins[n] * activity_kernel[k];
+					}
+				}
+				return;
+			}
+			// the bins are real, so one complex kernel carries iob in the real part and activity in the imaginary
+			auto const size = fft_size( count + taps - 1 );
+			std::vector<cplx_t> signal( size );
+			std::vector<cplx_t> kernel( size );
+			for( size_t n = 0; n < count; ++n ) {
+				signal[n] = bins[n];
+			}
+			for( size_t k = 0; k < taps; ++k ) {
+				kernel[k] = cplx_t{ iob_kernel[k], activity_kernel[k] };
+			}
+			fft( signal, false );
+			fft( kernel, false );
+			for( size_t n = 0; n < size; ++n ) {
+				signal[n] *= kernel[n];
+			}
+			fft( signal, true );
+			for( size_t n = 0; n < count; ++n ) {
+				iob[n] += signal[n].real( );
+				activity[n] += signal[n].imag( );
+			}
+		}
+
+		intmax_t step_count( std::chrono::system_clock::duration const & value, std::chrono::minutes const step, bool const round_up ) {
+			using namespace std::chrono;
+			auto const steps = duration<double, minutes::period>( value ).count( )/static_cast<double>(step.count( ));
+			return static_cast<intmax_t>(round_up ? std::ceil( steps ) : std::floor( steps ));
+		}
+	}	// namespace anonymous
+
+	iob_timeline_t iob_timeline( dose const * doses, size_t const dose_count, infusion const * infusions, size_t const infusion_count, iob_timeline_t::timestamp_t const & start, iob_timeline_t::timestamp_t const & end, std::chrono::minutes const step, convolution_method_t const method ) {
+		using namespace std::chrono;
+		if( step.count( ) <= 0 ) {
+			throw std::runtime_error( "timeline step must be positive" );
+		}
+		if( end < start ) {
+			throw std::runtime_error( "timeline end is before start" );
+		}
+		auto const count = static_cast<size_t>(step_count( end - start, step, false )) + 1;
+		iob_timeline_t result{ start, step, count };
+
+		// the grid starts early enough to hold the tail of the longest curve
+		auto const lead = static_cast<size_t>(step_count( minutes{ static_cast<intmax_t>(insulin_duration_t::t360) }, step, true ));
+		auto const grid_start = start - step * static_cast<intmax_t>(lead);
+		auto const grid_size = lead + count;
+		auto const step_min = static_cast<double>(step.count( ));
+
+		// doses and infusions are convolved with different kernels
+		std::array<std::vector<double>, 5> dose_bins;
+		std::array<std::vector<double>, 5> infusion_bins;
+		auto const bins_for = [&]( std::array<std::vector<double>, 5> & bins, insulin_duration_t const duration ) -> std::vector<double> & {
+			auto & curve_bins = bins[impl::insulin_duration_to_index( duration )];
+			if( curve_bins.empty( ) ) {
+				curve_bins.resize( grid_size, 0.0 );
+			}
+			return curve_bins;
+		};
+
+		for( size_t n = 0; n < dose_count; ++n ) {
+			auto const & item = doses[n];
+			auto const pos = step_count( item.dose_time - grid_start, step, true );
+			if( pos < 0 || pos >= static_cast<intmax_t>(grid_size) ) {
+				continue;
+			}
+			bins_for( dose_bins, item.dose_dia )[static_cast<size_t>(pos)] += item.amount;
+		}
+
+		for( size_t n = 0; n < infusion_count; ++n ) {
+			auto const & item = infusions[n];
+			auto const first = std::max<intmax_t>( step_count( item.start - grid_start, step, false ), 0 );
+			auto const last = std::min<intmax_t>( step_count( item.end - grid_start, step, true ), static_cast<intmax_t>(grid_size) - 1 );
+			if( first > last ) {
+				continue;
+			}
+			auto & curve_bins = bins_for( infusion_bins, item.dose_dia );
+			// each point gets what was delivered in the step leading up to it
+			for( auto pos = first + 1; pos <= last; ++pos ) {
+				auto const point = grid_start + step * pos;
+				auto const from = std::max( point - step, item.start );
+				auto const to = std::min( point, item.end );
+				if( to > from ) {
+					curve_bins[static_cast<size_t>(pos)] += item.rate * duration<double, minutes::period>( to - from ).count( )/60.0;
+				}
+			}
+		}
+
+		std::vector<double> iob( grid_size, 0.0 );
+		std::vector<double> activity( grid_size, 0.0 );
+		for( auto const duration: impl::insulin_durations ) {
+			auto const idx = impl::insulin_duration_to_index( duration );
+			auto const dia = static_cast<double>(duration);
+			auto const taps = static_cast<size_t>(step_count( minutes{ static_cast<intmax_t>(duration) }, step, true ));
+			std::vector<double> iob_kernel( taps );
+			std::vector<double> activity_kernel( taps );
+			if( !dose_bins[idx].empty( ) ) {
+				for( size_t k = 0; k < taps; ++k ) {
+					auto const pct = insulin_on_board_activity_pct( static_cast<double>(k) * step_min, duration );
+					iob_kernel[k] = pct.iob;
+					activity_kernel[k] = pct.activity;
+				}
+				convolve( dose_bins[idx], iob_kernel, activity_kernel, iob, activity, method );
+			}
+			if( !infusion_bins[idx].empty( ) ) {
+				// a step's delivery has ages [k*step, (k + 1)*step] k points later, so the kernel is the curve
+				// averaged over that range
+				for( size_t k = 0; k < taps; ++k ) {
+					auto const from = static_cast<double>(k) * step_min;
+					auto const to = std::min( from + step_min, dia );
+					iob_kernel[k] = insulin_on_board_pct_integral( from, to, duration )/step_min;
+					activity_kernel[k] = (insulin_on_board_pct( from, duration ) - insulin_on_board_pct( to, duration ))/step_min;
+				}
+				convolve( infusion_bins[idx], iob_kernel, activity_kernel, iob, activity, method );
+			}
+		}
+		std::copy( iob.begin( ) + static_cast<intmax_t>(lead), iob.end( ), result.iob.begin( ) );
+		std::copy( activity.begin( ) + static_cast<intmax_t>(lead), activity.end( ), result.activity.begin( ) );
+		return result;
+	}
+
+	iob_timeline_t iob_timeline( std::vector<dose> const & doses, std::vector<infusion> const & infusions, iob_timeline_t::timestamp_t const & start, iob_timeline_t::timestamp_t const & end, std::chrono::minutes const step, convolution_method_t const method ) {
+		return iob_timeline( doses.data( ), doses.size( ), infusions.data( ), infusions.size( ), start, end, step, method );
+	}
+}	// namespace ns
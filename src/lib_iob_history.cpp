@@ -20,9 +20,138 @@
 // OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 // SOFTWARE.
 
+#include <algorithm>
+#include <chrono>
+#include <stdexcept>
+#include <vector>
+
+#include "data_types.h"
 #include "lib_iob_history.h"
+#include "stage_latency.h"
+#include "tz_cache.h"
 
 namespace ns {
+	namespace lib {
+		namespace iob {
+			namespace {
+				using namespace std::chrono;
+				constexpr minutes const minutes_per_day{ 24*60 };
 
-}    // namespace ns
+				/// Calls func( start, end, scheduled_rate ) for each part of [start, end) under one scheduled rate
+				template<typename Function>
+				void for_each_scheduled( timestamp_t const & start, timestamp_t const & end, std::vector<basal_profile_entry_t> const & basal_profile, tz_cache_t const & tz, Function func ) {
+					// walk the schedule in local time so days and rate changes stay on the wall clock across DST
+					auto const local_start = duration_cast<minutes>( tz.to_local( start ) );
+					auto day = local_start - (local_start % minutes_per_day);
+					auto const minute_of_day = local_start - day;
+					// entry in effect at start, then walk the schedule forward wrapping at midnight
+					auto entry = static_cast<size_t>(std::distance( basal_profile.begin( ), std::upper_bound( basal_profile.begin( ), basal_profile.end( ), minute_of_day, []( minutes const & lhs, basal_profile_entry_t const & rhs ) {
+						return lhs < rhs.start;
+					} ) )) - 1;
+					auto piece_start = start;
+					while( piece_start < end ) {
+						auto const next_entry = entry + 1;
+						auto const next_change = tz.from_local( next_entry < basal_profile.size( ) ? day + basal_profile[next_entry].start : day + minutes_per_day );
+						auto const piece_end = std::min( end, std::max( piece_start, next_change ) );
+						if( piece_start < piece_end ) {
+							func( piece_start, piece_end, basal_profile[entry].rate );
+						}
+						piece_start = piece_end;
+						if( next_entry < basal_profile.size( ) ) {
+							entry = next_entry;
+						} else {
+							entry = 0;
+							day += minutes_per_day;
+						}
+					}
+				}
+			}	// namespace anonymous
+
+			size_t split_temp_basal( temp_basal_t const & temp, std::vector<basal_profile_entry_t> const & basal_profile, tz_cache_t const & tz, std::vector<net_basal_t> & out ) {
+				size_t result = 0;
+				for_each_scheduled( temp.start, temp.end, basal_profile, tz, [&]( timestamp_t const & start, timestamp_t const & end, insulin_t const & scheduled_rate ) {
+					out.push_back( { start, end, temp.rate, scheduled_rate } );
+					++result;
+				} );
+				return result;
+			}
+
+			size_t split_temp_basal( temp_basal_t const & temp, std::vector<basal_profile_entry_t> const & basal_profile, seconds const tz_offset, std::vector<net_basal_t> & out ) {
+				return split_temp_basal( temp, basal_profile, tz_cache_t{ tz_offset }, out );
+			}
+
+			insulin_t net_basal_t::net_rate( ) const noexcept {
+				return rate - scheduled_rate;
+			}
+
+			insulin_t net_basal_t::net_insulin( ) const {
+				return net_rate( ) * duration<double, hours::period>( end - start ).count( );
+			}
 
+			temp_treatments_t calc_temp_treatments( pump_history_t const * pump_history, size_t const count, std::vector<basal_profile_entry_t> const & basal_profile, tz_cache_t const & tz ) {
+				latency::scoped_timer_t const timer{ latency::stage_t::calc_temp_treatments };
+				if( basal_profile.empty( ) || basal_profile.front( ).start != minutes{ 0 } ) {
+					throw std::runtime_error( "Basal profile must start at midnight" );
+				}
+				temp_treatments_t result;
+				result.boluses.reserve( count );
+				result.temp_basals.reserve( count/2 );
+
+				// the TempBasal or TempBasalDuration waiting for its other half
+				pump_history_t const * pending = nullptr;
+				for( size_t i = 0; i < count; ++i ) {
+					auto const & current = pump_history[i];
+					switch( current.type ) {
+					case pump_history_types::Bolus:
+						result.boluses.emplace_back( current.timestamp, current.amount );
+						pending = nullptr;
+						break;
+					case pump_history_types::TempBasal:
+					case pump_history_types::TempBasalDuration:
+						if( pending && pending->type != current.type && pending->timestamp == current.timestamp ) {
+							auto const & temp = current.type == pump_history_types::TempBasal ? current : *pending;
+							auto const & temp_duration = current.type == pump_history_types::TempBasal ? *pending : current;
+							if( temp.temp_type == pump_temp_basal_types::Absolute ) {
+								result.temp_basals.push_back( { temp.timestamp, temp.timestamp + temp_duration.duration, temp.rate } );
+							}
+							pending = nullptr;
+						} else {
+							pending = &current;
+						}
+						break;
+					}
+				}
+
+				// pump history is newest first, so this is usually a reverse
+				auto const sort_by_time = []( auto & values, auto compare ) {
+					if( std::is_sorted( values.rbegin( ), values.rend( ), compare ) ) {
+						std::reverse( values.begin( ), values.end( ) );
+					} else if( !std::is_sorted( values.begin( ), values.end( ), compare ) ) {
+						std::stable_sort( values.begin( ), values.end( ), compare );
+					}
+				};
+				sort_by_time( result.boluses, []( temp_bolus_t const & lhs, temp_bolus_t const & rhs ) {
+					return lhs.timestamp < rhs.timestamp;
+				} );
+				auto & temps = result.temp_basals;
+				sort_by_time( temps, []( temp_basal_t const & lhs, temp_basal_t const & rhs ) {
+					return lhs.start < rhs.start;
+				} );
+				for( size_t n = 0; n + 1 < temps.size( ); ++n ) {
+					temps[n].end = std::min( temps[n].end, temps[n + 1].start );
+				}
+
+				// most temps cross at most one schedule change, so the schedule is walked once
+				result.net_basals.reserve( temps.size( ) * 2 );
+				for( auto const & temp: temps ) {
+					split_temp_basal( temp, basal_profile, tz, result.net_basals );
+				}
+				return result;
+			}
+
+			temp_treatments_t calc_temp_treatments( pump_history_t const * pump_history, size_t const count, std::vector<basal_profile_entry_t> const & basal_profile, seconds const tz_offset ) {
+				return calc_temp_treatments( pump_history, count, basal_profile, tz_cache_t{ tz_offset } );
+			}
+		}	// namespace iob
+	}	// namespace lib
+}    // namespace ns
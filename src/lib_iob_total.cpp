@@ -0,0 +1,183 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016 Darrell Wright
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <algorithm>
+#include <boost/functional/hash.hpp>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+#include "data_types.h"
+#include "lib_iob_calculate.h"
+#include "lib_iob_total.h"
+#include "stage_latency.h"
+
+namespace ns {
+	namespace {
+		struct iob_window_t {
+			iob_treatment_t const * first;
+			iob_treatment_t const * last;
+		};	// iob_window_t
+
+		/// The treatments that contribute at now
+		iob_window_t active_treatments( iob_treatment_t const * treatments, size_t const count, double const dia, timestamp_t const & now ) {
+			using namespace std::chrono;
+			// iobCalc truncates the age to whole minutes, anything at or before cutoff has left the board
+			auto const cutoff = now - minutes{ static_cast<minutes::rep>(std::ceil( 60.0 * dia )) };
+			auto const last = treatments + count;
+			auto const first = std::upper_bound( treatments, last, cutoff, []( timestamp_t const & lhs, iob_treatment_t const & rhs ) {
+				return lhs < rhs.date;
+			} );
+			return { first, std::upper_bound( first, last, now, []( timestamp_t const & lhs, iob_treatment_t const & rhs ) {
+				return lhs < rhs.date;
+			} ) };
+		}
+
+		iob_totals_t sum_treatments( iob_window_t const & window, double const dia, profile_t const & profile, timestamp_t const & now ) {
+			lib::iob::iob_curve_t const curve{ dia };
+			lib::iob::iob_curve_t const snooze_curve{ dia/profile.bolussnooze_dia_divisor };
+			iob_totals_t result{ };
+			for( auto it = window.first; it != window.last; ++it ) {
+				auto const & treatment = *it;
+				auto const contrib = lib::iob::iobCalc( treatment, now, curve );
+				auto const iob_contrib = contrib.iobContrib ? *contrib.iobContrib : 0.0;
+				result.iob += iob_contrib;
+				if( contrib.activityContrib ) {
+					result.activity += *contrib.activityContrib;
+				}
+				if( treatment.insulin >= 0.1 && treatment.is_bolus ) {
+					auto const snooze = lib::iob::iobCalc( treatment, now, snooze_curve );
+					if( snooze.iobContrib ) {
+						result.bolussnooze += *snooze.iobContrib;
+					}
+				} else {
+					result.basaliob += iob_contrib;
+					result.netbasalinsulin += treatment.insulin;
+					if( treatment.insulin > 0 ) {
+						result.hightempinsulin += treatment.insulin;
+					}
+				}
+			}
+			return result;
+		}
+
+		iob_data_t to_iob_data( iob_totals_t const & totals ) {
+			return iob_data_t{ totals.bolussnooze, totals.activity, totals.iob, totals.basaliob, totals.netbasalinsulin, totals.hightempinsulin };
+		}
+
+		// list node plus hash node with its bucket, roughly
+		constexpr size_t const entry_overhead = 6 * sizeof( void * );
+	}	// namespace anonymous
+
+	iob_data_t iob_total( iob_treatment_t const * treatments, size_t const count, double const dia, profile_t const & profile, timestamp_t const & now ) {
+		latency::scoped_timer_t const timer{ latency::stage_t::iob_total };
+		return to_iob_data( sum_treatments( active_treatments( treatments, count, dia, now ), dia, profile, now ) );
+	}
+
+	bool iob_total_cache::key_t::operator==( key_t const & rhs ) const noexcept {
+		return treatments_hash == rhs.treatments_hash && treatment_count == rhs.treatment_count && now == rhs.now && dia == rhs.dia && bolussnooze_dia_divisor == rhs.bolussnooze_dia_divisor;
+	}
+
+	size_t iob_total_cache::key_hash_t::operator( )( key_t const & key ) const noexcept {
+		auto result = static_cast<size_t>(key.treatments_hash);
+		boost::hash_combine( result, key.treatment_count );
+		boost::hash_combine( result, key.now );
+		boost::hash_combine( result, key.dia );
+		boost::hash_combine( result, key.bolussnooze_dia_divisor );
+		return result;
+	}
+
+	iob_total_cache::iob_total_cache( size_t const byte_budget ):
+			m_entries{ },
+			m_index{ },
+			m_byte_budget{ byte_budget },
+			m_hits{ 0 },
+			m_misses{ 0 } { }
+
+	iob_data_t iob_total_cache::get( iob_treatment_t const * treatments, size_t const count, double const dia, profile_t const & profile, timestamp_t const & now ) {
+		latency::scoped_timer_t const timer{ latency::stage_t::iob_total };
+		auto const window = active_treatments( treatments, count, dia, now );
+		// only the treatments that contribute are hashed, a history that grew older entries still hits
+		uint64_t treatments_hash = 14695981039346656037ull;	// FNV-1a
+		auto const hash_bytes = [&treatments_hash]( void const * data, size_t const size ) {
+			auto const bytes = static_cast<unsigned char const *>(data);
+			for( size_t n = 0; n < size; ++n ) {
+				treatments_hash = (treatments_hash ^ bytes[n]) * 1099511628211ull;
+			}
+		};
+		for( auto it = window.first; it != window.last; ++it ) {
+			auto const date = it->date.time_since_epoch( ).count( );
+			hash_bytes( &date, sizeof( date ) );
+			hash_bytes( &it->insulin, sizeof( it->insulin ) );
+			hash_bytes( &it->is_bolus, sizeof( it->is_bolus ) );
+		}
+		key_t const key{ treatments_hash, static_cast<size_t>(window.last - window.first), now.time_since_epoch( ).count( ), dia, profile.bolussnooze_dia_divisor };
+
+		auto const pos = m_index.find( key );
+		if( pos != m_index.end( ) ) {
+			++m_hits;
+			m_entries.splice( m_entries.begin( ), m_entries, pos->second );
+			return to_iob_data( pos->second->value );
+		}
+		++m_misses;
+		auto const totals = sum_treatments( window, dia, profile, now );
+		if( entry_size( ) <= m_byte_budget ) {
+			m_entries.push_front( { key, totals } );
+			m_index.emplace( key, m_entries.begin( ) );
+			while( bytes_used( ) > m_byte_budget ) {
+				m_index.erase( m_entries.back( ).key );
+				m_entries.pop_back( );
+			}
+		}
+		return to_iob_data( totals );
+	}
+
+	void iob_total_cache::clear( ) {
+		m_index.clear( );
+		m_entries.clear( );
+	}
+
+	size_t iob_total_cache::entry_size( ) noexcept {
+		return sizeof( entry_t ) + sizeof( key_t ) + entry_overhead;
+	}
+
+	size_t iob_total_cache::size( ) const noexcept {
+		return m_entries.size( );
+	}
+
+	size_t iob_total_cache::bytes_used( ) const noexcept {
+		return m_entries.size( ) * entry_size( );
+	}
+
+	size_t iob_total_cache::byte_budget( ) const noexcept {
+		return m_byte_budget;
+	}
+
+	size_t iob_total_cache::hits( ) const noexcept {
+		return m_hits;
+	}
+
+	size_t iob_total_cache::misses( ) const noexcept {
+		return m_misses;
+	}
+}    // namespace ns
@@ -0,0 +1,297 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016 Darrell Wright
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <thread>
+
+#include <date/date.h>
+
+#include "log_sink.h"
+
+namespace ns {
+	namespace log {
+		namespace {
+			std::atomic<log_sink_t *> s_installed{ nullptr };
+
+			std::unique_ptr<std::ostream> open_log_file( std::string const & file_name ) {
+				std::unique_ptr<std::ostream> result{ new std::ofstream{ file_name, std::ios::app } };
+				if( !*result ) {
+					throw std::runtime_error( "Could not open log file " + file_name );
+				}
+				return result;
+			}
+
+			size_t round_up_pow2( size_t value ) {
+				size_t result = 1;
+				while( result < value ) {
+					result <<= 1;
+				}
+				return result;
+			}
+		}	// namespace anonymous
+
+		std::ostream & operator<<( std::ostream & os, level_t level ) {
+			switch( level ) {
+			case level_t::trace:
+				return os << "trace";
+			case level_t::debug:
+				return os << "debug";
+			case level_t::info:
+				return os << "info";
+			case level_t::warning:
+				return os << "warning";
+			case level_t::error:
+				return os << "error";
+			case level_t::off:
+				return os << "off";
+			}
+			return os << static_cast<int>(level);
+		}
+
+		std::ostream & operator<<( std::ostream & os, category_t category ) {
+			switch( category ) {
+			case category_t::core:
+				return os << "core";
+			case category_t::iob:
+				return os << "iob";
+			case category_t::determine_basal:
+				return os << "determine_basal";
+			case category_t::profile:
+				return os << "profile";
+			case category_t::simulator:
+				return os << "simulator";
+			}
+			return os << static_cast<int>(category);
+		}
+
+		std::ostream & operator<<( std::ostream & os, log_record_t const & record ) {
+			using date::operator<<;
+			os << date::floor<std::chrono::milliseconds>( record.when ) << ' ' << record.level << ' ' << record.category << ": ";
+			size_t arg = 0;
+			for( auto format = record.format; *format != '\0'; ++format ) {
+				if( format[0] == '{' && format[1] == '}' && arg < record.arg_count ) {
+					os << record.args[arg++];
+					++format;
+				} else {
+					os << *format;
+				}
+			}
+			return os;
+		}
+
+		log_ring_t::log_ring_t( size_t capacity ):
+				m_slots{ },
+				m_mask{ round_up_pow2( std::max<size_t>( capacity, 2 ) ) - 1 },
+				m_head{ 0 },
+				m_tail{ 0 } {
+
+			m_slots.reset( new slot_t[m_mask + 1] );
+			for( size_t n = 0; n <= m_mask; ++n ) {
+				m_slots[n].sequence.store( n, std::memory_order_relaxed );
+			}
+		}
+
+		size_t log_ring_t::capacity( ) const noexcept {
+			return m_mask + 1;
+		}
+
+		// Each slot's sequence says whose turn it is, pos when it is free for the
+		// pos'th push and pos + 1 once that push has filled it
+		bool log_ring_t::try_push( log_record_t const & record ) noexcept {
+			auto pos = m_head.load( std::memory_order_relaxed );
+			while( true ) {
+				auto & slot = m_slots[pos & m_mask];
+				auto const sequence = slot.sequence.load( std::memory_order_acquire );
+				auto const diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos);
+				if( diff == 0 ) {
+					if( m_head.compare_exchange_weak( pos, pos + 1, std::memory_order_relaxed ) ) {
+						slot.record = record;
+						slot.sequence.store( pos + 1, std::memory_order_release );
+						return true;
+					}
+				} else if( diff < 0 ) {
+					return false;	// full
+				} else {
+					pos = m_head.load( std::memory_order_relaxed );
+				}
+			}
+		}
+
+		bool log_ring_t::try_pop( log_record_t & record ) noexcept {
+			auto pos = m_tail.load( std::memory_order_relaxed );
+			while( true ) {
+				auto & slot = m_slots[pos & m_mask];
+				auto const sequence = slot.sequence.load( std::memory_order_acquire );
+				auto const diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos + 1);
+				if( diff == 0 ) {
+					if( m_tail.compare_exchange_weak( pos, pos + 1, std::memory_order_relaxed ) ) {
+						record = slot.record;
+						slot.sequence.store( pos + m_mask + 1, std::memory_order_release );
+						return true;
+					}
+				} else if( diff < 0 ) {
+					return false;	// empty
+				} else {
+					pos = m_tail.load( std::memory_order_relaxed );
+				}
+			}
+		}
+
+		log_sink_t::log_sink_t( std::unique_ptr<std::ostream> file, std::ostream * out, size_t capacity, std::chrono::milliseconds interval ):
+				m_file{ std::move( file ) },
+				m_out{ out },
+				m_ring{ capacity },
+				m_interval{ interval },
+				m_min_level{ level_t::info },
+				m_categories{ all_categories },
+				m_overflow{ overflow_t::drop },
+				m_dropped{ 0 },
+				m_written{ 0 },
+				m_drain_mutex{ },
+				m_wait_mutex{ },
+				m_wait{ },
+				m_stop{ false },
+				m_thread{ } {
+
+			m_thread = std::thread{ [this]( ) { run( ); } };
+		}
+
+		log_sink_t::log_sink_t( std::ostream & out, size_t capacity, std::chrono::milliseconds interval ):
+				log_sink_t{ nullptr, &out, capacity, interval } { }
+
+		log_sink_t::log_sink_t( std::string const & file_name, size_t capacity, std::chrono::milliseconds interval ):
+				log_sink_t{ open_log_file( file_name ), capacity, interval } { }
+
+		log_sink_t::log_sink_t( std::unique_ptr<std::ostream> file, size_t capacity, std::chrono::milliseconds interval ):
+				log_sink_t{ std::move( file ), nullptr, capacity, interval } {
+
+			m_out = m_file.get( );
+		}
+
+		log_sink_t::~log_sink_t( ) {
+			auto expected = this;
+			s_installed.compare_exchange_strong( expected, nullptr );
+			{
+				std::lock_guard<std::mutex> lock{ m_wait_mutex };
+				m_stop = true;
+			}
+			m_wait.notify_all( );
+			if( m_thread.joinable( ) ) {
+				m_thread.join( );
+			}
+			drain( );
+		}
+
+		void log_sink_t::drain( ) {
+			std::lock_guard<std::mutex> lock{ m_drain_mutex };
+			log_record_t record;
+			size_t count = 0;
+			while( m_ring.try_pop( record ) ) {
+				*m_out << record << '\n';
+				++count;
+			}
+			if( count > 0 ) {
+				m_out->flush( );
+				m_written += count;
+			}
+		}
+
+		void log_sink_t::run( ) {
+			std::unique_lock<std::mutex> lock{ m_wait_mutex };
+			while( !m_stop ) {
+				m_wait.wait_for( lock, m_interval );
+				lock.unlock( );
+				drain( );
+				lock.lock( );
+			}
+		}
+
+		level_t log_sink_t::min_level( ) const noexcept {
+			return m_min_level.load( std::memory_order_relaxed );
+		}
+
+		void log_sink_t::min_level( level_t level ) noexcept {
+			m_min_level.store( level, std::memory_order_relaxed );
+		}
+
+		uint32_t log_sink_t::categories( ) const noexcept {
+			return m_categories.load( std::memory_order_relaxed );
+		}
+
+		void log_sink_t::categories( uint32_t category_mask ) noexcept {
+			m_categories.store( category_mask, std::memory_order_relaxed );
+		}
+
+		bool log_sink_t::enabled( level_t level, category_t category ) const noexcept {
+			return level != level_t::off && level >= min_level( ) && (categories( ) & category_bit( category )) != 0;
+		}
+
+		overflow_t log_sink_t::overflow( ) const noexcept {
+			return m_overflow.load( std::memory_order_relaxed );
+		}
+
+		void log_sink_t::overflow( overflow_t policy ) noexcept {
+			m_overflow.store( policy, std::memory_order_relaxed );
+		}
+
+		bool log_sink_t::try_log( log_record_t const & record ) noexcept {
+			if( m_ring.try_push( record ) ) {
+				return true;
+			}
+			if( overflow( ) == overflow_t::wait ) {
+				// the drain thread does the writing, this thread only waits for it to make room
+				do {
+					m_wait.notify_one( );
+					std::this_thread::yield( );
+				} while( !m_ring.try_push( record ) );
+				return true;
+			}
+			m_dropped.fetch_add( 1, std::memory_order_relaxed );
+			return false;
+		}
+
+		void log_sink_t::flush( ) {
+			drain( );
+		}
+
+		size_t log_sink_t::dropped( ) const noexcept {
+			return m_dropped.load( std::memory_order_relaxed );
+		}
+
+		size_t log_sink_t::written( ) const noexcept {
+			return m_written.load( );
+		}
+
+		void install( log_sink_t * sink ) noexcept {
+			s_installed.store( sink, std::memory_order_release );
+		}
+
+		log_sink_t * installed( ) noexcept {
+			return s_installed.load( std::memory_order_acquire );
+		}
+	}	// namespace log
+}    // namespace ns
@@ -0,0 +1,131 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016 Darrell Wright
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <boost/filesystem.hpp>
+#include <boost/optional.hpp>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "compiled_profile.h"
+#include "profile_snapshot.h"
+#include "tz_cache.h"
+
+namespace ns {
+	namespace profile_snapshot {
+		namespace {
+			constexpr char const magic[8] = { 'O', 'R', 'E', 'F', 'P', 'R', 'O', 'F' };
+			constexpr uint64_t const fnv_offset = 14695981039346656037ull;
+			constexpr uint64_t const fnv_prime = 1099511628211ull;
+
+			struct header_t {
+				char magic[8];
+				uint32_t version;
+				uint32_t value_size;
+				uint32_t value_count;
+				uint32_t input_count;
+			};	// header_t
+
+			static_assert( sizeof( profile_values_t ) == 5 * sizeof( double ), "profile_values_t is part of the file format" );
+
+			template<typename T>
+			bool read( std::istream & is, T * value, size_t const count = 1 ) {
+				return static_cast<bool>(is.read( reinterpret_cast<char *>(value), static_cast<std::streamsize>(sizeof( T ) * count) ));
+			}
+
+			template<typename T>
+			void write( std::ostream & os, T const * value, size_t const count = 1 ) {
+				os.write( reinterpret_cast<char const *>(value), static_cast<std::streamsize>(sizeof( T ) * count) );
+			}
+		}	// namespace anonymous
+
+		uint64_t file_hash( std::string const & file_name ) {
+			std::ifstream in{ file_name, std::ios::binary };
+			if( !in ) {
+				throw std::runtime_error( "Could not open " + file_name );
+			}
+			uint64_t result = fnv_offset;
+			char buffer[4096];
+			while( in.read( buffer, sizeof( buffer ) ) || in.gcount( ) > 0 ) {
+				for( std::streamsize n = 0; n < in.gcount( ); ++n ) {
+					result = (result ^ static_cast<unsigned char>(buffer[n])) * fnv_prime;
+				}
+			}
+			return result;
+		}
+
+		std::vector<uint64_t> file_hashes( std::vector<std::string> const & file_names ) {
+			std::vector<uint64_t> result;
+			result.reserve( file_names.size( ) );
+			for( auto const & file_name: file_names ) {
+				result.push_back( file_hash( file_name ) );
+			}
+			return result;
+		}
+
+		void save( std::string const & file_name, compiled_profile_t const & profile, std::vector<uint64_t> const & input_hashes ) {
+			header_t header{ };
+			std::copy( std::begin( magic ), std::end( magic ), header.magic );
+			header.version = current_version;
+			header.value_size = sizeof( profile_values_t );
+			header.value_count = static_cast<uint32_t>(profile.values( ).size( ));
+			header.input_count = static_cast<uint32_t>(input_hashes.size( ));
+
+			// readers see the old snapshot or the new one, never part of one
+			auto const temp_name = file_name + ".tmp";
+			{
+				std::ofstream out{ temp_name, std::ios::binary | std::ios::trunc };
+				write( out, &header );
+				write( out, input_hashes.data( ), input_hashes.size( ) );
+				write( out, profile.values( ).data( ), profile.values( ).size( ) );
+				if( !out.flush( ) ) {
+					throw std::runtime_error( "Error writing profile snapshot " + temp_name );
+				}
+			}
+			boost::filesystem::rename( temp_name, file_name );
+		}
+
+		boost::optional<compiled_profile_t> load( std::string const & file_name, std::vector<uint64_t> const & input_hashes, tz_cache_t tz ) {
+			std::ifstream in{ file_name, std::ios::binary };
+			header_t header;
+			if( !in || !read( in, &header ) ) {
+				return boost::none;
+			}
+			if( !std::equal( std::begin( magic ), std::end( magic ), header.magic ) || header.version != current_version || header.value_size != sizeof( profile_values_t ) || header.value_count != 24*60 || header.input_count != input_hashes.size( ) ) {
+				return boost::none;
+			}
+			std::vector<uint64_t> hashes( header.input_count );
+			if( !read( in, hashes.data( ), hashes.size( ) ) || hashes != input_hashes ) {
+				return boost::none;
+			}
+			std::vector<profile_values_t> values( header.value_count );
+			if( !read( in, values.data( ), values.size( ) ) || in.peek( ) != std::ifstream::traits_type::eof( ) ) {
+				return boost::none;
+			}
+			return compiled_profile_t{ std::move( values ), std::move( tz ) };
+		}
+	}	// namespace profile_snapshot
+}    // namespace ns
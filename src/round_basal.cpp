@@ -21,13 +21,14 @@
 // SOFTWARE.
 
 #include <boost/algorithm/string/predicate.hpp>
+#include <cassert>
 #include <cmath>
 
 #include "data_types.h"
 #include "round_basal.h"
 
 namespace ns {
-	auto round_basal( double const & basal, profile_t const & profile ) {
+	double round_basal( double const & basal, profile_t const & profile ) {
 		/*
 		 * x23 and x54 pumps change basal increment depending on how much basal is being delivered:
 		 * 0.025u for 0.025 < x < 0.975
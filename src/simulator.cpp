@@ -28,11 +28,16 @@
 
 #include <daw/json/daw_json_link.h>
 
+#include "carb_dose.h"
+#include "iob_accumulator.h"
 #include "iob_calc.h"
+#include "iob_infusion.h"
+#include "log_sink.h"
 
 using namespace std::chrono_literals;
 using namespace std::chrono;
 using namespace date;
+using ns::carb_dose_t;
 
 struct profile_t {
 	double isf;
@@ -95,82 +100,17 @@ size_t random_generator(size_t min, size_t max) {
 	return dist( rng );
 }
 
-double calc_duration( time_point<system_clock> const & lhs, time_point<system_clock> const & rhs ) {
-	return duration_cast<minutes>( rhs - lhs ).count( );
-}
-
-struct carb_dose_t {
-	double amount;
-	double absorption_rate;
-	time_point<system_clock> dose_time;
-
-	carb_dose_t( ) = delete;
-	~carb_dose_t( ) = default;
-	carb_dose_t( carb_dose_t const & ) = default;
-	carb_dose_t & operator=( carb_dose_t const & ) = default;
-	carb_dose_t( carb_dose_t && ) = default;
-	carb_dose_t & operator=( carb_dose_t && ) = default;
-
-	carb_dose_t( time_point<system_clock> doseTime, double Amount, double absorptionRate ):
-			amount{ Amount < 0 ? 0 : Amount },
-			absorption_rate{ absorptionRate < 0 ? 0 : absorptionRate },
-			dose_time{ doseTime } { }
-
-	static double calc_cob( carb_dose_t const & item, time_point<system_clock> const & current_ts ) {
-		// Used formula from https://github.com/Perceptus/GlucoDyn/blob/master/basic_math.pdf
-		auto const t = calc_duration( item.dose_time, current_ts );
-		if( t < 0 ) {
-			return item.amount;
-		}
-		double const AT = item.amount/item.absorption_rate;
-		auto const & D = item.amount;
-		auto result = D - [&]( ) { 
-			if( t < AT/2.0 ) {
-				return (2.0*D*t*t)/(AT*AT);
-			} else if( t <= AT ) {
-				return ((4.0*D)/AT)*(t - (t*t)/(2*AT)) - D;
-			}
-			return D;
-		}( );
-		//std::cout << "~~~~calc_cob: AT=" << AT << " D=" << D << " cob=" << result << " %=" << ((result/item.amount)*100) << '\n';
-		return result;
-	}
-
-	double tick( time_point<system_clock> const & current_ts ) const {
-		return calc_cob( *this, current_ts ); 
-	}
-};
-
-void clean_up( time_point<system_clock> const & ts_now, std::vector<ns::dose> & insulin_doses, std::vector<carb_dose_t> & carb_doses ) {
-	insulin_doses.erase( std::remove_if( insulin_doses.begin( ), insulin_doses.end( ), [&]( auto const & item ) {
-		auto const duration = calc_duration( item.dose_time, ts_now );
-		return duration >= static_cast<intmax_t>(item.dose_dia);
-	} ), insulin_doses.end( ) );
-
+void clean_up( time_point<system_clock> const & ts_now, std::vector<carb_dose_t> & carb_doses ) {
 	carb_doses.erase( std::remove_if( carb_doses.begin( ), carb_doses.end( ), [&]( auto const & item ) {
 		return ts_now > item.dose_time && item.tick( ts_now ) <= 0;
 	} ), carb_doses.end( ) );
 }
 
-double calc_iob( time_point<system_clock> const & ts_now, ns::dose const & item ) {
-	if( ts_now < item.dose_time ) {	// Ignore future insulin
-		return item.amount;
-	}
-	auto const duration = duration_cast<minutes>( ts_now - item.dose_time ).count( );
-	if( duration > static_cast<intmax_t>(item.dose_dia) ) {
-		return 0.0;
-	}
-	auto const pc = ns::insulin_on_board_pct( duration, item.dose_dia );
-	//std::cout << "~~~~insulin_dose dia=" << static_cast<int16_t>(item.dose_dia) << " age=" << duration << " %=" << pc << " amount=" << item.amount << " left=" << (pc*item.amount) << '\n';
-	return item.amount * pc;
-}
-
 int main( int, char ** ) {
 	double const basal_dose_per_hr = 1.2;
 	profile_t profile { 3.5, 15.0 }; 
 	double const est_liver_carb_per_hr = basal_dose_per_hr*profile.icr;
 	double const est_liver_carb_per_min = est_liver_carb_per_hr/60.0;
-	std::vector<ns::dose> insulin_doses;
 	std::vector<carb_dose_t> carb_doses;
 	double last_iob = 0.0;
 	double last_cob = 0.0;
@@ -178,13 +118,29 @@ int main( int, char ** ) {
 	double glucose_delta = 0.05;
 	double insulin_offset = 0.0;
 
-	std::cout << "Based on ICR=" << profile.icr << "g Carb/U ISF=" << profile.isf << "mmol/L/U basal_rate=" << basal_dose_per_hr;
-	std::cout << "U/hr it is estimated that the liver outputs " << est_liver_carb_per_hr << "g/hr of glucose or " << est_liver_carb_per_min << "g/min\n";
+	// lines are formatted and written by the sink's thread.  Nothing throttles the loop, so rather than drop
+	// lines when it outruns the output it waits for the drain thread to make room
+	ns::log::log_sink_t log_sink{ std::cout, 1u << 16 };
+	log_sink.overflow( ns::log::overflow_t::wait );
+	ns::log::install( &log_sink );
+	using ns::log::category_t;
+	using ns::log::level_t;	// lines in the loop are stamped with the simulated time
+
+	ns::log::info( category_t::simulator, "Based on ICR={}g Carb/U ISF={}mmol/L/U basal_rate={}U/hr it is estimated that the liver outputs {}g/hr of glucose or {}g/min", profile.icr, profile.isf, basal_dose_per_hr, est_liver_carb_per_hr, est_liver_carb_per_min );
 	
-	auto const add_insulin_dose = [&last_iob, &insulin_doses]( time_point<system_clock> const & when, double amount, ns::insulin_duration_t dia = ns::insulin_duration_t::t240 ) {
+	auto ts_now = system_clock::now( ); 
+	ns::iob_accumulator insulin_on_board{ ts_now };
+
+	auto const add_insulin_dose = [&last_iob, &insulin_on_board]( time_point<system_clock> const & when, double amount, ns::insulin_duration_t dia = ns::insulin_duration_t::t240 ) {
 		//std::cout << "~~insulin_dose: " << amount << "U\n";
 		last_iob += amount;
-		insulin_doses.emplace_back( amount, dia, when );
+		insulin_on_board.add( ns::dose{ amount, dia, when } );
+	};
+
+	auto const add_basal = [&last_iob, &insulin_on_board]( time_point<system_clock> const & start, time_point<system_clock> const & end, double rate_per_hr, ns::insulin_duration_t dia = ns::insulin_duration_t::t240 ) {
+		ns::infusion const item{ rate_per_hr, start, end, dia };
+		last_iob += item.amount( );
+		insulin_on_board.add( item );
 	};
 
 	auto const add_carb_dose = [&last_cob, &carb_doses]( time_point<system_clock> const & when, double amount, double absorption_rate = 0.5 ) {
@@ -199,20 +155,17 @@ int main( int, char ** ) {
 		add_insulin_dose( when, insulin_dose );
 	};
 
-	auto const ts_start = system_clock::now( ); 
+	auto const ts_start = ts_now; 
 	size_t last_duration = 0;
 
-	auto ts_now = system_clock::now( ); 
-
 	add_carb_dose( ts_now + 45min, 50, 0.5 );
 	add_insulin_dose( ts_now, 50.0/profile.icr );
 
 	while( true ) {
 		auto const cur_duration = duration_cast<minutes>( ts_now - ts_start ).count( );
 
-		auto const iob = std::accumulate( insulin_doses.begin( ), insulin_doses.end( ), 0.0, [&]( auto const & init, auto const & value ) {
-			return init + calc_iob( ts_now, value );
-		} );
+		insulin_on_board.advance( ts_now );
+		auto const iob = insulin_on_board.iob( );
 
 		auto const cob = std::accumulate( carb_doses.begin( ), carb_doses.end( ), 0.0, [&]( auto const & init, auto const & value ) {
 			return init + value.tick( ts_now );
@@ -224,13 +177,14 @@ int main( int, char ** ) {
 		last_cob = cob;
 
 		if( cur_duration > last_duration ) {
+			auto const elapsed = minutes{ cur_duration - static_cast<intmax_t>(last_duration) };
 			auto const carb_dose = est_liver_carb_per_min*(cur_duration-last_duration);
 			last_duration = cur_duration;
 
 			add_carb_dose( ts_now, carb_dose, carb_dose/180.0 );
 			auto ins_dose = carb_dose/profile.icr;
 			if( insulin_offset < -0.2 ) {
-				std::cout << "Lowering basal to offset too much insulin(TMI): need " << insulin_offset << "U and have " << ins_dose << " to give\n";
+				ns::log::write_at<level_t::info>( ts_now, category_t::simulator, "Lowering basal to offset too much insulin(TMI): need {}U and have {} to give", insulin_offset, ins_dose );
 				if( ins_dose >= insulin_offset ) {
 					ins_dose -= insulin_offset;
 					insulin_offset = 0;
@@ -240,7 +194,7 @@ int main( int, char ** ) {
 				}
 			}
 			if( ins_dose > 0 ) {
-				add_insulin_dose( ts_now, ins_dose , ns::insulin_duration_t::t180 );
+				add_basal( ts_now - elapsed, ts_now, ins_dose*60.0/static_cast<double>(elapsed.count( )), ns::insulin_duration_t::t180 );
 			}
 		}
 		
@@ -259,18 +213,18 @@ int main( int, char ** ) {
 		double const expected_glucose = glucose_new + expected_insulin_drop + expected_carb_rise;
 		glucose_state.add_value( glucose_new );
 
-		std::cout << ts_now << " t=" << cur_duration << " iob=" << iob << " active_ins=" << iob_diff << " cob=" << cob << "g active_carb=" << cob_diff << "g\n";
-		std::cout << "\t\tisf*iob=" << expected_insulin_drop << "mmol/L (cob/icr)*isf=" << expected_carb_rise << "mmol/L insulin_drop=" << -insulin_drop << "mmol/L carb_rise=" << carb_rise << "mmol/L\n";
-		std::cout << "\t\tprev_glucose=" << glucose_prev << " glucose=" << glucose_new << "mmol/L expected_glucose=" << expected_glucose << "mmol/L \n";
+		ns::log::write_at<level_t::info>( ts_now, category_t::simulator, "t={} iob={} active_ins={} cob={}g active_carb={}g", cur_duration, iob, iob_diff, cob, cob_diff );
+		ns::log::write_at<level_t::info>( ts_now, category_t::simulator, "\t\tisf*iob={}mmol/L (cob/icr)*isf={}mmol/L insulin_drop={}mmol/L carb_rise={}mmol/L", expected_insulin_drop, expected_carb_rise, -insulin_drop, carb_rise );
+		ns::log::write_at<level_t::info>( ts_now, category_t::simulator, "\t\tprev_glucose={} glucose={}mmol/L expected_glucose={}mmol/L", glucose_prev, glucose_new, expected_glucose );
 		ts_now += 5min;
 		//std::this_thread::sleep_for( 1s );
-		clean_up( ts_now, insulin_doses, carb_doses );
+		clean_up( ts_now, carb_doses );
 
 		insulin_offset = (expected_glucose - glucose_state.target_value)/profile.isf;
 
 		// If more insulin is needed to offset higher blood glucose give dose now
 		if( insulin_offset > 0.2 ) {
-			std::cout << "Bolusing to offset insulin debt need " << insulin_offset << "U\n";
+			ns::log::write_at<level_t::info>( ts_now, category_t::simulator, "Bolusing to offset insulin debt need {}U", insulin_offset );
 			add_insulin_dose( ts_now, insulin_offset );
 			insulin_offset = 0.0;
 		}
@@ -0,0 +1,344 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016 Darrell Wright
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <vector>
+
+#include "stage_latency.h"
+
+namespace ns {
+	namespace latency {
+		namespace {
+			using stage_histograms_t = std::array<histogram_t, stage_count>;
+
+			// the histograms of one running thread, only valid while epoch matches the registry's
+			struct slot_t {
+				stage_histograms_t histograms;
+				std::atomic<uint64_t> epoch;
+			};	// slot_t
+
+			struct registry_t {
+				std::mutex mutex;
+				std::atomic<uint64_t> epoch;	// bumped by reset
+				std::vector<std::unique_ptr<slot_t>> slots;
+				std::vector<slot_t *> free_slots;	// of finished threads, cleared
+				stage_histograms_t retired;	// finished threads' values, written under mutex
+			};	// registry_t
+
+			// never destroyed so it can still be read by the atexit writer
+			registry_t & registry( ) {
+				static auto result = new registry_t{ };
+				return *result;
+			}
+
+			void clear( stage_histograms_t & histograms ) noexcept {
+				for( auto & histogram: histograms ) {
+					histogram.reset( );
+				}
+			}
+
+			/// @brief Claims a slot for the calling thread, reusing a finished thread's when
+			/// there is one.  On thread exit the values are merged into the retired totals
+			/// and the slot is freed
+			class thread_slot_t {
+				slot_t * m_slot;
+			public:
+				thread_slot_t( ):
+						m_slot{ nullptr } {
+
+					auto & reg = registry( );
+					std::lock_guard<std::mutex> lock{ reg.mutex };
+					if( reg.free_slots.empty( ) ) {
+						reg.slots.push_back( std::make_unique<slot_t>( ) );
+						m_slot = reg.slots.back( ).get( );
+					} else {
+						m_slot = reg.free_slots.back( );
+						reg.free_slots.pop_back( );
+					}
+					m_slot->epoch.store( reg.epoch.load( std::memory_order_relaxed ), std::memory_order_relaxed );
+				}
+
+				~thread_slot_t( ) {
+					auto & reg = registry( );
+					std::lock_guard<std::mutex> lock{ reg.mutex };
+					if( m_slot->epoch.load( std::memory_order_relaxed ) == reg.epoch.load( std::memory_order_relaxed ) ) {
+						for( size_t stage = 0; stage < stage_count; ++stage ) {
+							reg.retired[stage].merge( m_slot->histograms[stage] );
+						}
+					}
+					clear( m_slot->histograms );
+					reg.free_slots.push_back( m_slot );
+				}
+
+				thread_slot_t( thread_slot_t const & ) = delete;
+				thread_slot_t( thread_slot_t && ) = delete;
+				thread_slot_t & operator=( thread_slot_t const & ) = delete;
+				thread_slot_t & operator=( thread_slot_t && ) = delete;
+
+				slot_t & operator*( ) const noexcept {
+					return *m_slot;
+				}
+			};	// thread_slot_t
+
+			stage_histograms_t & thread_histograms( ) {
+				thread_local thread_slot_t const result{ };
+				auto & slot = *result;
+				// a reset since the last record, only the owner clears its histograms
+				auto const epoch = registry( ).epoch.load( std::memory_order_acquire );
+				if( slot.epoch.load( std::memory_order_relaxed ) != epoch ) {
+					clear( slot.histograms );
+					slot.epoch.store( epoch, std::memory_order_release );
+				}
+				return slot.histograms;
+			}
+
+			void increment( std::atomic<uint64_t> & value, uint64_t const amount = 1 ) noexcept {
+				// single writer, a plain store is enough for readers to see whole values
+				value.store( value.load( std::memory_order_relaxed ) + amount, std::memory_order_relaxed );
+			}
+
+			std::atomic<int> s_exit_format{ -1 };
+
+			void write_on_exit( ) {
+				auto const format = s_exit_format.load( );
+				if( format >= 0 ) {
+					write( std::cerr, static_cast<output_formats>(format) );
+				}
+			}
+
+			struct environment_t {
+				environment_t( ) {
+					auto const value = std::getenv( "OREF0_LATENCY" );
+					if( value == nullptr ) {
+						return;
+					}
+					if( std::strcmp( value, "json" ) == 0 ) {
+						write_at_exit( output_formats::json );
+					} else if( std::strcmp( value, "text" ) == 0 ) {
+						write_at_exit( output_formats::text );
+					}
+				}
+			};	// environment_t
+
+			environment_t const s_environment{ };
+		}	// namespace anonymous
+
+		std::ostream & operator<<( std::ostream & os, stage_t stage ) {
+			switch( stage ) {
+			case stage_t::profile_load:
+				return os << "profile_load";
+			case stage_t::calc_temp_treatments:
+				return os << "calc_temp_treatments";
+			case stage_t::iob_total:
+				return os << "iob_total";
+			case stage_t::determine_basal:
+				return os << "determine_basal";
+			}
+			return os << static_cast<int>(stage);
+		}
+
+		constexpr size_t const histogram_t::sub_buckets;
+		constexpr size_t const histogram_t::max_exponent;
+		constexpr size_t const histogram_t::bucket_count;
+
+		histogram_t::histogram_t( ) noexcept:
+				m_buckets{ },
+				m_count{ 0 },
+				m_max{ 0 } { }
+
+		size_t histogram_t::bucket_index( uint64_t value ) noexcept {
+			// values below 2*sub_buckets get a bucket each, above that each power of 2 is split into sub_buckets
+			value = std::min( value, (uint64_t{ 1 } << max_exponent) - 1 );
+			if( value < 2 * sub_buckets ) {
+				return static_cast<size_t>(value);
+			}
+			size_t exponent = 0;
+			for( auto v = value; v > 1; v >>= 1 ) {
+				++exponent;
+			}
+			auto const shift = exponent - 5;
+			auto const mantissa = static_cast<size_t>(value >> shift);
+			return (shift + 1) * sub_buckets + (mantissa - sub_buckets);
+		}
+
+		uint64_t histogram_t::bucket_value( size_t index ) noexcept {
+			if( index < 2 * sub_buckets ) {
+				return index;
+			}
+			auto const shift = index / sub_buckets - 1;
+			auto const mantissa = uint64_t{ sub_buckets + index % sub_buckets };
+			return ((mantissa + 1) << shift) - 1;
+		}
+
+		void histogram_t::record( uint64_t value ) noexcept {
+			increment( m_buckets[bucket_index( value )] );
+			increment( m_count );
+			if( value > m_max.load( std::memory_order_relaxed ) ) {
+				m_max.store( value, std::memory_order_relaxed );
+			}
+		}
+
+		void histogram_t::reset( ) noexcept {
+			for( auto & bucket: m_buckets ) {
+				bucket.store( 0, std::memory_order_relaxed );
+			}
+			m_count.store( 0, std::memory_order_relaxed );
+			m_max.store( 0, std::memory_order_relaxed );
+		}
+
+		void histogram_t::merge( histogram_t const & other ) noexcept {
+			for( size_t n = 0; n < bucket_count; ++n ) {
+				increment( m_buckets[n], other.bucket( n ) );
+			}
+			increment( m_count, other.count( ) );
+			if( other.max( ) > m_max.load( std::memory_order_relaxed ) ) {
+				m_max.store( other.max( ), std::memory_order_relaxed );
+			}
+		}
+
+		uint64_t histogram_t::count( ) const noexcept {
+			return m_count.load( std::memory_order_relaxed );
+		}
+
+		uint64_t histogram_t::max( ) const noexcept {
+			return m_max.load( std::memory_order_relaxed );
+		}
+
+		uint64_t histogram_t::bucket( size_t index ) const noexcept {
+			return m_buckets[index].load( std::memory_order_relaxed );
+		}
+
+		void record( stage_t stage, std::chrono::nanoseconds elapsed ) noexcept {
+			thread_histograms( )[static_cast<size_t>(stage)].record( static_cast<uint64_t>(std::max<std::chrono::nanoseconds::rep>( elapsed.count( ), 0 )) );
+		}
+
+		scoped_timer_t::scoped_timer_t( stage_t stage ) noexcept:
+				m_stage{ stage },
+				m_start{ std::chrono::steady_clock::now( ) } { }
+
+		scoped_timer_t::~scoped_timer_t( ) {
+			record( m_stage, std::chrono::steady_clock::now( ) - m_start );
+		}
+
+		std::vector<stage_summary_t> summarize( ) {
+			std::vector<std::vector<uint64_t>> buckets( stage_count, std::vector<uint64_t>( histogram_t::bucket_count, 0 ) );
+			std::vector<uint64_t> counts( stage_count, 0 );
+			std::vector<uint64_t> maxes( stage_count, 0 );
+			{
+				auto & reg = registry( );
+				std::lock_guard<std::mutex> lock{ reg.mutex };
+				auto const add = [&]( stage_histograms_t const & histograms ) {
+					for( size_t stage = 0; stage < stage_count; ++stage ) {
+						auto const & histogram = histograms[stage];
+						for( size_t n = 0; n < histogram_t::bucket_count; ++n ) {
+							buckets[stage][n] += histogram.bucket( n );
+						}
+						counts[stage] += histogram.count( );
+						maxes[stage] = std::max( maxes[stage], histogram.max( ) );
+					}
+				};
+				add( reg.retired );
+				auto const epoch = reg.epoch.load( std::memory_order_relaxed );
+				for( auto const & slot: reg.slots ) {
+					// slots not recorded to since a reset hold old values
+					if( slot->epoch.load( std::memory_order_acquire ) == epoch ) {
+						add( slot->histograms );
+					}
+				}
+			}
+			std::vector<stage_summary_t> result;
+			for( size_t stage = 0; stage < stage_count; ++stage ) {
+				// buckets are read one at a time while threads record, so use their total rather than count
+				uint64_t total = 0;
+				for( auto const & bucket: buckets[stage] ) {
+					total += bucket;
+				}
+				auto const percentile = [&]( double const p ) {
+					auto const rank = std::max<uint64_t>( 1, static_cast<uint64_t>(std::ceil( p * static_cast<double>(total) )) );
+					uint64_t seen = 0;
+					for( size_t n = 0; n < histogram_t::bucket_count; ++n ) {
+						seen += buckets[stage][n];
+						if( seen >= rank ) {
+							return std::chrono::nanoseconds{ static_cast<std::chrono::nanoseconds::rep>(std::min( histogram_t::bucket_value( n ), maxes[stage] )) };
+						}
+					}
+					return std::chrono::nanoseconds{ 0 };
+				};
+				result.push_back( { static_cast<stage_t>(stage), total, percentile( 0.50 ), percentile( 0.99 ), std::chrono::nanoseconds{ static_cast<std::chrono::nanoseconds::rep>(maxes[stage]) } } );
+			}
+			return result;
+		}
+
+		void reset( ) {
+			auto & reg = registry( );
+			std::lock_guard<std::mutex> lock{ reg.mutex };
+			reg.epoch.fetch_add( 1, std::memory_order_release );
+			clear( reg.retired );
+		}
+
+		size_t thread_slots( ) {
+			auto & reg = registry( );
+			std::lock_guard<std::mutex> lock{ reg.mutex };
+			return reg.slots.size( );
+		}
+
+		void write( std::ostream & os, output_formats format ) {
+			auto const summaries = summarize( );
+			auto const to_us = []( std::chrono::nanoseconds const & value ) {
+				return static_cast<double>(value.count( ))/1000.0;
+			};
+			switch( format ) {
+			case output_formats::text:
+				os << std::left << std::setw( 24 ) << "stage" << std::right << std::setw( 10 ) << "count" << std::setw( 14 ) << "p50 us" << std::setw( 14 ) << "p99 us" << std::setw( 14 ) << "max us" << '\n';
+				for( auto const & summary: summaries ) {
+					std::stringstream name;
+					name << summary.stage;
+					os << std::left << std::setw( 24 ) << name.str( ) << std::right << std::setw( 10 ) << summary.count << std::fixed << std::setprecision( 3 ) << std::setw( 14 ) << to_us( summary.p50 ) << std::setw( 14 ) << to_us( summary.p99 ) << std::setw( 14 ) << to_us( summary.max ) << '\n';
+				}
+				break;
+			case output_formats::json:
+				os << "[\n";
+				for( size_t n = 0; n < summaries.size( ); ++n ) {
+					auto const & summary = summaries[n];
+					os << "\t{ \"stage\": \"" << summary.stage << "\", \"count\": " << summary.count << ", \"p50_ns\": " << summary.p50.count( ) << ", \"p99_ns\": " << summary.p99.count( ) << ", \"max_ns\": " << summary.max.count( ) << " }" << (n + 1 < summaries.size( ) ? ",\n" : "\n");
+				}
+				os << "]\n";
+				break;
+			}
+			os << std::flush;
+		}
+
+		void write_at_exit( output_formats format ) {
+			if( s_exit_format.exchange( static_cast<int>(format) ) < 0 ) {
+				std::atexit( write_on_exit );
+			}
+		}
+	}	// namespace latency
+}    // namespace ns
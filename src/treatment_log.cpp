@@ -0,0 +1,191 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016 Darrell Wright
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+#include "data_types.h"
+#include "lib_iob_history.h"
+#include "treatment_log.h"
+#include "tz_cache.h"
+
+namespace ns {
+	namespace lib {
+		namespace iob {
+			namespace {
+				bool record_less( pump_history_t const & lhs, pump_history_t const & rhs ) {
+					if( lhs.timestamp != rhs.timestamp ) {
+						return lhs.timestamp < rhs.timestamp;
+					}
+					return lhs.type < rhs.type;
+				}
+
+				bool is_temp_half( pump_history_t const & record ) {
+					return record.type == pump_history_types::TempBasal || record.type == pump_history_types::TempBasalDuration;
+				}
+			}	// namespace anonymous
+
+			treatment_log::treatment_log( std::vector<basal_profile_entry_t> basal_profile, tz_cache_t tz ):
+					m_basal_profile{ std::move( basal_profile ) },
+					m_tz{ std::move( tz ) },
+					m_records{ },
+					m_unpaired{ },
+					m_treatments{ },
+					m_bolus_insulin{ 0 },
+					m_net_basal_insulin{ 0 },
+					m_rebuilds{ 0 } { }
+
+			treatment_log::treatment_log( std::vector<basal_profile_entry_t> basal_profile, std::chrono::seconds const tz_offset ):
+					treatment_log{ std::move( basal_profile ), tz_cache_t{ tz_offset } } { }
+
+			size_t treatment_log::ingest( pump_history_t const * records, size_t const count ) {
+				// pump history comes newest first
+				std::vector<pump_history_t> added{ records, records + count };
+				std::stable_sort( added.begin( ), added.end( ), record_less );
+				added.erase( std::unique( added.begin( ), added.end( ), []( auto const & lhs, auto const & rhs ) {
+					return !record_less( lhs, rhs ) && !record_less( rhs, lhs );
+				} ), added.end( ) );
+				// drop what is already logged, usually the overlap with the previous batch
+				added.erase( std::remove_if( added.begin( ), added.end( ), [&]( auto const & record ) {
+					return std::binary_search( m_records.begin( ), m_records.end( ), record, record_less );
+				} ), added.end( ) );
+				if( added.empty( ) ) {
+					return 0;
+				}
+				if( !m_records.empty( ) && added.front( ).timestamp < m_records.back( ).timestamp ) {
+					auto const middle = m_records.size( );
+					m_records.insert( m_records.end( ), added.begin( ), added.end( ) );
+					std::inplace_merge( m_records.begin( ), m_records.begin( ) + static_cast<intmax_t>(middle), m_records.end( ), record_less );
+					rebuild( );
+					return added.size( );
+				}
+				for( auto const & record: added ) {
+					// at most a few records share the newest timestamp, so this is at or next to the end
+					m_records.insert( std::upper_bound( m_records.begin( ), m_records.end( ), record, record_less ), record );
+					append( record );
+				}
+				return added.size( );
+			}
+
+			size_t treatment_log::ingest( std::vector<pump_history_t> const & records ) {
+				return ingest( records.data( ), records.size( ) );
+			}
+
+			void treatment_log::append( pump_history_t const & record ) {
+				// halves older than this can no longer be paired
+				m_unpaired.erase( std::remove_if( m_unpaired.begin( ), m_unpaired.end( ), [&]( auto const & item ) {
+					return item.timestamp < record.timestamp;
+				} ), m_unpaired.end( ) );
+
+				if( !is_temp_half( record ) ) {
+					m_treatments.boluses.emplace_back( record.timestamp, record.amount );
+					m_bolus_insulin += record.amount;
+					return;
+				}
+				auto const other = std::find_if( m_unpaired.begin( ), m_unpaired.end( ), [&]( auto const & item ) {
+					return item.type != record.type;
+				} );
+				if( other == m_unpaired.end( ) ) {
+					m_unpaired.push_back( record );
+					return;
+				}
+				auto const & temp = record.type == pump_history_types::TempBasal ? record : *other;
+				auto const & temp_duration = record.type == pump_history_types::TempBasal ? *other : record;
+				if( temp.temp_type == pump_temp_basal_types::Absolute ) {
+					append_temp( { temp.timestamp, temp.timestamp + temp_duration.duration, temp.rate } );
+				}
+				m_unpaired.erase( other );
+			}
+
+			void treatment_log::append_temp( temp_basal_t const & temp ) {
+				auto & temps = m_treatments.temp_basals;
+				auto & pieces = m_treatments.net_basals;
+				if( !temps.empty( ) && temps.back( ).end > temp.start ) {
+					// the new temp cancels the rest of the previous one
+					temps.back( ).end = temp.start;
+					while( !pieces.empty( ) && pieces.back( ).start >= temp.start ) {
+						m_net_basal_insulin -= pieces.back( ).net_insulin( );
+						pieces.pop_back( );
+					}
+					if( !pieces.empty( ) && pieces.back( ).end > temp.start ) {
+						m_net_basal_insulin -= pieces.back( ).net_insulin( );
+						pieces.back( ).end = temp.start;
+						m_net_basal_insulin += pieces.back( ).net_insulin( );
+					}
+				}
+				temps.push_back( temp );
+				auto const added = split_temp_basal( temp, m_basal_profile, m_tz, pieces );
+				for( auto n = pieces.size( ) - added; n < pieces.size( ); ++n ) {
+					m_net_basal_insulin += pieces[n].net_insulin( );
+				}
+			}
+
+			void treatment_log::rebuild( ) {
+				++m_rebuilds;
+				if( !m_records.empty( ) ) {
+					m_tz.cover( m_records.front( ).timestamp, m_records.back( ).timestamp + std::chrono::hours{ 24 } );
+				}
+				m_treatments = calc_temp_treatments( m_records.data( ), m_records.size( ), m_basal_profile, m_tz );
+				m_bolus_insulin = 0;
+				for( auto const & bolus: m_treatments.boluses ) {
+					m_bolus_insulin += bolus.insulin;
+				}
+				m_net_basal_insulin = 0;
+				for( auto const & piece: m_treatments.net_basals ) {
+					m_net_basal_insulin += piece.net_insulin( );
+				}
+				// the newest halves may still be waiting for their other half
+				m_unpaired.clear( );
+				auto const newest = m_records.back( ).timestamp;
+				for( auto it = m_records.rbegin( ); it != m_records.rend( ) && it->timestamp == newest; ++it ) {
+					if( is_temp_half( *it ) ) {
+						m_unpaired.push_back( *it );
+					}
+				}
+				if( m_unpaired.size( ) == 2 ) {
+					m_unpaired.clear( );
+				}
+			}
+
+			temp_treatments_t const & treatment_log::treatments( ) const noexcept {
+				return m_treatments;
+			}
+
+			insulin_t treatment_log::bolus_insulin( ) const noexcept {
+				return m_bolus_insulin;
+			}
+
+			insulin_t treatment_log::net_basal_insulin( ) const noexcept {
+				return m_net_basal_insulin;
+			}
+
+			size_t treatment_log::size( ) const noexcept {
+				return m_records.size( );
+			}
+
+			size_t treatment_log::rebuilds( ) const noexcept {
+				return m_rebuilds;
+			}
+		}	// namespace iob
+	}	// namespace lib
+}    // namespace ns
@@ -0,0 +1,141 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016 Darrell Wright
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <algorithm>
+#include <chrono>
+#include <date/tz.h>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "data_types.h"
+#include "tz_cache.h"
+
+namespace ns {
+	namespace {
+		using namespace std::chrono;
+		constexpr hours const local_window_before{ 48 };
+		constexpr hours const local_window_after{ 24 };
+
+		date::sys_seconds to_sys_seconds( timestamp_t const & ts ) {
+			return date::sys_seconds{ duration_cast<seconds>( ts.time_since_epoch( ) ) };
+		}
+	}	// namespace anonymous
+
+	date::time_zone const * local_zone( ) {
+		static date::time_zone const * const zone = date::current_zone( );
+		return zone;
+	}
+
+	tz_cache_t::tz_cache_t( seconds const fixed_offset ):
+			m_zone{ nullptr },
+			m_transitions{ },
+			m_end{ timestamp_t::max( ) },
+			m_fixed_offset{ fixed_offset } { }
+
+	tz_cache_t::tz_cache_t( std::vector<transition_t> transitions ):
+			m_zone{ nullptr },
+			m_transitions{ std::move( transitions ) },
+			m_end{ timestamp_t::max( ) },
+			m_fixed_offset{ 0 } {
+
+		if( !std::is_sorted( m_transitions.begin( ), m_transitions.end( ), []( transition_t const & lhs, transition_t const & rhs ) {
+			return lhs.begin < rhs.begin;
+		} ) ) {
+			throw std::runtime_error( "Time zone transitions must be sorted" );
+		}
+	}
+
+	tz_cache_t::tz_cache_t( date::time_zone const * zone, timestamp_t const & from, timestamp_t const & to ):
+			m_zone{ zone },
+			m_transitions{ },
+			m_end{ from },
+			m_fixed_offset{ 0 } {
+
+		if( !m_zone ) {
+			throw std::runtime_error( "Expected a time zone" );
+		}
+		cover( from, to );
+	}
+
+	tz_cache_t::tz_cache_t( std::string const & zone_name, timestamp_t const & from, timestamp_t const & to ):
+			tz_cache_t{ date::locate_zone( zone_name ), from, to } { }
+
+	tz_cache_t tz_cache_t::local( ) {
+		auto const now = system_clock::now( );
+		return tz_cache_t{ local_zone( ), now - local_window_before, now + local_window_after };
+	}
+
+	void tz_cache_t::cover( timestamp_t const & from, timestamp_t const & to ) {
+		if( !m_zone || (!m_transitions.empty( ) && from >= m_transitions.front( ).begin && to <= m_end) ) {
+			return;
+		}
+		auto first = from;
+		auto const last = std::max( to, m_end );
+		if( !m_transitions.empty( ) ) {
+			first = std::min( first, m_transitions.front( ).begin );
+		}
+		m_transitions.clear( );
+		auto current = to_sys_seconds( first );
+		auto const end = to_sys_seconds( last );
+		// zones report their first and last offsets as lasting for ever, outside what timestamp_t holds
+		auto const max_end = to_sys_seconds( timestamp_t::max( ) );
+		do {
+			auto const info = m_zone->get_info( current );
+			m_transitions.push_back( { m_transitions.empty( ) ? first : timestamp_t{ current }, duration_cast<seconds>( info.offset ) } );
+			current = std::min( info.end, max_end );
+		} while( current <= end && current < max_end );
+		m_end = current < max_end ? timestamp_t{ current } : timestamp_t::max( );
+	}
+
+	seconds tz_cache_t::offset( timestamp_t const & utc ) const {
+		if( m_transitions.empty( ) ) {
+			return m_zone ? duration_cast<seconds>( m_zone->get_info( to_sys_seconds( utc ) ).offset ) : m_fixed_offset;
+		}
+		if( m_zone && (utc < m_transitions.front( ).begin || utc >= m_end) ) {
+			return duration_cast<seconds>( m_zone->get_info( to_sys_seconds( utc ) ).offset );
+		}
+		auto const pos = std::upper_bound( m_transitions.begin( ), m_transitions.end( ), utc, []( timestamp_t const & lhs, transition_t const & rhs ) {
+			return lhs < rhs.begin;
+		} );
+		return pos == m_transitions.begin( ) ? pos->offset : std::prev( pos )->offset;
+	}
+
+	timestamp_t::duration tz_cache_t::to_local( timestamp_t const & utc ) const {
+		return utc.time_since_epoch( ) + offset( utc );
+	}
+
+	timestamp_t tz_cache_t::from_local( timestamp_t::duration const & local ) const {
+		// the offset at local read as UTC can be from the wrong side of a transition, the second lookup corrects it
+		auto const guess = timestamp_t{ local } - offset( timestamp_t{ local } );
+		auto const result = timestamp_t{ local } - offset( guess );
+		if( to_local( result ) == local ) {
+			return result;
+		}
+		// skipped by the change, one offset puts it before and one after
+		return std::max( result, timestamp_t{ local } - offset( result ) );
+	}
+
+	std::vector<tz_cache_t::transition_t> const & tz_cache_t::transitions( ) const noexcept {
+		return m_transitions;
+	}
+}    // namespace ns
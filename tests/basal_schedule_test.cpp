@@ -0,0 +1,107 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016 Darrell Wright
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#define BOOST_TEST_MODULE basal_schedule_test 
+#include <boost/test/unit_test.hpp>
+
+#include <chrono>
+#include <cmath>
+#include <vector>
+
+#include "basal_schedule.h"
+#include "data_types.h"
+#include "lib_iob_history.h"
+#include "tz_cache.h"
+
+using namespace std::chrono;
+using namespace ns::lib::iob;
+
+namespace {
+	ns::timestamp_t const s_day{ hours{ 24*365*47 } };
+	std::vector<basal_profile_entry_t> const s_basal_profile = { { minutes{ 0 }, 0.8 }, { hours{ 6 }, 1.2 }, { hours{ 22 } + minutes{ 30 }, 0.9 } };
+
+	// the schedule walked piece by piece
+	ns::insulin_t split_scheduled( ns::timestamp_t from, ns::timestamp_t to, ns::tz_cache_t const & tz ) {
+		std::vector<net_basal_t> pieces;
+		split_temp_basal( { from, to, 0.0 }, s_basal_profile, tz, pieces );
+		ns::insulin_t result = 0;
+		for( auto const & piece: pieces ) {
+			result -= piece.net_insulin( );
+		}
+		return result;
+	}
+}
+
+BOOST_AUTO_TEST_CASE( basal_schedule_rates ) {
+	basal_schedule_t const schedule{ s_basal_profile };
+	BOOST_TEST( schedule.rate_at( hours{ 0 } ) == 0.8 );
+	BOOST_TEST( schedule.rate_at( hours{ 5 } + minutes{ 59 } + seconds{ 59 } ) == 0.8 );
+	BOOST_TEST( schedule.rate_at( hours{ 6 } ) == 1.2 );
+	BOOST_TEST( schedule.rate_at( hours{ 22 } + minutes{ 30 } ) == 0.9 );
+	BOOST_TEST( schedule.rate_at( -minutes{ 1 } ) == 0.9 );
+	BOOST_TEST( schedule.rate_at( hours{ 24*3 + 7 } ) == 1.2 );
+	BOOST_TEST( std::abs( schedule.daily_total( ) - (6*0.8 + 16.5*1.2 + 1.5*0.9) ) < 1.0e-9 );
+	BOOST_TEST( schedule.max_rate( ) == 1.2 );
+	BOOST_CHECK_THROW( basal_schedule_t{ std::vector<basal_profile_entry_t>{ } }, std::runtime_error );
+	BOOST_CHECK_THROW( (basal_schedule_t{ { { minutes{ 0 }, 1.0 }, { hours{ 25 }, 1.0 } } }), std::runtime_error );
+}
+
+BOOST_AUTO_TEST_CASE( basal_schedule_matches_walking_entries, *boost::unit_test::tolerance( 1.0e-9 ) ) {
+	basal_schedule_t const schedule{ s_basal_profile };
+	for( auto const offset: { hours{ -5 }, hours{ 0 }, hours{ 9 } } ) {
+		ns::tz_cache_t const tz{ offset };
+		for( auto from = s_day; from < s_day + hours{ 26 }; from += minutes{ 37 } + seconds{ 11 } ) {
+			for( auto const length: { seconds{ 30 }, seconds{ 1800 }, seconds{ 3600*7 + 13 }, seconds{ 3600*30 } } ) {
+				BOOST_TEST( schedule.scheduled_insulin( from, from + length, tz ) == split_scheduled( from, from + length, tz ) );
+			}
+		}
+	}
+	// whole days across midnight
+	ns::tz_cache_t const tz{ hours{ 0 } };
+	BOOST_TEST( schedule.scheduled_insulin( s_day + hours{ 13 }, s_day + hours{ 24*3 + 13 }, tz ) == 3.0 * schedule.daily_total( ) );
+	BOOST_TEST( schedule.scheduled_insulin( s_day + hours{ 13 }, s_day + hours{ 13 }, tz ) == 0.0 );
+}
+
+BOOST_AUTO_TEST_CASE( basal_schedule_across_dst, *boost::unit_test::tolerance( 1.0e-9 ) ) {
+	basal_schedule_t const schedule{ s_basal_profile };
+	// -5h, then -4h from 07:00Z
+	ns::tz_cache_t const tz{ std::vector<ns::tz_cache_t::transition_t>{ { s_day - hours{ 24*100 }, hours{ -5 } }, { s_day + hours{ 7 }, hours{ -4 } } } };
+	// 00:00 to 03:00 local is 05:00Z to 08:00Z, two real hours at 0.8
+	BOOST_TEST( schedule.scheduled_insulin( s_day + hours{ 5 }, s_day + hours{ 8 }, tz ) == 3.0 * 0.8 );
+	// local 04:00 to 07:00 is 08:00Z to 11:00Z with the change at 06:00 local
+	BOOST_TEST( schedule.scheduled_insulin( s_day + hours{ 8 }, s_day + hours{ 11 }, tz ) == 2.0 * 0.8 + 1.2 );
+	BOOST_TEST( schedule.scheduled_insulin( s_day + hours{ 5 }, s_day + hours{ 11 }, tz ) == split_scheduled( s_day + hours{ 5 }, s_day + hours{ 11 }, tz ) );
+}
+
+BOOST_AUTO_TEST_CASE( basal_schedule_net_basal ) {
+	basal_schedule_t const schedule{ s_basal_profile };
+	ns::tz_cache_t const tz{ hours{ 0 } };
+	temp_basal_t const temp{ s_day + hours{ 5 }, s_day + hours{ 7 }, 2.0 };
+	std::vector<net_basal_t> pieces;
+	split_temp_basal( temp, s_basal_profile, tz, pieces );
+	ns::insulin_t expected = 0;
+	for( auto const & piece: pieces ) {
+		expected += piece.net_insulin( );
+	}
+	BOOST_TEST( std::abs( net_basal_insulin( temp, schedule, tz ) - expected ) < 1.0e-12 );
+	BOOST_TEST( std::abs( expected - (4.0 - 0.8 - 1.2) ) < 1.0e-12 );
+}
@@ -0,0 +1,167 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016 Darrell Wright
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#define BOOST_TEST_MODULE bg_prediction_test 
+#include <boost/test/unit_test.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+#include "bg_prediction.h"
+#include "iob_forecast.h"
+
+using namespace std::chrono;
+
+namespace {
+	struct reference_t {
+		std::vector<double> iob;
+		std::vector<double> cob;
+		std::vector<double> uam;
+	};	// reference_t
+
+	// The prediction loop as written in oref0, growing each curve one point at a time
+	reference_t reference_predict( ns::prediction_inputs_t const & inputs, std::vector<double> const & activity ) {
+		auto const bgi = -activity.front( ) * inputs.sens * 5.0;
+		auto const ci = inputs.min_delta - bgi;
+		auto const uci = ci;
+		auto const csf = inputs.sens / inputs.carb_ratio;
+		auto const cid = ci > 0.0 ? std::min( static_cast<double>(inputs.remaining_carb_time.count( ))/5.0/2.0, std::max( 0.0, inputs.meal_cob * csf / ci ) ) : 0.0;
+		reference_t result{ { inputs.bg }, { inputs.bg }, { inputs.bg } };
+		for( auto const tick_activity: activity ) {
+			auto const pred_bgi = -tick_activity * inputs.sens * 5.0;
+			auto const pred_dev = ci * (1.0 - std::min( 1.0, static_cast<double>(result.iob.size( ))/12.0 ));
+			auto const pred_ci = std::max( 0.0, std::max( 0.0, ci ) * (1.0 - static_cast<double>(result.cob.size( ))/std::max( cid*2.0, 1.0 )) );
+			auto const pred_uci_slope = std::max( 0.0, uci + static_cast<double>(result.uam.size( ))*inputs.slope_from_deviations );
+			auto const pred_uci_max = std::max( 0.0, uci * (1.0 - static_cast<double>(result.uam.size( ))/36.0) );
+			auto const pred_uci = std::min( pred_uci_slope, pred_uci_max );
+			result.iob.push_back( result.iob.back( ) + pred_bgi + pred_dev );
+			result.cob.push_back( result.cob.back( ) + pred_bgi + std::min( 0.0, pred_dev ) + pred_ci );
+			result.uam.push_back( result.uam.back( ) + pred_bgi + std::min( 0.0, pred_dev ) + pred_uci );
+		}
+		return result;
+	}
+
+	void check_curve( double const * curve, std::vector<double> const & expected, ns::prediction_curve_summary_t const & summary ) {
+		for( size_t n = 0; n < expected.size( ); ++n ) {
+			BOOST_TEST( std::abs( curve[n] - expected[n] ) < 1.0e-9 );
+		}
+		BOOST_TEST( std::abs( summary.eventual_bg - expected.back( ) ) < 1.0e-9 );
+		BOOST_TEST( std::abs( summary.min_guard_bg - *std::min_element( expected.begin( ), expected.end( ) ) ) < 1.0e-9 );
+		BOOST_TEST( std::abs( summary.max_bg - *std::max_element( expected.begin( ), expected.end( ) ) ) < 1.0e-9 );
+		// before 90 minutes excluded
+		BOOST_TEST( std::abs( summary.min_bg - *std::min_element( expected.begin( ) + 18, expected.end( ) ) ) < 1.0e-9 );
+	}
+}
+
+BOOST_AUTO_TEST_CASE( bg_prediction_matches_reference ) {
+	std::mt19937 rng{ 1 };
+	std::uniform_real_distribution<double> activity_dist{ 0.0, 0.03 };
+	std::uniform_real_distribution<double> delta_dist{ -8.0, 12.0 };
+	std::uniform_real_distribution<double> cob_dist{ 0.0, 80.0 };
+	std::uniform_real_distribution<double> slope_dist{ -0.5, 0.2 };
+	ns::bg_prediction_engine_t engine{ };
+	for( size_t test = 0; test < 100; ++test ) {
+		std::vector<double> activity( ns::bg_prediction_engine_t::max_ticks );
+		for( auto & value: activity ) {
+			value = activity_dist( rng );
+		}
+		ns::prediction_inputs_t const inputs{ 140.0, delta_dist( rng ), 45.0, 10.0, cob_dist( rng ), slope_dist( rng ) };
+		auto const expected = reference_predict( inputs, activity );
+		auto const summary = engine.predict( inputs, activity.data( ), activity.size( ) );
+		BOOST_REQUIRE_EQUAL( engine.size( ), activity.size( ) + 1 );
+		BOOST_TEST( std::abs( summary.bgi - -activity.front( )*45.0*5.0 ) < 1.0e-12 );
+		check_curve( engine.iob_curve( ), expected.iob, summary.iob );
+		check_curve( engine.cob_curve( ), expected.cob, summary.cob );
+		check_curve( engine.uam_curve( ), expected.uam, summary.uam );
+	}
+}
+
+BOOST_AUTO_TEST_CASE( bg_prediction_flat ) {
+	ns::bg_prediction_engine_t engine{ };
+	std::vector<double> const activity( 100, 0.0 );
+	auto const summary = engine.predict( { 120.0, 0.0, 50.0, 10.0 }, activity.data( ), activity.size( ) );
+	// only max_ticks are used
+	BOOST_TEST( engine.size( ) == ns::bg_prediction_engine_t::max_ticks + 1 );
+	for( auto const & curve: { summary.iob, summary.cob, summary.uam } ) {
+		BOOST_TEST( curve.min_bg == 120.0 );
+		BOOST_TEST( curve.min_guard_bg == 120.0 );
+		BOOST_TEST( curve.max_bg == 120.0 );
+		BOOST_TEST( curve.eventual_bg == 120.0 );
+	}
+
+	// too short to have a min_bg past 90 minutes
+	std::vector<double> const falling( 6, 0.01 );
+	auto const short_summary = engine.predict( { 120.0, -2.5, 50.0, 10.0 }, falling.data( ), falling.size( ) );
+	BOOST_TEST( engine.size( ) == 7 );
+	BOOST_TEST( short_summary.iob.min_bg == short_summary.iob.eventual_bg );
+	BOOST_TEST( short_summary.iob.eventual_bg < 120.0 );
+	BOOST_TEST( short_summary.iob.max_bg == 120.0 );
+}
+
+BOOST_AUTO_TEST_CASE( bg_prediction_min_bg_from_90_minutes ) {
+	// BG falls 1 mg/dL every 5 minutes for 90 minutes then rises 1 mg/dL every 5 minutes, the
+	// deviation is 0 as the delta matches the insulin impact
+	std::vector<double> activity( 24, -0.004 );
+	std::fill( activity.begin( ), activity.begin( ) + 18, 0.004 );
+	ns::bg_prediction_engine_t engine{ };
+	auto const summary = engine.predict( { 100.0, -1.0, 50.0, 10.0 }, activity.data( ), activity.size( ) );
+	BOOST_TEST( std::abs( summary.carb_impact ) < 1.0e-12 );
+	// the lowest point, 82 at 90 minutes, is the first point min_bg includes as in oref0
+	BOOST_TEST( std::abs( summary.iob.min_bg - 82.0 ) < 1.0e-9 );
+	BOOST_TEST( std::abs( summary.iob.min_guard_bg - 82.0 ) < 1.0e-9 );
+	BOOST_TEST( std::abs( summary.iob.eventual_bg - 88.0 ) < 1.0e-9 );
+	BOOST_TEST( summary.iob.max_bg == 100.0 );
+
+	// a curve rising from the start has its min_bg at 90 minutes
+	std::vector<double> const rising( 24, -0.004 );
+	auto const rising_summary = engine.predict( { 100.0, 1.0, 50.0, 10.0 }, rising.data( ), rising.size( ) );
+	BOOST_TEST( std::abs( rising_summary.iob.min_bg - 118.0 ) < 1.0e-9 );
+	BOOST_TEST( rising_summary.iob.min_guard_bg == 100.0 );
+}
+
+BOOST_AUTO_TEST_CASE( bg_prediction_carbs_raise_cob_curve ) {
+	ns::bg_prediction_engine_t engine{ };
+	std::vector<double> const activity( ns::bg_prediction_engine_t::max_ticks, 0.01 );
+	ns::prediction_inputs_t const inputs{ 110.0, 3.0, 40.0, 10.0, 30.0 };
+	auto const summary = engine.predict( inputs, activity.data( ), activity.size( ) );
+	BOOST_TEST( summary.carb_impact > 0.0 );
+	BOOST_TEST( summary.cob.eventual_bg > summary.iob.eventual_bg );
+	BOOST_TEST( summary.cob.max_bg > inputs.bg );
+}
+
+BOOST_AUTO_TEST_CASE( bg_prediction_from_forecast ) {
+	ns::iob_forecast_t forecast{ system_clock::now( ), minutes{ 5 }, 24 };
+	std::fill( forecast.activity.begin( ), forecast.activity.end( ), 0.02 );
+	ns::bg_prediction_engine_t engine{ };
+	ns::prediction_inputs_t const inputs{ 150.0, -4.5, 45.0, 10.0 };
+	auto const summary = engine.predict( inputs, forecast );
+	auto const expected = reference_predict( inputs, forecast.activity );
+	BOOST_TEST( engine.size( ) == 25 );
+	BOOST_TEST( std::abs( summary.iob.eventual_bg - expected.iob.back( ) ) < 1.0e-9 );
+
+	ns::iob_forecast_t const coarse{ system_clock::now( ), minutes{ 10 }, 12 };
+	BOOST_CHECK_THROW( engine.predict( inputs, coarse ), std::runtime_error );
+}
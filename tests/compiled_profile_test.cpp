@@ -0,0 +1,93 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016 Darrell Wright
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#define BOOST_TEST_MODULE compiled_profile_test 
+#include <boost/test/unit_test.hpp>
+
+#include <chrono>
+#include <stdexcept>
+#include <vector>
+
+#include "compiled_profile.h"
+#include "data_types.h"
+#include "lib_iob_history.h"
+#include "tz_cache.h"
+
+using namespace std::chrono;
+
+namespace {
+	ns::timestamp_t const s_day{ hours{ 24*365*47 } };
+
+	ns::compiled_profile_t make_profile( ns::tz_cache_t tz ) {
+		return ns::compiled_profile_t{
+			{ { minutes{ 0 }, 0.8 }, { hours{ 6 }, 1.2 }, { hours{ 22 }, 0.9 } },
+			{ { minutes{ 0 }, 50.0 }, { hours{ 9 } + minutes{ 30 }, 45.0 } },
+			{ { minutes{ 0 }, 12.0 }, { hours{ 11 }, 10.0 }, { hours{ 17 }, 9.0 } },
+			{ { minutes{ 0 }, 100.0, 120.0 }, { hours{ 7 }, 90.0, 110.0 } },
+			std::move( tz ) };
+	}
+
+	// what a scan of the schedule entries gives
+	template<typename Entry>
+	Entry const & scan( std::vector<Entry> const & schedule, minutes const minute ) {
+		auto result = &schedule.front( );
+		for( auto const & entry: schedule ) {
+			if( entry.start <= minute ) {
+				result = &entry;
+			}
+		}
+		return *result;
+	}
+}
+
+BOOST_AUTO_TEST_CASE( compiled_profile_every_minute ) {
+	auto const profile = make_profile( ns::tz_cache_t{ hours{ 0 } } );
+	std::vector<ns::schedule_entry_t> const isf = { { minutes{ 0 }, 50.0 }, { hours{ 9 } + minutes{ 30 }, 45.0 } };
+	std::vector<ns::schedule_entry_t> const carb_ratios = { { minutes{ 0 }, 12.0 }, { hours{ 11 }, 10.0 }, { hours{ 17 }, 9.0 } };
+	std::vector<ns::bg_target_entry_t> const targets = { { minutes{ 0 }, 100.0, 120.0 }, { hours{ 7 }, 90.0, 110.0 } };
+	for( minutes minute{ 0 }; minute < hours{ 24 }; ++minute ) {
+		auto const & values = profile.at_minute( minute );
+		BOOST_TEST( values.isf == scan( isf, minute ).value );
+		BOOST_TEST( values.carb_ratio == scan( carb_ratios, minute ).value );
+		BOOST_TEST( values.min_bg == scan( targets, minute ).low );
+		BOOST_TEST( values.max_bg == scan( targets, minute ).high );
+		BOOST_TEST( values.basal == profile.basal_schedule( ).rate_at( minute ) );
+	}
+	BOOST_TEST( profile.at_minute( hours{ 8 } ).target_bg( ) == 100.0 );
+}
+
+BOOST_AUTO_TEST_CASE( compiled_profile_at_time ) {
+	auto const profile = make_profile( ns::tz_cache_t{ hours{ -5 } } );
+	// 09:29 and 09:30 local
+	BOOST_TEST( profile.at( s_day + hours{ 24*3 + 14 } + minutes{ 29 } ).isf == 50.0 );
+	BOOST_TEST( profile.at( s_day + hours{ 24*3 + 14 } + minutes{ 30 } ).isf == 45.0 );
+	// 23:00 local the day before
+	BOOST_TEST( profile.at( s_day + hours{ 4 } ).basal == 0.9 );
+	BOOST_TEST( profile.at_local( -minutes{ 1 } ).carb_ratio == 9.0 );
+}
+
+BOOST_AUTO_TEST_CASE( compiled_profile_validates ) {
+	BOOST_CHECK_THROW( (ns::compiled_profile_t{ { { minutes{ 0 }, 0.8 } }, { { hours{ 1 }, 50.0 } }, { }, { { minutes{ 0 }, 100.0, 120.0 } }, ns::tz_cache_t{ hours{ 0 } } }), std::runtime_error );
+	BOOST_CHECK_THROW( (ns::compiled_profile_t{ { { minutes{ 0 }, 0.8 } }, { { minutes{ 0 }, 50.0 } }, { }, { }, ns::tz_cache_t{ hours{ 0 } } }), std::runtime_error );
+	ns::compiled_profile_t const profile{ { { minutes{ 0 }, 0.8 } }, { { minutes{ 0 }, 50.0 } }, { }, { { minutes{ 0 }, 100.0, 120.0 } }, ns::tz_cache_t{ hours{ 0 } } };
+	BOOST_TEST( profile.at_minute( hours{ 12 } ).carb_ratio == 0.0 );
+}
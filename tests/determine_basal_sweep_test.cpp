@@ -0,0 +1,156 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016 Darrell Wright
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#define BOOST_TEST_MODULE determine_basal_sweep_test 
+#include <boost/test/unit_test.hpp>
+
+#include <algorithm>
+#include <boost/optional/optional_io.hpp>
+#include <chrono>
+#include <cmath>
+#include <vector>
+
+#include "data_types.h"
+#include "determine_basal_sweep.h"
+#include "requested_temp.h"
+
+namespace {
+	ns::profile_t make_profile( ) {
+		ns::profile_t result{ };
+		result.current_basal = 1.0;
+		result.min_bg = 100.0;
+		result.max_bg = 120.0;
+		result.max_basal = 3.0;
+		result.sens = 50.0;
+		return result;
+	}
+
+	ns::sweep_snapshot_t make_snapshot( ns::glucose_t const bg, ns::insulin_t const temp_rate, double const autosens_ratio ) {
+		return { { bg, 0.0, 0.0 }, { temp_rate }, ns::iob_data_t{ }, ns::autosense_data_t{ autosens_ratio }, { } };
+	}
+
+	ns::sweep_grid_t make_grid( ) {
+		ns::sweep_grid_t result{ };
+		result.target_ranges = { { 90.0, 110.0 }, { 100.0, 120.0 }, { 110.0, 140.0 } };
+		result.autosens_min = { 0.5, 0.7 };
+		result.autosens_max = { 1.2, 1.5, 2.0 };
+		result.current_basal_safety_multiplier = { 1.2, 4.0 };
+		return result;
+	}
+}
+
+BOOST_AUTO_TEST_CASE( sweep_grid_variants ) {
+	ns::profile_variant_t const base{ make_profile( ) };
+	ns::sweep_grid_t grid{ };
+	BOOST_TEST( grid.size( ) == 1 );
+	auto const same = grid.variant( base, 0 );
+	BOOST_TEST( *same.min_bg == 100.0 );
+	BOOST_TEST( same.autosens_max == base.autosens_max );
+
+	grid = make_grid( );
+	BOOST_TEST( grid.size( ) == 3*2*3*2 );
+	// index digits, fastest first: safety 1, autosens_max 1, autosens_min 0, target range 2
+	auto const index = 1 + 2*(1 + 3*(0 + 2*2));
+	auto const variant = grid.variant( base, index );
+	BOOST_TEST( variant.current_basal_safety_multiplier == 4.0 );
+	BOOST_TEST( variant.autosens_max == 1.5 );
+	BOOST_TEST( variant.autosens_min == 0.5 );
+	BOOST_TEST( *variant.min_bg == 110.0 );
+	BOOST_TEST( *variant.max_bg == 140.0 );
+	BOOST_TEST( !variant.target_bg );
+}
+
+BOOST_AUTO_TEST_CASE( sweep_matches_serial ) {
+	ns::profile_variant_t const base{ make_profile( ) };
+	auto const grid = make_grid( );
+	auto const snapshot = make_snapshot( 130.0, 1.0, 1.8 );
+	auto const serial = ns::sweep_determine_basal( snapshot, base, grid, 1 );
+	// small blocks so the grid spans many of them and every worker takes some
+	std::vector<ns::sweep_result_t> parallel( grid.size( ) );
+	size_t blocks = 0;
+	ns::sweep_determine_basal( snapshot, base, grid, [&]( ns::sweep_result_t const * results, size_t const count ) {
+		++blocks;
+		BOOST_REQUIRE( count <= 8 );
+		std::copy( results, results + count, parallel.begin( ) + static_cast<std::ptrdiff_t>(results->index) );
+	}, 4, 8 );
+	BOOST_TEST( blocks == (grid.size( ) + 7)/8 );
+	BOOST_REQUIRE_EQUAL( serial.size( ), grid.size( ) );
+	BOOST_REQUIRE_EQUAL( parallel.size( ), grid.size( ) );
+	for( size_t n = 0; n < grid.size( ); ++n ) {
+		BOOST_TEST( serial[n].index == n );
+		BOOST_TEST( parallel[n].index == n );
+		BOOST_TEST( serial[n].rate == parallel[n].rate );
+		BOOST_TEST( serial[n].reason_count == parallel[n].reason_count );
+		BOOST_TEST( serial[n].last_reason.code == parallel[n].last_reason.code );
+		BOOST_TEST( serial[n].target_bg == parallel[n].target_bg );
+		BOOST_TEST( !serial[n].failed );
+		BOOST_TEST( serial[n].duration.count( ) == parallel[n].duration.count( ) );
+		// the adjusted max_bg is below 130 for every variant, so each sets a high temp above the current one
+		BOOST_REQUIRE( serial[n].rate );
+		BOOST_TEST( *serial[n].rate > 1.0 );
+		BOOST_TEST( serial[n].duration.count( ) == 30 );
+
+		// the ratio is limited to the variant's autosens_max before the targets are adjusted
+		auto const variant = grid.variant( base, n );
+		auto const ratio = std::min( 1.8, variant.autosens_max );
+		auto const adjust = [ratio]( ns::glucose_t const value ) {
+			return std::round( (value - 60)/ratio ) + 60;
+		};
+		BOOST_TEST( serial[n].min_bg == adjust( *variant.min_bg ) );
+		BOOST_TEST( serial[n].max_bg == adjust( *variant.max_bg ) );
+		BOOST_TEST( serial[n].target_bg == adjust( (*variant.min_bg + *variant.max_bg)/2 ) );
+	}
+}
+
+BOOST_AUTO_TEST_CASE( sweep_limits_temp_to_max_safe_basal ) {
+	ns::profile_variant_t const base{ make_profile( ) };
+	auto const grid = make_grid( );
+	// a calibrating CGM sets the current basal, scaled by autosens, as the temp
+	auto const snapshot = make_snapshot( 20.0, 5.0, 2.0 );
+	size_t blocks = 0;
+	std::vector<bool> seen( grid.size( ), false );
+	ns::sweep_determine_basal( snapshot, base, grid, [&]( ns::sweep_result_t const * results, size_t const count ) {
+		++blocks;
+		for( size_t n = 0; n < count; ++n ) {
+			auto const & result = results[n];
+			BOOST_REQUIRE( result.index < seen.size( ) );
+			BOOST_TEST( !seen[result.index] );
+			seen[result.index] = true;
+			auto const variant = grid.variant( base, result.index );
+			auto const expected = std::min( std::min( 2.0, variant.autosens_max ), std::min( 3.0, variant.current_basal_safety_multiplier ) );
+			BOOST_REQUIRE( result.rate );
+			BOOST_TEST( std::abs( *result.rate - expected ) < 1.0e-9 );
+			BOOST_TEST( result.duration.count( ) == 30 );
+			BOOST_TEST( result.last_reason.code == ns::reason_code_t::cgm_calibrating_set_basal );
+			BOOST_TEST( result.last_reason[0] == std::min( 2.0, variant.autosens_max ) );
+			// a calibrating CGM stops before the targets
+			BOOST_TEST( result.target_bg == 0.0 );
+		}
+	}, 3 );
+	// the block size is picked to give each of the 3 threads 8 blocks, 36 variants round down to 1 per block
+	BOOST_TEST( blocks == grid.size( ) );
+	BOOST_TEST( std::all_of( seen.begin( ), seen.end( ), []( bool b ) { return b; } ) );
+
+	// temp below basal fails the variant instead of the sweep
+	auto const failing = ns::sweep_determine_basal( make_snapshot( 20.0, 0.1, 1.0 ), base, grid );
+	BOOST_TEST( std::all_of( failing.begin( ), failing.end( ), []( auto const & result ) { return result.failed; } ) );
+}
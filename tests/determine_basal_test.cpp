@@ -0,0 +1,293 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016 Darrell Wright
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#define BOOST_TEST_MODULE determine_basal_test 
+#include <boost/test/unit_test.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <initializer_list>
+#include <new>
+
+#include "data_types.h"
+#include "determine_basal_reason.h"
+#include "iob_forecast.h"
+#include "requested_temp.h"
+
+// Count every allocation so the decision path can be checked to make none
+namespace {
+	std::atomic<size_t> s_allocations{ 0 };
+}
+
+void * operator new( size_t size ) {
+	++s_allocations;
+	if( auto result = std::malloc( size == 0 ? 1 : size ) ) {
+		return result;
+	}
+	throw std::bad_alloc{ };
+}
+
+void operator delete( void * ptr ) noexcept {
+	std::free( ptr );
+}
+
+void operator delete( void * ptr, size_t ) noexcept {
+	std::free( ptr );
+}
+
+namespace {
+	struct temp_basal_functions_t {
+		ns::requested_temp_t set_temp_basal( ns::insulin_t rate, std::chrono::minutes duration, ns::profile_t const &, ns::reason_log_t const & reasons, ns::current_temp_t const & ) const {
+			ns::requested_temp_t result{ };
+			result.rate = rate;
+			result.duration = duration;
+			result.reason = reasons;
+			return result;
+		}
+	};	// temp_basal_functions_t
+
+	ns::profile_t make_profile( ) {
+		ns::profile_t result{ };
+		result.current_basal = 1.0;
+		result.min_bg = 100.0;
+		result.max_bg = 120.0;
+		result.max_basal = 3.0;
+		result.max_iob = 2.0;
+		result.sens = 50.0;
+		result.carb_ratio = 10.0;
+		return result;
+	}
+
+	ns::iob_data_t make_iob_data( ns::insulin_t const iob, double const activity ) {
+		return ns::iob_data_t{ 0.0, activity, iob, boost::none, boost::none, boost::none };
+	}
+
+	void check_reasons( ns::requested_temp_t const & result, std::initializer_list<ns::reason_code_t> codes ) {
+		BOOST_REQUIRE_EQUAL( result.reason.size( ), codes.size( ) );
+		size_t n = 0;
+		for( auto const code: codes ) {
+			BOOST_TEST( result.reason[n++].code == code );
+		}
+	}
+
+	void check_temp( ns::requested_temp_t const & result, ns::insulin_t const rate ) {
+		BOOST_REQUIRE( result.rate );
+		BOOST_TEST( std::abs( *result.rate - rate ) < 1.0e-9 );
+		BOOST_REQUIRE( result.duration );
+		BOOST_TEST( result.duration->count( ) == 30 );
+	}
+}
+
+BOOST_AUTO_TEST_CASE( determine_basal_cgm_calibrating ) {
+	auto const profile = make_profile( );
+	ns::iob_data_t const iob_data{ };
+	auto const result = ns::determine_basal( { 20.0, 0.0, 0.0 }, { 1.5 }, iob_data, profile, boost::none, { }, temp_basal_functions_t{ } );
+	BOOST_REQUIRE( result.rate );
+	BOOST_TEST( *result.rate == 1.0 );
+	BOOST_TEST( result.duration->count( ) == 30 );
+	BOOST_REQUIRE_EQUAL( result.reason.size( ), 2 );
+	BOOST_TEST( result.reason[0].code == ns::reason_code_t::cgm_calibrating );
+	BOOST_TEST( result.reason[1].code == ns::reason_code_t::cgm_calibrating_set_basal );
+	BOOST_TEST( result.reason_text( ) == "CGM is calibrating or in ??? state; setting current basal of 1 as temp" );
+
+	try {
+		ns::determine_basal( { 20.0, 0.0, 0.0 }, { 0.5 }, iob_data, profile, boost::none, { }, temp_basal_functions_t{ } );
+		BOOST_FAIL( "Expected a determine_basal_exception" );
+	} catch( ns::determine_basal_exception const & ex ) {
+		BOOST_TEST( std::string{ ex.what( ) } == "CGM is calibrating or in ??? state; temp 0.5 <~ current basal 1U/hr" );
+	}
+}
+
+BOOST_AUTO_TEST_CASE( determine_basal_autosens ) {
+	auto profile = make_profile( );
+	ns::iob_data_t const iob_data{ };
+	auto const result = ns::determine_basal( { 110.0, 0.0, 0.0 }, { 1.0 }, iob_data, profile, ns::autosense_data_t{ 1.25 }, { }, temp_basal_functions_t{ } );
+	// the targets drop to 92-108, so BG staying at 110 is high.  ISF drops to 40, 0.25U over 100
+	// is needed and the adjusted basal of 1.25 goes up by twice that
+	check_temp( result, 1.75 );
+	check_reasons( result, { ns::reason_code_t::basal_adjusted_autosens, ns::reason_code_t::target_bg_adjusted, ns::reason_code_t::bg_targets, ns::reason_code_t::predicted } );
+	BOOST_TEST( result.reason[0][1] == 1.25 );
+	BOOST_TEST( result.reason[1][0] == 110.0 );
+	BOOST_TEST( result.reason[1][1] == 100.0 );
+	BOOST_TEST( result.reason[2][0] == 92.0 );
+	BOOST_TEST( result.reason[2][1] == 108.0 );
+	BOOST_TEST( result.reason[2][2] == 100.0 );
+	BOOST_TEST( result.reason_text( ) == "Adjusting basal from 1 to 1.25; Adjusting target_bg from 110 to 100; min_bg 92, max_bg 108, target_bg 100; eventualBG 110, minPredBG 110" );
+
+	profile.temp_target_set = true;
+	auto const temp_target = ns::determine_basal( { 110.0, 0.0, 0.0 }, { 1.0 }, iob_data, profile, ns::autosense_data_t{ 1.0 }, { }, temp_basal_functions_t{ } );
+	BOOST_TEST( !temp_target.rate );
+	check_reasons( temp_target, { ns::reason_code_t::temp_target_set, ns::reason_code_t::bg_targets, ns::reason_code_t::predicted, ns::reason_code_t::in_range, ns::reason_code_t::no_decision } );
+}
+
+BOOST_AUTO_TEST_CASE( determine_basal_in_range ) {
+	auto const profile = make_profile( );
+	auto const iob_data = make_iob_data( 0.0, 0.0 );
+	auto const result = ns::determine_basal( { 110.0, 0.0, 0.0 }, { 1.0 }, iob_data, profile, boost::none, { }, temp_basal_functions_t{ } );
+	BOOST_TEST( !result.rate );
+	BOOST_TEST( !result.duration );
+	check_reasons( result, { ns::reason_code_t::bg_targets, ns::reason_code_t::predicted, ns::reason_code_t::in_range, ns::reason_code_t::no_decision } );
+	BOOST_TEST( result.reason_text( ) == "min_bg 100, max_bg 120, target_bg 110; eventualBG 110, minPredBG 110; 110-110 in range: no temp required; no change, temp 1U/hr left running" );
+
+	auto const low_temp = ns::determine_basal( { 110.0, 0.0, 0.0 }, { 0.5 }, iob_data, profile, boost::none, { }, temp_basal_functions_t{ } );
+	check_temp( low_temp, 1.0 );
+	check_reasons( low_temp, { ns::reason_code_t::bg_targets, ns::reason_code_t::predicted, ns::reason_code_t::in_range, ns::reason_code_t::set_current_basal } );
+}
+
+BOOST_AUTO_TEST_CASE( determine_basal_low ) {
+	auto profile = make_profile( );
+	// below the threshold of 75, half way from min_bg to 50
+	auto const suspend = ns::determine_basal( { 70.0, 0.0, 0.0 }, { 1.0 }, make_iob_data( 0.0, 0.0 ), profile, boost::none, { }, temp_basal_functions_t{ } );
+	check_temp( suspend, 0.0 );
+	check_reasons( suspend, { ns::reason_code_t::bg_targets, ns::reason_code_t::predicted, ns::reason_code_t::low_glucose_suspend } );
+	BOOST_TEST( suspend.reason[2][0] == 70.0 );
+	BOOST_TEST( suspend.reason[2][1] == 75.0 );
+
+	// 0.1U on board takes BG from 100 to 95, 15 below target needs -0.6U over twice that -0.6U
+	profile.current_basal = 2.0;
+	auto const low = ns::determine_basal( { 100.0, 0.0, 0.0 }, { 2.0 }, make_iob_data( 0.1, 0.0 ), profile, boost::none, { }, temp_basal_functions_t{ } );
+	check_temp( low, 0.8 );
+	check_reasons( low, { ns::reason_code_t::bg_targets, ns::reason_code_t::predicted, ns::reason_code_t::eventual_bg_below_min } );
+	BOOST_TEST( low.reason[2][0] == 95.0 );
+	BOOST_TEST( low.reason[2][1] == 100.0 );
+
+	// 0.5U on board and a delta of 2 gives an eventual BG of 75 + 6*2, but BG rises faster than the expected 1.3
+	auto const rising = ns::determine_basal( { 100.0, 2.0, 2.0 }, { 1.5 }, make_iob_data( 0.5, 0.0 ), profile, boost::none, { }, temp_basal_functions_t{ } );
+	check_temp( rising, 2.0 );
+	check_reasons( rising, { ns::reason_code_t::bg_targets, ns::reason_code_t::predicted, ns::reason_code_t::eventual_bg_below_min, ns::reason_code_t::eventual_bg_below_min_rising, ns::reason_code_t::set_current_basal } );
+	BOOST_TEST( rising.reason[2][0] == 87.0 );
+	BOOST_TEST( rising.reason[3][0] == 2.0 );
+	BOOST_TEST( rising.reason[3][1] == 1.3 );
+}
+
+BOOST_AUTO_TEST_CASE( determine_basal_high ) {
+	auto const profile = make_profile( );
+	// 70 over target needs 1.4U, twice that over the basal is limited to max_basal
+	auto const high = ns::determine_basal( { 180.0, 0.0, 0.0 }, { 1.0 }, make_iob_data( 0.0, 0.0 ), profile, boost::none, { }, temp_basal_functions_t{ } );
+	check_temp( high, 3.0 );
+	check_reasons( high, { ns::reason_code_t::bg_targets, ns::reason_code_t::predicted, ns::reason_code_t::rate_above_max_safe } );
+	BOOST_TEST( std::abs( high.reason[2][0] - 3.8 ) < 1.0e-9 );
+	BOOST_TEST( high.reason[2][1] == 3.0 );
+
+	auto const running = ns::determine_basal( { 180.0, 0.0, 0.0 }, { 3.0 }, make_iob_data( 0.0, 0.0 ), profile, boost::none, { }, temp_basal_functions_t{ } );
+	BOOST_TEST( !running.rate );
+	check_reasons( running, { ns::reason_code_t::bg_targets, ns::reason_code_t::predicted, ns::reason_code_t::rate_above_max_safe, ns::reason_code_t::temp_above_required, ns::reason_code_t::no_decision } );
+
+	// 1.8U on board takes BG from 300 to 210, the 2U needed is limited to the 0.2U left under max_iob
+	auto const limited = ns::determine_basal( { 300.0, 0.0, 0.0 }, { 1.0 }, make_iob_data( 1.8, 0.0 ), profile, boost::none, { }, temp_basal_functions_t{ } );
+	check_temp( limited, 1.4 );
+	check_reasons( limited, { ns::reason_code_t::bg_targets, ns::reason_code_t::predicted, ns::reason_code_t::insulin_req_limited } );
+	BOOST_TEST( limited.reason[1][0] == 210.0 );
+	BOOST_TEST( limited.reason[2][0] == 2.0 );
+
+	auto const above_max_iob = ns::determine_basal( { 300.0, 0.0, 0.0 }, { 1.0 }, make_iob_data( 2.5, 0.0 ), profile, boost::none, { }, temp_basal_functions_t{ } );
+	BOOST_TEST( !above_max_iob.rate );
+	check_reasons( above_max_iob, { ns::reason_code_t::bg_targets, ns::reason_code_t::predicted, ns::reason_code_t::iob_above_max, ns::reason_code_t::no_decision } );
+}
+
+BOOST_AUTO_TEST_CASE( determine_basal_predictions ) {
+	auto const profile = make_profile( );
+	// BG falling at the 2.5 mg/dL per 5 minutes the activity explains.  Held for 4 hours it reaches 30
+	auto const iob_data = make_iob_data( 0.4, 0.01 );
+	ns::glucose_status_t const falling{ 150.0, -2.5, -2.5 };
+	auto const held = ns::determine_basal( falling, { 1.0 }, iob_data, profile, boost::none, { }, temp_basal_functions_t{ } );
+	check_temp( held, 0.0 );
+	check_reasons( held, { ns::reason_code_t::bg_targets, ns::reason_code_t::predicted, ns::reason_code_t::low_glucose_suspend } );
+	BOOST_TEST( std::abs( held.reason[2][0] - 30.0 ) < 1.0e-9 );
+
+	// when the activity ends after 30 minutes BG levels out at 135, eventual BG is 150 - 0.4U*50 and
+	// 0.4U is needed to bring 130 to target
+	ns::iob_forecast_t forecast{ std::chrono::system_clock::now( ), std::chrono::minutes{ 5 }, 24 };
+	std::fill( forecast.activity.begin( ), forecast.activity.end( ), 0.0 );
+	std::fill( forecast.activity.begin( ), forecast.activity.begin( ) + 6, 0.01 );
+	auto const forecast_temp = ns::determine_basal( falling, { 1.0 }, iob_data, forecast, profile, boost::none, { }, temp_basal_functions_t{ } );
+	check_temp( forecast_temp, 1.8 );
+	check_reasons( forecast_temp, { ns::reason_code_t::bg_targets, ns::reason_code_t::predicted } );
+	BOOST_TEST( forecast_temp.reason[1][0] == 130.0 );
+	BOOST_TEST( forecast_temp.reason[1][1] == 135.0 );
+
+	ns::iob_forecast_t const coarse{ std::chrono::system_clock::now( ), std::chrono::minutes{ 10 }, 12 };
+	BOOST_CHECK_THROW( ns::determine_basal( falling, { 1.0 }, iob_data, coarse, profile, boost::none, { }, temp_basal_functions_t{ } ), ns::determine_basal_exception );
+}
+
+BOOST_AUTO_TEST_CASE( determine_basal_carbs ) {
+	auto const profile = make_profile( );
+	auto const iob_data = make_iob_data( 0.0, 0.0 );
+	ns::glucose_status_t const rising{ 110.0, 3.0, 3.0 };
+	// without carbs the deviation of 3 decays over an hour, BG levels out at 126.5
+	auto const no_carbs = ns::determine_basal( rising, { 1.0 }, iob_data, profile, boost::none, { }, temp_basal_functions_t{ } );
+	check_temp( no_carbs, 1.68 );
+	BOOST_TEST( no_carbs.reason[1][0] == 128.0 );
+	BOOST_TEST( no_carbs.reason[1][1] == 127.0 );
+
+	// 30g absorb over the 3 hour limit, adding 52.5 mg/dL over the IOB curve's start.  The lowest point after
+	// 90 minutes is 149.75
+	ns::meal_data_t const meal_data{ 30.0, 0.0, 0.0 };
+	auto const carbs = ns::determine_basal( rising, { 1.0 }, iob_data, profile, boost::none, meal_data, temp_basal_functions_t{ } );
+	check_temp( carbs, 2.6 );
+	check_reasons( carbs, { ns::reason_code_t::bg_targets, ns::reason_code_t::predicted } );
+	BOOST_TEST( carbs.reason[1][0] == 163.0 );
+	BOOST_TEST( carbs.reason[1][1] == 150.0 );
+
+	auto no_sens = profile;
+	no_sens.sens = boost::none;
+	BOOST_CHECK_THROW( ns::determine_basal( rising, { 1.0 }, iob_data, no_sens, boost::none, { }, temp_basal_functions_t{ } ), ns::determine_basal_exception );
+}
+
+BOOST_AUTO_TEST_CASE( determine_basal_no_allocations ) {
+	auto const profile = make_profile( );
+	ns::iob_data_t const iob_data{ };
+	boost::optional<ns::autosense_data_t> const autosense_data{ ns::autosense_data_t{ 1.25 } };
+	ns::glucose_status_t const calibrating{ 20.0, 0.0, 0.0 };
+	ns::glucose_status_t const in_range{ 110.0, 0.0, 0.0 };
+	size_t reasons = 0;
+	// the first call on a thread claims its latency histograms
+	ns::determine_basal( in_range, { 1.0 }, iob_data, profile, autosense_data, { }, temp_basal_functions_t{ } );
+
+	auto const allocations_before = s_allocations.load( );
+	for( size_t n = 0; n < 100; ++n ) {
+		reasons += ns::determine_basal( calibrating, { 1.5 }, iob_data, profile, autosense_data, { }, temp_basal_functions_t{ } ).reason.size( );
+		reasons += ns::determine_basal( in_range, { 1.0 }, iob_data, profile, autosense_data, { }, temp_basal_functions_t{ } ).reason.size( );
+	}
+	auto const allocations = s_allocations.load( ) - allocations_before;
+	BOOST_TEST( allocations == 0 );
+	BOOST_TEST( reasons == 700 );
+}
+
+BOOST_AUTO_TEST_CASE( reason_log_capacity ) {
+	ns::reason_log_t log;
+	BOOST_TEST( log.empty( ) );
+	for( size_t n = 0; n < ns::reason_log_t::capacity + 3; ++n ) {
+		log.add( ns::reason_code_t::target_bg_unchanged, static_cast<double>( n ) );
+	}
+	BOOST_TEST( log.size( ) == ns::reason_log_t::capacity );
+	BOOST_TEST( log.dropped( ) == 3 );
+	BOOST_TEST( log.contains( ns::reason_code_t::target_bg_unchanged ) );
+	BOOST_TEST( !log.contains( ns::reason_code_t::temp_target_set ) );
+	auto const text = ns::to_string( log );
+	BOOST_TEST( text.find( "target_bg unchanged: 15; 3 more" ) != std::string::npos );
+	log.clear( );
+	BOOST_TEST( log.empty( ) );
+	BOOST_TEST( log.dropped( ) == 0 );
+}
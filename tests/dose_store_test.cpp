@@ -0,0 +1,77 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016 Darrell Wright
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#define BOOST_TEST_MODULE dose_store_test 
+#include <boost/test/unit_test.hpp>
+
+#include <chrono>
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include "dose_store.h"
+#include "iob_calc.h"
+
+using namespace std::chrono;
+
+BOOST_AUTO_TEST_CASE( dose_store_matches_doses ) {
+	constexpr ns::insulin_duration_t durations[] = { ns::insulin_duration_t::t180, ns::insulin_duration_t::t210, ns::insulin_duration_t::t240, ns::insulin_duration_t::t300, ns::insulin_duration_t::t360 };
+	auto const start = time_point_cast<minutes>( system_clock::now( ) );
+	std::mt19937 rng{ 1 };
+	std::uniform_int_distribution<size_t> duration_dist{ 0, 4 };
+	std::uniform_real_distribution<double> amount_dist{ 0.025, 2.0 };
+	std::uniform_int_distribution<int> late_dist{ 0, 30 };
+
+	ns::dose_store store;
+	std::vector<ns::dose> doses;
+	for( int minute = 0; minute < 24*60; ++minute ) {
+		auto const now = start + minutes{ minute };
+		// mostly in order, sometimes a little late
+		doses.emplace_back( amount_dist( rng ), durations[duration_dist( rng )], now - minutes{ minute % 17 == 0 ? late_dist( rng ) : 0 } );
+		store.push_back( doses.back( ) );
+		if( minute % 5 != 0 ) {
+			continue;
+		}
+		store.expire( now );
+		ns::iob_activity_t expected{ 0.0, 0.0 };
+		size_t active = 0;
+		for( auto const & item: doses ) {
+			auto const age = duration_cast<minutes>( now - item.dose_time ).count( );
+			if( age < static_cast<intmax_t>(item.dose_dia) ) {
+				++active;
+			}
+			auto const pct = ns::insulin_on_board_activity_pct( static_cast<double>(age), item.dose_dia );
+			expected.iob += static_cast<double>(static_cast<float>(item.amount)) * pct.iob;
+			expected.activity += static_cast<double>(static_cast<float>(item.amount)) * pct.activity;
+		}
+		auto const result = store.on_board( now );
+		BOOST_TEST( store.size( ) == active );
+		BOOST_TEST( std::abs( expected.iob - result.iob ) < 1.0e-9 );
+		BOOST_TEST( std::abs( expected.activity - result.activity ) < 1.0e-9 );
+		// once the longest curve is full, the allocation including spare capacity is under half of ns::dose
+		if( minute >= 6*60 ) {
+			BOOST_TEST( static_cast<double>(store.memory_used( ))/static_cast<double>(store.size( )) < static_cast<double>(sizeof( ns::dose ))/2.0 );
+		}
+	}
+	store.expire( start + 48h );
+	BOOST_TEST( store.empty( ) );
+}
@@ -0,0 +1,147 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016 Darrell Wright
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#define BOOST_TEST_MODULE history_archive_test 
+#include <boost/test/unit_test.hpp>
+
+#include <boost/filesystem.hpp>
+#include <algorithm>
+#include <chrono>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "data_types.h"
+#include "history_archive.h"
+#include "lib_iob_history.h"
+
+using namespace std::chrono;
+using namespace ns::lib::iob;
+
+namespace {
+	ns::timestamp_t const s_day{ hours{ 24*365*47 } };
+
+	struct archive_file_t {
+		std::string path;
+
+		archive_file_t( ):
+				path{ (boost::filesystem::temp_directory_path( ) / boost::filesystem::unique_path( )).string( ) } { }
+
+		~archive_file_t( ) {
+			boost::filesystem::remove( path );
+			boost::filesystem::remove( path + ".idx" );
+		}
+
+		archive_file_t( archive_file_t const & ) = delete;
+		archive_file_t & operator=( archive_file_t const & ) = delete;
+	};	// archive_file_t
+
+	// a bolus every 5 minutes and a temp basal every 30
+	std::vector<pump_history_t> make_history( ns::timestamp_t start, size_t count ) {
+		std::vector<pump_history_t> result;
+		for( size_t n = 0; n < count; ++n ) {
+			auto const when = start + minutes{ 5*n };
+			if( n % 6 == 0 ) {
+				result.push_back( { pump_history_types::TempBasal, when, 0.0, 0.05*static_cast<double>(n % 40), pump_temp_basal_types::Absolute, minutes{ 0 } } );
+				result.push_back( { pump_history_types::TempBasalDuration, when, 0.0, 0.0, pump_temp_basal_types::Absolute, minutes{ 30 } } );
+			} else {
+				result.push_back( { pump_history_types::Bolus, when, 0.1*static_cast<double>(n % 7), 0.0, pump_temp_basal_types::Absolute, minutes{ 0 } } );
+			}
+		}
+		return result;
+	}
+
+	size_t count_between( std::vector<pump_history_t> const & history, ns::timestamp_t t0, ns::timestamp_t t1 ) {
+		return static_cast<size_t>(std::count_if( history.begin( ), history.end( ), [&]( auto const & item ) {
+			return item.timestamp >= t0 && item.timestamp < t1;
+		} ));
+	}
+}
+
+BOOST_AUTO_TEST_CASE( history_archive_round_trip ) {
+	archive_file_t const file;
+	auto const history = make_history( s_day, 100 );
+	{
+		ns::history_archive::writer archive{ file.path };
+		archive.append( history );
+	}
+	ns::history_archive::reader const archive{ file.path };
+	BOOST_REQUIRE_EQUAL( archive.size( ), history.size( ) );
+	size_t n = 0;
+	for( auto const & record: archive.all( ) ) {
+		auto const item = record.to_history( );
+		BOOST_TEST( (item.type == history[n].type) );
+		BOOST_TEST( (item.timestamp == history[n].timestamp) );
+		BOOST_TEST( item.amount == history[n].amount );
+		BOOST_TEST( item.rate == history[n].rate );
+		BOOST_TEST( (item.temp_type == history[n].temp_type) );
+		BOOST_TEST( item.duration.count( ) == history[n].duration.count( ) );
+		++n;
+	}
+}
+
+BOOST_AUTO_TEST_CASE( history_archive_range ) {
+	archive_file_t const file;
+	auto const history = make_history( s_day, 5000 );
+	{
+		// small stride so queries cross index blocks, appended in pieces
+		ns::history_archive::writer archive{ file.path, 16 };
+		archive.append( history.data( ), 1000 );
+	}
+	{
+		ns::history_archive::writer archive{ file.path };
+		archive.append( history.data( ) + 1000, history.size( ) - 1000 );
+	}
+	ns::history_archive::reader const archive{ file.path };
+	BOOST_REQUIRE_EQUAL( archive.size( ), history.size( ) );
+	for( auto const & offset: { -10min, 0min, 3min, 5min, 30min, 1234min, 25000min } ) {
+		for( auto const & length: { 0min, 1min, 5min, 60min, 1440min, 40000min } ) {
+			auto const t0 = s_day + offset;
+			auto const t1 = t0 + length;
+			auto const result = archive.range( t0, t1 );
+			BOOST_REQUIRE_EQUAL( result.size( ), count_between( history, t0, t1 ) );
+			for( auto const & record: result ) {
+				BOOST_TEST( (record.timestamp( ) >= t0 && record.timestamp( ) < t1) );
+			}
+		}
+	}
+}
+
+BOOST_AUTO_TEST_CASE( history_archive_rejects_older_records ) {
+	archive_file_t const file;
+	auto const history = make_history( s_day, 10 );
+	ns::history_archive::writer archive{ file.path };
+	archive.append( history );
+	BOOST_CHECK_THROW( archive.append( make_history( s_day, 1 ) ), std::runtime_error );
+	BOOST_REQUIRE_EQUAL( archive.size( ), history.size( ) );
+	BOOST_TEST( (archive.newest( ) == history.back( ).timestamp) );
+}
+
+BOOST_AUTO_TEST_CASE( history_archive_empty ) {
+	archive_file_t const file;
+	{
+		ns::history_archive::writer archive{ file.path };
+	}
+	ns::history_archive::reader const archive{ file.path };
+	BOOST_TEST( archive.size( ) == 0u );
+	BOOST_TEST( archive.range( s_day, s_day + 24h ).empty( ) );
+}
@@ -0,0 +1,93 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016 Darrell Wright
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#define BOOST_TEST_MODULE iob_accumulator_test 
+#include <boost/test/unit_test.hpp>
+
+#include <chrono>
+#include <cmath>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+#include "iob_accumulator.h"
+#include "iob_calc.h"
+
+using namespace std::chrono;
+
+namespace {
+	constexpr ns::insulin_duration_t durations[] = { ns::insulin_duration_t::t180, ns::insulin_duration_t::t210, ns::insulin_duration_t::t240, ns::insulin_duration_t::t300, ns::insulin_duration_t::t360 };
+
+	ns::iob_activity_t rescan( system_clock::time_point const & now, std::vector<ns::dose> const & doses ) {
+		ns::iob_activity_t result{ 0.0, 0.0 };
+		for( auto const & item: doses ) {
+			auto const age = duration_cast<minutes>( now - item.dose_time ).count( );
+			auto const pct = ns::insulin_on_board_activity_pct( static_cast<double>(age), item.dose_dia );
+			result.iob += item.amount * pct.iob;
+			result.activity += item.amount * pct.activity;
+		}
+		return result;
+	}
+}
+
+BOOST_AUTO_TEST_CASE( iob_accumulator_matches_rescan ) {
+	auto const start = time_point_cast<minutes>( system_clock::now( ) );
+	ns::iob_accumulator accumulator{ start };
+	std::vector<ns::dose> doses;
+	std::mt19937 rng{ 1 };
+	std::uniform_int_distribution<size_t> duration_dist{ 0, 4 };
+	std::uniform_int_distribution<int> offset_dist{ -400, 60 };
+	std::uniform_real_distribution<double> amount_dist{ 0.025, 2.0 };
+
+	for( int minute = 0; minute < 24*60; minute += 5 ) {
+		auto const now = start + minutes{ minute };
+		accumulator.advance( now );
+		for( size_t n=0; n<3; ++n ) {
+			doses.emplace_back( amount_dist( rng ), durations[duration_dist( rng )], now + minutes{ offset_dist( rng ) } );
+			accumulator.add( doses.back( ) );
+		}
+		auto const expected = rescan( now, doses );
+		BOOST_TEST( std::abs( expected.iob - accumulator.iob( ) ) < 1.0e-9 );
+		BOOST_TEST( std::abs( expected.activity - accumulator.activity( ) ) < 1.0e-9 );
+	}
+}
+
+BOOST_AUTO_TEST_CASE( iob_accumulator_expires_doses ) {
+	auto const start = time_point_cast<minutes>( system_clock::now( ) );
+	ns::iob_accumulator accumulator{ start };
+	accumulator.add( ns::dose{ 1.0, ns::insulin_duration_t::t180, start } );
+	accumulator.add( ns::dose{ 1.0, ns::insulin_duration_t::t360, start + 30min } );
+	BOOST_TEST( accumulator.size( ) == 2 );
+	BOOST_TEST( accumulator.iob( ) == 2.0 );
+
+	accumulator.advance( start + 180min );
+	BOOST_TEST( accumulator.size( ) == 1 );
+	accumulator.advance( start + 390min );
+	BOOST_TEST( accumulator.empty( ) );
+	BOOST_TEST( accumulator.iob( ) == 0.0 );
+	BOOST_TEST( accumulator.activity( ) == 0.0 );
+
+	// already expired when added
+	accumulator.add( ns::dose{ 1.0, ns::insulin_duration_t::t240, start } );
+	BOOST_TEST( accumulator.empty( ) );
+	BOOST_CHECK_THROW( accumulator.advance( start ), std::runtime_error );
+}
@@ -0,0 +1,105 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016 Darrell Wright
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#define BOOST_TEST_MODULE iob_backfill_test 
+#include <boost/test/unit_test.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+#include "data_types.h"
+#include "iob_backfill.h"
+#include "lib_iob_history.h"
+#include "lib_iob_total.h"
+#include "tz_cache.h"
+
+using namespace std::chrono;
+using namespace ns::lib::iob;
+
+namespace {
+	ns::timestamp_t const s_day{ hours{ 24*365*47 } };
+	std::vector<basal_profile_entry_t> const s_basal_profile = { { minutes{ 0 }, 0.8 }, { hours{ 6 }, 1.2 }, { hours{ 22 }, 0.9 } };
+
+	// newest first like the pump, a temp every 30 minutes, some running long, and boluses at meal times
+	std::vector<pump_history_t> make_history( size_t const days ) {
+		std::vector<pump_history_t> result;
+		for( size_t n = 0; n < days*48; ++n ) {
+			auto const when = s_day + minutes{ 30*n + (n*7) % 11 };
+			auto const length = n % 13 == 0 ? minutes{ 150 } : minutes{ 30 };
+			result.push_back( { pump_history_types::TempBasalDuration, when, 0.0, 0.0, pump_temp_basal_types::Absolute, length } );
+			result.push_back( { pump_history_types::TempBasal, when, 0.0, 0.2*static_cast<double>(n % 9), pump_temp_basal_types::Absolute, minutes{ 0 } } );
+			if( n % 16 == 5 ) {
+				result.push_back( { pump_history_types::Bolus, when + minutes{ 3 }, 0.5 + 0.5*static_cast<double>(n % 5), 0.0, pump_temp_basal_types::Absolute, minutes{ 0 } } );
+			}
+		}
+		std::reverse( result.begin( ), result.end( ) );
+		return result;
+	}
+}
+
+BOOST_AUTO_TEST_CASE( backfill_matches_single_pass ) {
+	auto const history = make_history( 6 );
+	ns::tz_cache_t const tz{ hours{ -5 } };
+	ns::profile_t const profile{ };
+	auto const start = s_day + hours{ 12 };
+	auto const end = s_day + hours{ 24*5 + 7 };
+	auto const result = backfill_iob( history.data( ), history.size( ), s_basal_profile, tz, 3.0, profile, start, end, minutes{ 5 }, 4 );
+	BOOST_REQUIRE_EQUAL( result.size( ), static_cast<size_t>((end - start)/minutes{ 5 }) );
+
+	auto const treatments = iob_treatments( calc_temp_treatments( history.data( ), history.size( ), s_basal_profile, tz ) );
+	for( size_t n = 0; n < result.size( ); ++n ) {
+		auto const expected = ns::iob_total( treatments, 3.0, profile, result.time_at( n ) );
+		BOOST_TEST( result.iob[n] == expected.iob );
+		BOOST_TEST( result.activity[n] == expected.activity );
+		BOOST_TEST( result.bolussnooze[n] == expected.bolussnooze );
+		BOOST_TEST( result.basaliob[n] == *expected.basaliob );
+		BOOST_TEST( result.netbasalinsulin[n] == *expected.netbasalinsulin );
+		BOOST_TEST( result.hightempinsulin[n] == *expected.hightempinsulin );
+	}
+	BOOST_TEST( *std::max_element( result.iob.begin( ), result.iob.end( ) ) > 1.0 );
+	BOOST_TEST( *std::min_element( result.basaliob.begin( ), result.basaliob.end( ) ) < 0.0 );
+}
+
+BOOST_AUTO_TEST_CASE( backfill_same_for_any_threads ) {
+	auto const history = make_history( 10 );
+	ns::tz_cache_t const tz{ hours{ 2 } };
+	ns::profile_t const profile{ };
+	auto const start = s_day + minutes{ 1 };
+	auto const end = s_day + hours{ 24*10 };
+	auto const serial = backfill_iob( history.data( ), history.size( ), s_basal_profile, tz, 4.0, profile, start, end, minutes{ 5 }, 1 );
+	for( size_t const threads: { 2, 3, 8, 0 } ) {
+		auto const parallel = backfill_iob( history.data( ), history.size( ), s_basal_profile, tz, 4.0, profile, start, end, minutes{ 5 }, threads );
+		BOOST_TEST( parallel.iob == serial.iob, boost::test_tools::per_element( ) );
+		BOOST_TEST( parallel.activity == serial.activity, boost::test_tools::per_element( ) );
+		BOOST_TEST( parallel.basaliob == serial.basaliob, boost::test_tools::per_element( ) );
+		BOOST_TEST( parallel.netbasalinsulin == serial.netbasalinsulin, boost::test_tools::per_element( ) );
+	}
+}
+
+BOOST_AUTO_TEST_CASE( backfill_empty ) {
+	ns::tz_cache_t const tz{ hours{ 0 } };
+	auto const result = backfill_iob( nullptr, 0, s_basal_profile, tz, 3.0, ns::profile_t{ }, s_day, s_day + hours{ 1 } );
+	BOOST_REQUIRE_EQUAL( result.size( ), 12u );
+	BOOST_TEST( result.iob[11] == 0.0 );
+	BOOST_TEST( backfill_iob( nullptr, 0, s_basal_profile, tz, 3.0, ns::profile_t{ }, s_day, s_day ).size( ) == 0u );
+}
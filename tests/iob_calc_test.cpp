@@ -83,3 +83,57 @@ BOOST_AUTO_TEST_CASE( insulin_on_board_pct, *boost::unit_test::tolerance( 1.0e-1
 	}
 
 }
+
+BOOST_AUTO_TEST_CASE( insulin_on_board_pct_batch, *boost::unit_test::tolerance( 1.0e-10 ) ) {
+	auto test_data = daw::json::from_file<test_data_t>( "../tests/iob_calc_test.json" );
+	std::vector<double> ages;
+	std::vector<ns::insulin_duration_t> durations;
+	std::vector<double> expected;
+	for( auto const & test: test_data.tests ) {
+		ages.push_back( test.time_offset );
+		durations.push_back( test.insulin_duration );
+		expected.push_back( test.expected );
+	}
+	// fractional, future and expired ages against the scalar function
+	for( double age = -10.0; age <= 370.0; age += 0.25 ) {
+		for( auto const duration: { ns::insulin_duration_t::t180, ns::insulin_duration_t::t210, ns::insulin_duration_t::t240, ns::insulin_duration_t::t300, ns::insulin_duration_t::t360 } ) {
+			ages.push_back( age );
+			durations.push_back( duration );
+			expected.push_back( ns::insulin_on_board_pct( age, duration ) );
+		}
+	}
+	std::vector<double> results( ages.size( ) );
+	ns::insulin_on_board_pct( ages.data( ), durations.data( ), results.data( ), ages.size( ) );
+	for( size_t n=0; n<results.size( ); ++n ) {
+		BOOST_TEST( expected[n] == results[n] );
+	}
+	std::vector<double> const amounts( ages.size( ), 0.5 );
+	auto const total = std::accumulate( expected.begin( ), expected.end( ), 0.0 ) * 0.5;
+	BOOST_TEST( total == ns::insulin_on_board( amounts.data( ), ages.data( ), durations.data( ), ages.size( ) ) );
+}
+
+BOOST_AUTO_TEST_CASE( insulin_on_board_activity_pct, *boost::unit_test::tolerance( 1.0e-8 ) ) {
+	std::vector<double> ages;
+	std::vector<ns::insulin_duration_t> durations;
+	for( double age = -10.0; age <= 370.0; age += 0.25 ) {
+		for( auto const duration: { ns::insulin_duration_t::t180, ns::insulin_duration_t::t210, ns::insulin_duration_t::t240, ns::insulin_duration_t::t300, ns::insulin_duration_t::t360 } ) {
+			ages.push_back( age );
+			durations.push_back( duration );
+		}
+	}
+	std::vector<double> iob( ages.size( ) );
+	std::vector<double> activity( ages.size( ) );
+	ns::insulin_on_board_activity_pct( ages.data( ), durations.data( ), iob.data( ), activity.data( ), ages.size( ) );
+	double const h = 1.0e-5;
+	for( size_t n=0; n<ages.size( ); ++n ) {
+		auto const & age = ages[n];
+		auto const & duration = durations[n];
+		BOOST_TEST( ns::insulin_on_board_pct( age, duration ) == iob[n] );
+		BOOST_TEST( ns::insulin_on_board_activity_pct( age, duration ).activity == activity[n] );
+		// activity is the rate insulin leaves the board
+		if( age > 1.0 && age < static_cast<double>(duration) - 1.0 ) {
+			auto const slope = (ns::insulin_on_board_pct( age - h, duration ) - ns::insulin_on_board_pct( age + h, duration ))/(2.0*h);
+			BOOST_TEST( slope == activity[n] );
+		}
+	}
+}
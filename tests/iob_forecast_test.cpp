@@ -0,0 +1,69 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016 Darrell Wright
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#define BOOST_TEST_MODULE iob_forecast_test 
+#include <boost/test/unit_test.hpp>
+
+#include <chrono>
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include "iob_calc.h"
+#include "iob_forecast.h"
+#include "iob_infusion.h"
+
+using namespace std::chrono;
+
+BOOST_AUTO_TEST_CASE( iob_forecast_matches_per_dose ) {
+	constexpr ns::insulin_duration_t durations[] = { ns::insulin_duration_t::t180, ns::insulin_duration_t::t210, ns::insulin_duration_t::t240, ns::insulin_duration_t::t300, ns::insulin_duration_t::t360 };
+	auto const start = system_clock::now( );
+	std::mt19937 rng{ 1 };
+	std::uniform_int_distribution<size_t> duration_dist{ 0, 4 };
+	std::uniform_int_distribution<int> offset_dist{ -400*60, 60*60 };
+	std::uniform_real_distribution<double> amount_dist{ 0.025, 2.0 };
+
+	std::vector<ns::dose> doses;
+	for( size_t n=0; n<200; ++n ) {
+		doses.emplace_back( amount_dist( rng ), durations[duration_dist( rng )], start + seconds{ offset_dist( rng ) } );
+	}
+	std::vector<ns::infusion> infusions;
+	infusions.emplace_back( 0.8, start - 3h, start - 1h );
+	infusions.emplace_back( 1.4, start - 1h, start + 30min, ns::insulin_duration_t::t300 );
+
+	auto const forecast = ns::forecast_iob( doses, infusions, start, 6h );
+	BOOST_REQUIRE( forecast.size( ) == 72 );
+	for( size_t k=0; k<forecast.size( ); ++k ) {
+		auto const when = forecast.time_at( k );
+		ns::iob_activity_t expected{ 0.0, 0.0 };
+		for( auto const & item: doses ) {
+			auto const pct = ns::insulin_on_board_activity_pct( duration<double, minutes::period>( when - item.dose_time ).count( ), item.dose_dia );
+			expected.iob += item.amount * pct.iob;
+			expected.activity += item.amount * pct.activity;
+		}
+		for( auto const & item: infusions ) {
+			expected += ns::insulin_on_board_activity( item, when );
+		}
+		BOOST_TEST( std::abs( expected.iob - forecast.iob[k] ) < 1.0e-9 );
+		BOOST_TEST( std::abs( expected.activity - forecast.activity[k] ) < 1.0e-9 );
+	}
+}
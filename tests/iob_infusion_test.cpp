@@ -0,0 +1,119 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016 Darrell Wright
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#define BOOST_TEST_MODULE iob_infusion_test 
+#include <boost/test/unit_test.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+#include "iob_accumulator.h"
+#include "iob_calc.h"
+#include "iob_infusion.h"
+
+using namespace std::chrono;
+
+namespace {
+	constexpr ns::insulin_duration_t durations[] = { ns::insulin_duration_t::t180, ns::insulin_duration_t::t210, ns::insulin_duration_t::t240, ns::insulin_duration_t::t300, ns::insulin_duration_t::t360 };
+
+	/// The segment as many small doses at the midpoint of each step
+	ns::iob_activity_t discretized( ns::infusion const & item, system_clock::time_point const & now ) {
+		double const step = 0.01;
+		ns::iob_activity_t result{ 0.0, 0.0 };
+		auto const length = duration<double, minutes::period>( item.end - item.start ).count( );
+		auto const age_of_start = duration<double, minutes::period>( now - item.start ).count( );
+		for( double t = step/2.0; t < length && t < age_of_start; t += step ) {
+			auto const pct = ns::insulin_on_board_activity_pct( age_of_start - t, item.dose_dia );
+			result.iob += item.rate/60.0 * step * pct.iob;
+			result.activity += item.rate/60.0 * step * pct.activity;
+		}
+		// the curve steps down from 100% just after age 0 and to 0% at age dia, insulin crossing either step is absorbed at once
+		auto const dia = static_cast<double>(item.dose_dia);
+		auto const newest = std::max( age_of_start - length, 0.0 );
+		if( newest == 0.0 && age_of_start > 0.0 ) {
+			result.activity += item.rate/60.0 * (1.0 - ns::insulin_on_board_pct( 1.0e-9, item.dose_dia ));
+		}
+		if( age_of_start >= dia && newest < dia ) {
+			result.activity += item.rate/60.0 * ns::insulin_on_board_pct( dia - 1.0e-9, item.dose_dia );
+		}
+		return result;
+	}
+}
+
+BOOST_AUTO_TEST_CASE( infusion_matches_discretized ) {
+	auto const start = time_point_cast<minutes>( system_clock::now( ) );
+	for( auto const duration: durations ) {
+		ns::infusion const item{ 1.5, start, start + 90min, duration };
+		for( auto offset = -10min; offset <= minutes{ static_cast<intmax_t>(duration) } + 100min; offset += 7min ) {
+			auto const expected = discretized( item, start + offset );
+			auto const result = ns::insulin_on_board_activity( item, start + offset );
+			BOOST_TEST( std::abs( expected.iob - result.iob ) < 1.0e-5 );
+			BOOST_TEST( std::abs( expected.activity - result.activity ) < 1.0e-5 );
+		}
+	}
+}
+
+BOOST_AUTO_TEST_CASE( infusion_delivered_is_on_board ) {
+	auto const start = time_point_cast<minutes>( system_clock::now( ) );
+	ns::infusion const item{ 1.2, start, start + 60min, ns::insulin_duration_t::t240 };
+	BOOST_TEST( std::abs( item.amount( ) - 1.2 ) < 1.0e-12 );
+	BOOST_TEST( ns::insulin_on_board_activity( item, start ).iob == 0.0 );
+	// right after delivery almost all of it is still on board
+	auto const delivered = ns::insulin_on_board_activity( item, start + 60min );
+	BOOST_TEST( delivered.iob < item.amount( ) );
+	BOOST_TEST( delivered.iob > 0.9*item.amount( ) );
+	BOOST_TEST( ns::insulin_on_board_activity( item, item.expires( ) ).iob == 0.0 );
+}
+
+BOOST_AUTO_TEST_CASE( infusion_activity_endpoints ) {
+	auto const start = time_point_cast<minutes>( system_clock::now( ) );
+	for( auto const duration: durations ) {
+		auto const dia = static_cast<double>(duration);
+		ns::infusion const item{ 1.5, start, start + 60min, duration };
+		// while running the newest insulin is at age 0 and fully on board
+		auto const running = ns::insulin_on_board_activity( item, start + 30min );
+		BOOST_TEST( std::abs( running.activity - 1.5/60.0*(1.0 - ns::insulin_on_board_pct( 30.0, duration )) ) < 1.0e-12 );
+		// the oldest insulin is at age dia and has none left on board
+		auto const expiring = ns::insulin_on_board_activity( item, start + minutes{ static_cast<intmax_t>(duration) } + 10min );
+		BOOST_TEST( std::abs( expiring.activity - 1.5/60.0*ns::insulin_on_board_pct( dia - 50.0, duration ) ) < 1.0e-12 );
+	}
+}
+
+BOOST_AUTO_TEST_CASE( infusion_accumulator ) {
+	auto const start = time_point_cast<minutes>( system_clock::now( ) );
+	ns::iob_accumulator accumulator{ start };
+	// contiguous segments at the same rate are merged
+	for( auto offset = 0min; offset < 60min; offset += 5min ) {
+		accumulator.add( ns::infusion{ 1.0, start + offset, start + offset + 5min } );
+	}
+	accumulator.add( ns::dose{ 2.0, ns::insulin_duration_t::t240, start } );
+	BOOST_TEST( accumulator.size( ) == 2 );
+
+	ns::infusion const whole{ 1.0, start, start + 60min };
+	for( auto offset = 5min; offset <= 320min; offset += 5min ) {
+		accumulator.advance( start + offset );
+		auto const expected = ns::insulin_on_board_activity( whole, start + offset ).iob + 2.0*ns::insulin_on_board_pct( static_cast<double>(offset.count( )), ns::insulin_duration_t::t240 );
+		BOOST_TEST( std::abs( expected - accumulator.iob( ) ) < 1.0e-9 );
+	}
+	BOOST_TEST( accumulator.empty( ) );
+}
@@ -0,0 +1,56 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016 Darrell Wright
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#define BOOST_TEST_MODULE iob_table_test 
+#include <boost/test/unit_test.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+#include "iob_calc.h"
+#include "iob_table.h"
+
+namespace {
+	constexpr ns::insulin_duration_t durations[] = { ns::insulin_duration_t::t180, ns::insulin_duration_t::t210, ns::insulin_duration_t::t240, ns::insulin_duration_t::t300, ns::insulin_duration_t::t360 };
+}
+
+BOOST_AUTO_TEST_CASE( iob_table_whole_minutes ) {
+	for( auto const duration: durations ) {
+		for( intmax_t age = -5; age <= static_cast<intmax_t>(duration) + 5; ++age ) {
+			auto const expected = ns::insulin_on_board_pct( static_cast<double>(age), duration );
+			BOOST_TEST( std::abs( expected - ns::iob_table::insulin_on_board_pct_minutes( age, duration ) ) < 1.0e-6 );
+			BOOST_TEST( std::abs( expected - ns::iob_table::insulin_on_board_pct( static_cast<double>(age), duration ) ) < 1.0e-6 );
+		}
+	}
+}
+
+BOOST_AUTO_TEST_CASE( iob_table_max_error ) {
+	for( auto const duration: durations ) {
+		double max_error = 0.0;
+		for( double age = 0.0; age <= static_cast<double>(duration); age += 0.01 ) {
+			max_error = std::max( max_error, std::abs( ns::insulin_on_board_pct( age, duration ) - ns::iob_table::insulin_on_board_pct( age, duration ) ) );
+		}
+		// largest errors are where the curve is clamped at 100% inside a minute
+		BOOST_TEST( max_error < 1.0e-3 );
+	}
+}
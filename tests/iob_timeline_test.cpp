@@ -0,0 +1,101 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016 Darrell Wright
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#define BOOST_TEST_MODULE iob_timeline_test 
+#include <boost/test/unit_test.hpp>
+
+#include <chrono>
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include "iob_calc.h"
+#include "iob_forecast.h"
+#include "iob_infusion.h"
+#include "iob_timeline.h"
+
+using namespace std::chrono;
+
+namespace {
+	constexpr ns::insulin_duration_t durations[] = { ns::insulin_duration_t::t180, ns::insulin_duration_t::t210, ns::insulin_duration_t::t240, ns::insulin_duration_t::t300, ns::insulin_duration_t::t360 };
+
+	/// doses on the 5 minute grid so binning is exact
+	std::vector<ns::dose> make_doses( system_clock::time_point const & start, size_t const count, int const days ) {
+		std::mt19937 rng{ 1 };
+		std::uniform_int_distribution<size_t> duration_dist{ 0, 4 };
+		std::uniform_int_distribution<int> offset_dist{ -100, days*24*12 };
+		std::uniform_real_distribution<double> amount_dist{ 0.025, 2.0 };
+		std::vector<ns::dose> result;
+		for( size_t n=0; n<count; ++n ) {
+			result.emplace_back( amount_dist( rng ), durations[duration_dist( rng )], start + minutes{ 5*offset_dist( rng ) } );
+		}
+		return result;
+	}
+}
+
+BOOST_AUTO_TEST_CASE( iob_timeline_matches_per_dose ) {
+	auto const start = time_point_cast<minutes>( system_clock::now( ) );
+	auto const end = start + 24h;
+	auto const doses = make_doses( start, 300, 1 );
+	for( auto const method: { ns::convolution_method_t::direct, ns::convolution_method_t::fft } ) {
+		auto const timeline = ns::iob_timeline( doses, { }, start, end, 5min, method );
+		BOOST_REQUIRE( timeline.size( ) == 289 );
+		auto const expected = ns::forecast_iob( doses, { }, start, 24h + 5min );
+		for( size_t k=0; k<timeline.size( ); ++k ) {
+			// forecast counts future doses as on board, the timeline does not
+			double future = 0.0;
+			for( auto const & item: doses ) {
+				if( item.dose_time > timeline.time_at( k ) ) {
+					future += item.amount;
+				}
+			}
+			BOOST_TEST( std::abs( expected.iob[k] - future - timeline.iob[k] ) < 1.0e-9 );
+			BOOST_TEST( std::abs( expected.activity[k] - timeline.activity[k] ) < 1.0e-9 );
+		}
+	}
+}
+
+BOOST_AUTO_TEST_CASE( iob_timeline_infusions ) {
+	auto const start = time_point_cast<minutes>( system_clock::now( ) );
+	std::vector<ns::infusion> const infusions = { ns::infusion{ 1.0, start - 2h, start + 3h }, ns::infusion{ 2.5, start + 3h, start + 3h + 40min, ns::insulin_duration_t::t180 } };
+	auto const timeline = ns::iob_timeline( { }, infusions, start, start + 10h, 5min, ns::convolution_method_t::direct );
+	for( size_t k=0; k<timeline.size( ); ++k ) {
+		ns::iob_activity_t expected{ 0.0, 0.0 };
+		for( auto const & item: infusions ) {
+			expected += ns::insulin_on_board_activity( item, timeline.time_at( k ) );
+		}
+		// segments on the grid are exact
+		BOOST_TEST( std::abs( expected.iob - timeline.iob[k] ) < 1.0e-9 );
+		BOOST_TEST( std::abs( expected.activity - timeline.activity[k] ) < 1.0e-9 );
+	}
+}
+
+BOOST_AUTO_TEST_CASE( iob_timeline_month ) {
+	auto const start = time_point_cast<minutes>( system_clock::now( ) );
+	auto const doses = make_doses( start, 30*24*12, 30 );
+	auto const direct = ns::iob_timeline( doses, { }, start, start + 24h*30, 1min, ns::convolution_method_t::direct );
+	auto const fft = ns::iob_timeline( doses, { }, start, start + 24h*30, 1min, ns::convolution_method_t::fft );
+	BOOST_REQUIRE_EQUAL( direct.size( ), fft.size( ) );
+	for( size_t k=0; k<direct.size( ); ++k ) {
+		BOOST_TEST( std::abs( direct.iob[k] - fft.iob[k] ) < 1.0e-8 );
+	}
+}
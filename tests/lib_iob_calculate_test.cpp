@@ -0,0 +1,76 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016 Darrell Wright
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#define BOOST_TEST_MODULE lib_iob_calculate_test 
+#include <boost/test/unit_test.hpp>
+
+#include <chrono>
+#include <cmath>
+#include <vector>
+
+#include "data_types.h"
+#include "lib_iob_calculate.h"
+
+using namespace std::chrono;
+
+namespace {
+	struct treatment_t {
+		ns::insulin_t insulin;
+		ns::timestamp_t date;
+	};	// treatment_t
+}
+
+BOOST_AUTO_TEST_CASE( iob_calc_range_matches_per_treatment ) {
+	auto const now = time_point_cast<minutes>( system_clock::now( ) );
+	std::vector<treatment_t> treatments;
+	for( int n=0; n<60; ++n ) {
+		treatments.push_back( { 0.1 * (n%7 + 1), now - minutes{ 5*n } } );
+	}
+	for( auto const dia: { 3.0, 4.0, 5.0 } ) {
+		double iob = 0.0;
+		double activity = 0.0;
+		for( auto const & treatment: treatments ) {
+			auto const contrib = ns::lib::iob::iobCalc( treatment, now, dia );
+			iob += contrib.iobContrib ? *contrib.iobContrib : 0.0;
+			activity += contrib.activityContrib ? *contrib.activityContrib : 0.0;
+		}
+		auto const total = ns::lib::iob::iobCalc( treatments.begin( ), treatments.end( ), now, dia );
+		BOOST_REQUIRE( total.iobContrib );
+		BOOST_REQUIRE( total.activityContrib );
+		BOOST_TEST( std::abs( iob - *total.iobContrib ) < 1.0e-12 );
+		BOOST_TEST( std::abs( activity - *total.activityContrib ) < 1.0e-12 );
+		BOOST_TEST( iob > 0.0 );
+	}
+	// a fixed time gives the same answer every call
+	auto const first = ns::lib::iob::iobCalc( treatments.begin( ), treatments.end( ), now, 3.0 );
+	auto const second = ns::lib::iob::iobCalc( treatments.begin( ), treatments.end( ), now, 3.0 );
+	BOOST_TEST( *first.iobContrib == *second.iobContrib );
+}
+
+BOOST_AUTO_TEST_CASE( iob_calc_fresh_bolus ) {
+	auto const now = time_point_cast<minutes>( system_clock::now( ) );
+	auto const contrib = ns::lib::iob::iobCalc( treatment_t{ 1.0, now }, now, 3.0 );
+	BOOST_REQUIRE( contrib.iobContrib );
+	BOOST_TEST( std::abs( *contrib.iobContrib - 1.0 ) < 1.0e-12 );
+	BOOST_TEST( *contrib.activityContrib == 0.0 );
+	BOOST_TEST( !ns::lib::iob::iobCalc( treatment_t{ 1.0, now - 4h }, now, 3.0 ).iobContrib );
+}
@@ -0,0 +1,110 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016 Darrell Wright
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#define BOOST_TEST_MODULE lib_iob_history_test 
+#include <boost/test/unit_test.hpp>
+
+#include <chrono>
+#include <cmath>
+#include <vector>
+
+#include "data_types.h"
+#include "lib_iob_history.h"
+
+using namespace std::chrono;
+using namespace ns::lib::iob;
+
+namespace {
+	// midnight UTC
+	ns::timestamp_t const s_day{ hours{ 24*365*47 } };
+
+	pump_history_t bolus( ns::timestamp_t when, ns::insulin_t amount ) {
+		return { pump_history_types::Bolus, when, amount, 0.0, pump_temp_basal_types::Absolute, minutes{ 0 } };
+	}
+
+	pump_history_t temp_basal( ns::timestamp_t when, ns::insulin_t rate, pump_temp_basal_types type = pump_temp_basal_types::Absolute ) {
+		return { pump_history_types::TempBasal, when, 0.0, rate, type, minutes{ 0 } };
+	}
+
+	pump_history_t temp_duration( ns::timestamp_t when, minutes length ) {
+		return { pump_history_types::TempBasalDuration, when, 0.0, 0.0, pump_temp_basal_types::Absolute, length };
+	}
+
+	std::vector<basal_profile_entry_t> const s_basal_profile = { { minutes{ 0 }, 0.8 }, { hours{ 6 }, 1.2 }, { hours{ 22 }, 0.9 } };
+}
+
+BOOST_AUTO_TEST_CASE( calc_temp_treatments_pairs_records ) {
+	// newest first, duration records on either side of their temp
+	std::vector<pump_history_t> const history = {
+		temp_duration( s_day + 7h, 30min ),
+		temp_basal( s_day + 7h, 2.0 ),
+		bolus( s_day + 6h + 50min, 3.0 ),
+		temp_basal( s_day + 6h + 30min, 50.0, pump_temp_basal_types::Percentage ),
+		temp_duration( s_day + 6h + 30min, 30min ),
+		temp_basal( s_day + 5h + 45min, 0.0 ),
+		temp_duration( s_day + 5h + 45min, 60min ),
+		bolus( s_day + 1h, 1.5 )
+	};
+	auto const result = calc_temp_treatments( history.data( ), history.size( ), s_basal_profile, seconds{ 0 } );
+	BOOST_REQUIRE( result.boluses.size( ) == 2 );
+	BOOST_TEST( (result.boluses[0].timestamp == s_day + 1h) );
+	BOOST_TEST( result.boluses[1].insulin == 3.0 );
+
+	BOOST_REQUIRE( result.temp_basals.size( ) == 2 );
+	BOOST_TEST( (result.temp_basals[0].start == s_day + 5h + 45min) );
+	BOOST_TEST( (result.temp_basals[0].end == s_day + 6h + 45min) );
+	BOOST_TEST( result.temp_basals[1].rate == 2.0 );
+
+	// the zero temp crosses the 06:00 change in schedule
+	BOOST_REQUIRE( result.net_basals.size( ) == 3 );
+	BOOST_TEST( (result.net_basals[0].end == s_day + 6h) );
+	BOOST_TEST( std::abs( result.net_basals[0].net_insulin( ) - (-0.8*0.25) ) < 1.0e-12 );
+	BOOST_TEST( std::abs( result.net_basals[1].net_insulin( ) - (-1.2*0.75) ) < 1.0e-12 );
+	BOOST_TEST( std::abs( result.net_basals[2].net_insulin( ) - (0.8*0.5) ) < 1.0e-12 );
+}
+
+BOOST_AUTO_TEST_CASE( calc_temp_treatments_overlap_and_midnight ) {
+	std::vector<pump_history_t> const history = {
+		temp_basal( s_day - 2h, 1.5 ),
+		temp_duration( s_day - 2h, 240min ),
+		// cancels the previous temp early
+		temp_basal( s_day + 30min, 0.5 ),
+		temp_duration( s_day + 30min, 30min )
+	};
+	// the pump is 3 hours behind UTC, so local midnight is at 03:00 UTC
+	auto const result = calc_temp_treatments( history.data( ), history.size( ), s_basal_profile, -hours{ 3 } );
+	BOOST_REQUIRE( result.temp_basals.size( ) == 2 );
+	BOOST_TEST( (result.temp_basals[0].end == s_day + 30min) );
+
+	// local 19:00 to 21:30 and 21:30 to 22:00 are both under the 06:00 rate
+	BOOST_REQUIRE( result.net_basals.size( ) == 2 );
+	BOOST_TEST( result.net_basals[0].scheduled_rate == 1.2 );
+	BOOST_TEST( result.net_basals[1].scheduled_rate == 1.2 );
+
+	auto const crossing = std::vector<pump_history_t>{ temp_basal( s_day + 2h, 2.0 ), temp_duration( s_day + 2h, 120min ) };
+	auto const midnight = calc_temp_treatments( crossing.data( ), crossing.size( ), s_basal_profile, -hours{ 3 } );
+	// local 23:00 to 01:00 crosses midnight
+	BOOST_REQUIRE( midnight.net_basals.size( ) == 2 );
+	BOOST_TEST( (midnight.net_basals[0].end == s_day + 3h) );
+	BOOST_TEST( midnight.net_basals[0].scheduled_rate == 0.9 );
+	BOOST_TEST( midnight.net_basals[1].scheduled_rate == 0.8 );
+}
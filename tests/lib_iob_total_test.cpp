@@ -0,0 +1,172 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016 Darrell Wright
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#define BOOST_TEST_MODULE lib_iob_total_test 
+#include <boost/test/unit_test.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <vector>
+
+#include "data_types.h"
+#include "lib_iob_calculate.h"
+#include "lib_iob_total.h"
+
+using namespace std::chrono;
+
+namespace {
+	// boluses every 40 minutes and temp basal pieces, some negative, every 5 over the last 8 hours and the next hour
+	std::vector<ns::iob_treatment_t> make_treatments( ns::timestamp_t const & now ) {
+		std::vector<ns::iob_treatment_t> result;
+		for( int n = -12; n < 96; ++n ) {
+			auto const when = now - minutes{ 5*n };
+			if( n % 8 == 0 ) {
+				result.push_back( { when, 0.5 + 0.25*(n % 3), true } );
+			}
+			result.push_back( { when, 0.05*(n % 5 - 2), false } );
+		}
+		std::reverse( result.begin( ), result.end( ) );
+		return result;
+	}
+
+	void check_close( boost::optional<ns::insulin_t> const & value, double expected ) {
+		BOOST_REQUIRE( value );
+		BOOST_TEST( std::abs( *value - expected ) < 1.0e-12 );
+	}
+}
+
+BOOST_AUTO_TEST_CASE( iob_total_matches_per_treatment ) {
+	auto const now = time_point_cast<minutes>( system_clock::now( ) );
+	auto const treatments = make_treatments( now );
+	ns::profile_t profile{ };
+	for( auto const dia: { 3.0, 4.0, 5.0 } ) {
+		double iob = 0, bolussnooze = 0, basaliob = 0, activity = 0, netbasalinsulin = 0, hightempinsulin = 0;
+		for( auto const & treatment: treatments ) {
+			if( treatment.date > now || treatment.date <= now - minutes{ static_cast<int>(60*dia) } ) {
+				continue;
+			}
+			auto const contrib = ns::lib::iob::iobCalc( treatment, now, dia );
+			auto const iob_contrib = contrib.iobContrib ? *contrib.iobContrib : 0.0;
+			iob += iob_contrib;
+			activity += contrib.activityContrib ? *contrib.activityContrib : 0.0;
+			if( treatment.insulin >= 0.1 && treatment.is_bolus ) {
+				auto const snooze = ns::lib::iob::iobCalc( treatment, now, dia/profile.bolussnooze_dia_divisor );
+				bolussnooze += snooze.iobContrib ? *snooze.iobContrib : 0.0;
+			} else {
+				basaliob += iob_contrib;
+				netbasalinsulin += treatment.insulin;
+				hightempinsulin += treatment.insulin > 0 ? treatment.insulin : 0.0;
+			}
+		}
+		auto const total = ns::iob_total( treatments, dia, profile, now );
+		BOOST_TEST( std::abs( total.iob - iob ) < 1.0e-12 );
+		BOOST_TEST( std::abs( total.activity - activity ) < 1.0e-12 );
+		BOOST_TEST( std::abs( total.bolussnooze - bolussnooze ) < 1.0e-12 );
+		check_close( total.basaliob, basaliob );
+		check_close( total.netbasalinsulin, netbasalinsulin );
+		check_close( total.hightempinsulin, hightempinsulin );
+		BOOST_TEST( total.iob > 0.0 );
+		BOOST_TEST( total.bolussnooze > 0.0 );
+		BOOST_TEST( *total.hightempinsulin > 0.0 );
+	}
+}
+
+BOOST_AUTO_TEST_CASE( iob_total_empty ) {
+	auto const now = time_point_cast<minutes>( system_clock::now( ) );
+	std::vector<ns::iob_treatment_t> const treatments;
+	auto const total = ns::iob_total( treatments, 3.0, ns::profile_t{ }, now );
+	BOOST_TEST( total.iob == 0.0 );
+	BOOST_TEST( total.activity == 0.0 );
+	BOOST_TEST( *total.netbasalinsulin == 0.0 );
+}
+
+BOOST_AUTO_TEST_CASE( iob_total_skips_expired ) {
+	auto const now = time_point_cast<minutes>( system_clock::now( ) );
+	std::vector<ns::iob_treatment_t> const treatments = { { now - 5h, 2.0, true }, { now - 4h, 1.0, false }, { now - 1h, 1.0, true } };
+	auto const total = ns::iob_total( treatments, 3.0, ns::profile_t{ }, now );
+	auto const contrib = ns::lib::iob::iobCalc( treatments.back( ), now, 3.0 );
+	BOOST_TEST( std::abs( total.iob - *contrib.iobContrib ) < 1.0e-12 );
+	BOOST_TEST( *total.netbasalinsulin == 0.0 );
+}
+
+BOOST_AUTO_TEST_CASE( iob_total_cache_hits ) {
+	auto const now = time_point_cast<minutes>( system_clock::now( ) );
+	auto treatments = make_treatments( now );
+	ns::profile_t profile{ };
+	ns::iob_total_cache cache{ };
+	auto const expected = ns::iob_total( treatments, 3.0, profile, now );
+	for( int n = 0; n < 3; ++n ) {
+		auto const cached = cache.get( treatments, 3.0, profile, now );
+		BOOST_TEST( cached.iob == expected.iob );
+		BOOST_TEST( cached.activity == expected.activity );
+		BOOST_TEST( cached.bolussnooze == expected.bolussnooze );
+		BOOST_TEST( *cached.basaliob == *expected.basaliob );
+		BOOST_TEST( *cached.netbasalinsulin == *expected.netbasalinsulin );
+		BOOST_TEST( *cached.hightempinsulin == *expected.hightempinsulin );
+	}
+	BOOST_TEST( cache.misses( ) == 1u );
+	BOOST_TEST( cache.hits( ) == 2u );
+
+	// history that has left the board does not change the key
+	treatments.insert( treatments.begin( ), { now - 10h, 1.0, true } );
+	cache.get( treatments, 3.0, profile, now );
+	BOOST_TEST( cache.hits( ) == 3u );
+
+	// anything that changes the answer misses
+	cache.get( treatments, 4.0, profile, now );
+	cache.get( treatments, 3.0, profile, now + 5min );
+	profile.bolussnooze_dia_divisor = 3.0;
+	cache.get( treatments, 3.0, profile, now );
+	treatments.back( ).insulin += 0.05;
+	profile.bolussnooze_dia_divisor = 2.0;
+	cache.get( treatments, 3.0, profile, now - 1h );
+	std::find_if( treatments.begin( ), treatments.end( ), [&]( auto const & item ) {
+		return item.date == now - 30min;
+	} )->insulin += 0.05;
+	cache.get( treatments, 3.0, profile, now );
+	BOOST_TEST( cache.misses( ) == 6u );
+	BOOST_TEST( cache.size( ) == 6u );
+}
+
+BOOST_AUTO_TEST_CASE( iob_total_cache_evicts_lru ) {
+	auto const now = time_point_cast<minutes>( system_clock::now( ) );
+	auto const treatments = make_treatments( now );
+	ns::profile_t const profile{ };
+	ns::iob_total_cache cache{ 1024 };
+	for( int n = 0; n < 100; ++n ) {
+		auto const when = now - minutes{ n };
+		auto const cached = cache.get( treatments, 3.0, profile, when );
+		BOOST_TEST( cached.iob == ns::iob_total( treatments, 3.0, profile, when ).iob );
+		BOOST_TEST( cache.bytes_used( ) <= cache.byte_budget( ) );
+	}
+	BOOST_TEST( cache.size( ) > 0u );
+	BOOST_TEST( cache.size( ) < 100u );
+	// the newest are kept, the oldest were evicted
+	auto const misses = cache.misses( );
+	cache.get( treatments, 3.0, profile, now - 99min );
+	BOOST_TEST( cache.misses( ) == misses );
+	cache.get( treatments, 3.0, profile, now );
+	BOOST_TEST( cache.misses( ) == misses + 1 );
+	cache.clear( );
+	BOOST_TEST( cache.size( ) == 0u );
+}
@@ -0,0 +1,178 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016 Darrell Wright
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#define BOOST_TEST_MODULE log_sink_test 
+#include <boost/test/unit_test.hpp>
+
+#include <chrono>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "log_sink.h"
+
+using namespace std::chrono;
+using ns::log::category_t;
+using ns::log::level_t;
+
+namespace {
+	ns::log::log_record_t make_record( double value ) {
+		return { system_clock::time_point{ }, "value {}", { { value } }, 1, level_t::info, category_t::core };
+	}
+
+	size_t count_lines( std::string const & str ) {
+		return static_cast<size_t>(std::count( str.begin( ), str.end( ), '\n' ));
+	}
+}
+
+BOOST_AUTO_TEST_CASE( log_record_format ) {
+	ns::log::log_record_t const record{ system_clock::time_point{ }, "iob={}U cob={}g {}", { { 1.5, 20.0 } }, 2, level_t::warning, category_t::iob };
+	std::stringstream ss;
+	ss << record;
+	auto const text = ss.str( );
+	BOOST_TEST( text.find( "warning iob: iob=1.5U cob=20g {}" ) != std::string::npos );
+}
+
+BOOST_AUTO_TEST_CASE( log_ring_bounded ) {
+	ns::log::log_ring_t ring{ 5 };
+	BOOST_TEST( ring.capacity( ) == 8 );
+	for( size_t n = 0; n < ring.capacity( ); ++n ) {
+		BOOST_TEST( ring.try_push( make_record( static_cast<double>(n) ) ) );
+	}
+	BOOST_TEST( !ring.try_push( make_record( 100.0 ) ) );
+	ns::log::log_record_t record;
+	for( size_t n = 0; n < ring.capacity( ); ++n ) {
+		BOOST_REQUIRE( ring.try_pop( record ) );
+		BOOST_TEST( record.args[0] == static_cast<double>(n) );
+	}
+	BOOST_TEST( !ring.try_pop( record ) );
+	// wraps around
+	BOOST_TEST( ring.try_push( make_record( 200.0 ) ) );
+	BOOST_REQUIRE( ring.try_pop( record ) );
+	BOOST_TEST( record.args[0] == 200.0 );
+}
+
+BOOST_AUTO_TEST_CASE( log_ring_concurrent ) {
+	ns::log::log_ring_t ring{ 64 };
+	size_t const producers = 4;
+	size_t const per_producer = 20000;
+	std::vector<std::thread> threads;
+	for( size_t p = 0; p < producers; ++p ) {
+		threads.emplace_back( [&ring, p]( ) {
+			for( size_t n = 0; n < per_producer; ++n ) {
+				auto record = make_record( static_cast<double>(n) );
+				record.args[1] = static_cast<double>(p);
+				while( !ring.try_push( record ) ) {
+					std::this_thread::yield( );
+				}
+			}
+		} );
+	}
+	std::vector<double> next( producers, 0.0 );
+	size_t received = 0;
+	bool in_order = true;
+	ns::log::log_record_t record;
+	while( received < producers * per_producer ) {
+		if( !ring.try_pop( record ) ) {
+			std::this_thread::yield( );
+			continue;
+		}
+		auto & expected = next[static_cast<size_t>(record.args[1])];
+		in_order = in_order && record.args[0] == expected;
+		expected = record.args[0] + 1.0;
+		++received;
+	}
+	for( auto & t: threads ) {
+		t.join( );
+	}
+	BOOST_TEST( in_order );
+	BOOST_TEST( !ring.try_pop( record ) );
+}
+
+BOOST_AUTO_TEST_CASE( log_sink_filters_and_drains ) {
+	std::stringstream out;
+	{
+		ns::log::log_sink_t sink{ out, 16, hours{ 1 } };
+		ns::log::install( &sink );
+		BOOST_TEST( ns::log::installed( ) == &sink );
+
+		ns::log::info( category_t::determine_basal, "Adjusting basal from {} to {}", 1.0, 1.2 );
+		ns::log::debug( category_t::determine_basal, "filtered by level" );
+		sink.categories( ns::log::category_bit( category_t::iob ) );
+		ns::log::warning( category_t::simulator, "filtered by category" );
+		ns::log::error( category_t::iob, "iob {}", 2.5 );
+		sink.flush( );
+		auto const text = out.str( );
+		BOOST_TEST( count_lines( text ) == 2 );
+		BOOST_TEST( text.find( "info determine_basal: Adjusting basal from 1 to 1.2" ) != std::string::npos );
+		BOOST_TEST( text.find( "error iob: iob 2.5" ) != std::string::npos );
+		BOOST_TEST( sink.written( ) == 2 );
+
+		// a full ring drops instead of waiting
+		sink.min_level( level_t::trace );
+		for( size_t n = 0; n < 20; ++n ) {
+			ns::log::write<level_t::trace>( category_t::iob, "n={}", n );
+		}
+		BOOST_TEST( sink.dropped( ) == 4 );
+		ns::log::info( category_t::iob, "queued at exit" );
+	}
+	BOOST_TEST( ns::log::installed( ) == nullptr );
+	// the destructor writes what is still queued
+	BOOST_TEST( count_lines( out.str( ) ) == 2 + 16 );
+}
+
+BOOST_AUTO_TEST_CASE( log_sink_caller_time ) {
+	std::stringstream out;
+	ns::log::log_sink_t sink{ out, 16, hours{ 1 } };
+	ns::log::install( &sink );
+	system_clock::time_point const when{ seconds{ 90 } };
+	ns::log::write_at<level_t::info>( when, category_t::simulator, "t={}", 5 );
+	sink.flush( );
+	std::stringstream expected;
+	expected << ns::log::log_record_t{ when, "t={}", { { 5.0 } }, 1, level_t::info, category_t::simulator } << '\n';
+	BOOST_TEST( out.str( ) == expected.str( ) );
+}
+
+BOOST_AUTO_TEST_CASE( log_sink_overflow_wait ) {
+	std::stringstream out;
+	// the interval is long, so only the waiting producer waking the drain thread makes room
+	ns::log::log_sink_t sink{ out, 16, hours{ 1 } };
+	sink.overflow( ns::log::overflow_t::wait );
+	for( size_t n = 0; n < 1000; ++n ) {
+		BOOST_TEST( sink.try_log( make_record( static_cast<double>(n) ) ) );
+	}
+	sink.flush( );
+	BOOST_TEST( sink.dropped( ) == 0 );
+	BOOST_TEST( sink.written( ) == 1000 );
+	BOOST_TEST( count_lines( out.str( ) ) == 1000 );
+}
+
+BOOST_AUTO_TEST_CASE( log_sink_background_drain ) {
+	std::stringstream out;
+	ns::log::log_sink_t sink{ out, 64, milliseconds{ 1 } };
+	BOOST_TEST( sink.try_log( make_record( 1.0 ) ) );
+	for( size_t n = 0; n < 1000 && sink.written( ) == 0; ++n ) {
+		std::this_thread::sleep_for( milliseconds{ 1 } );
+	}
+	BOOST_TEST( sink.written( ) == 1 );
+}
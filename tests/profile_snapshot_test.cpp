@@ -0,0 +1,121 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016 Darrell Wright
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#define BOOST_TEST_MODULE profile_snapshot_test 
+#include <boost/test/unit_test.hpp>
+
+#include <boost/filesystem.hpp>
+#include <chrono>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "compiled_profile.h"
+#include "profile_snapshot.h"
+#include "tz_cache.h"
+
+using namespace std::chrono;
+
+namespace {
+	struct temp_dir_t {
+		boost::filesystem::path path;
+
+		temp_dir_t( ):
+				path{ boost::filesystem::temp_directory_path( ) / boost::filesystem::unique_path( ) } {
+
+			boost::filesystem::create_directories( path );
+		}
+
+		~temp_dir_t( ) {
+			boost::filesystem::remove_all( path );
+		}
+
+		temp_dir_t( temp_dir_t const & ) = delete;
+		temp_dir_t & operator=( temp_dir_t const & ) = delete;
+
+		std::string file( std::string const & name ) const {
+			return (path / name).string( );
+		}
+	};	// temp_dir_t
+
+	void write_file( std::string const & file_name, std::string const & contents ) {
+		std::ofstream out{ file_name, std::ios::binary | std::ios::trunc };
+		out << contents;
+	}
+
+	ns::compiled_profile_t make_profile( ) {
+		return ns::compiled_profile_t{ { { minutes{ 0 }, 0.8 }, { hours{ 6 }, 1.2 }, { hours{ 22 }, 0.9 } }, { { minutes{ 0 }, 50.0 }, { hours{ 9 }, 45.0 } }, { { minutes{ 0 }, 12.0 } }, { { minutes{ 0 }, 100.0, 120.0 }, { hours{ 7 }, 90.0, 110.0 } }, ns::tz_cache_t{ hours{ 0 } } };
+	}
+}
+
+BOOST_AUTO_TEST_CASE( profile_snapshot_file_hash ) {
+	temp_dir_t const dir;
+	write_file( dir.file( "a.json" ), "{ \"rate\": 0.8 }" );
+	write_file( dir.file( "b.json" ), "{ \"rate\": 0.9 }" );
+	write_file( dir.file( "c.json" ), "{ \"rate\": 0.8 }" );
+	auto const hashes = ns::profile_snapshot::file_hashes( { dir.file( "a.json" ), dir.file( "b.json" ), dir.file( "c.json" ) } );
+	BOOST_TEST( hashes[0] != hashes[1] );
+	BOOST_TEST( hashes[0] == hashes[2] );
+	BOOST_CHECK_THROW( ns::profile_snapshot::file_hash( dir.file( "missing.json" ) ), std::runtime_error );
+}
+
+BOOST_AUTO_TEST_CASE( profile_snapshot_round_trip ) {
+	temp_dir_t const dir;
+	auto const snapshot = dir.file( "profile.snapshot" );
+	auto const profile = make_profile( );
+	std::vector<uint64_t> const hashes = { 1, 2, 3, 4 };
+	ns::profile_snapshot::save( snapshot, profile, hashes );
+
+	auto const loaded = ns::profile_snapshot::load( snapshot, hashes, ns::tz_cache_t{ hours{ 0 } } );
+	BOOST_REQUIRE( loaded );
+	for( minutes minute{ 0 }; minute < hours{ 24 }; ++minute ) {
+		auto const & expected = profile.at_minute( minute );
+		auto const & value = loaded->at_minute( minute );
+		BOOST_TEST( value.basal == expected.basal );
+		BOOST_TEST( value.isf == expected.isf );
+		BOOST_TEST( value.carb_ratio == expected.carb_ratio );
+		BOOST_TEST( value.min_bg == expected.min_bg );
+		BOOST_TEST( value.max_bg == expected.max_bg );
+	}
+	BOOST_TEST( loaded->basal_schedule( ).daily_total( ) == profile.basal_schedule( ).daily_total( ) );
+	BOOST_TEST( !boost::filesystem::exists( snapshot + ".tmp" ) );
+}
+
+BOOST_AUTO_TEST_CASE( profile_snapshot_rejects_stale ) {
+	temp_dir_t const dir;
+	auto const snapshot = dir.file( "profile.snapshot" );
+	ns::tz_cache_t const tz{ hours{ 0 } };
+	BOOST_TEST( !ns::profile_snapshot::load( snapshot, { 1, 2 }, tz ) );
+
+	ns::profile_snapshot::save( snapshot, make_profile( ), { 1, 2 } );
+	BOOST_TEST( static_cast<bool>( ns::profile_snapshot::load( snapshot, { 1, 2 }, tz ) ) );
+	BOOST_TEST( !ns::profile_snapshot::load( snapshot, { 1, 3 }, tz ) );
+	BOOST_TEST( !ns::profile_snapshot::load( snapshot, { 1, 2, 3 }, tz ) );
+
+	// truncated
+	auto const size = boost::filesystem::file_size( snapshot );
+	boost::filesystem::resize_file( snapshot, size - 8 );
+	BOOST_TEST( !ns::profile_snapshot::load( snapshot, { 1, 2 }, tz ) );
+
+	write_file( snapshot, "not a snapshot" );
+	BOOST_TEST( !ns::profile_snapshot::load( snapshot, { 1, 2 }, tz ) );
+}
@@ -0,0 +1,170 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016 Darrell Wright
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#define BOOST_TEST_MODULE stage_latency_test 
+#include <boost/test/unit_test.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "stage_latency.h"
+
+using namespace std::chrono;
+using ns::latency::histogram_t;
+using ns::latency::stage_t;
+
+namespace {
+	ns::latency::stage_summary_t summary_for( stage_t stage ) {
+		for( auto const & summary: ns::latency::summarize( ) ) {
+			if( summary.stage == stage ) {
+				return summary;
+			}
+		}
+		throw std::runtime_error( "Missing stage" );
+	}
+}
+
+BOOST_AUTO_TEST_CASE( histogram_buckets ) {
+	for( uint64_t value = 0; value < 64; ++value ) {
+		BOOST_TEST( histogram_t::bucket_value( histogram_t::bucket_index( value ) ) == value );
+	}
+	size_t last_index = 0;
+	for( uint64_t value = 1; value < (uint64_t{ 1 } << 40); value = value + value/7 + 1 ) {
+		auto const index = histogram_t::bucket_index( value );
+		BOOST_REQUIRE( index < histogram_t::bucket_count );
+		BOOST_TEST( index >= last_index );
+		last_index = index;
+		auto const reported = histogram_t::bucket_value( index );
+		BOOST_TEST( reported >= value );
+		BOOST_TEST( static_cast<double>(reported - value) <= static_cast<double>(value)/32.0 );
+	}
+	// longer values are clamped to the last bucket
+	BOOST_TEST( histogram_t::bucket_index( uint64_t{ 1 } << 50 ) == histogram_t::bucket_count - 1 );
+}
+
+BOOST_AUTO_TEST_CASE( latency_percentiles ) {
+	ns::latency::reset( );
+	for( int n = 1000; n >= 1; --n ) {
+		ns::latency::record( stage_t::iob_total, microseconds{ n } );
+	}
+	auto const summary = summary_for( stage_t::iob_total );
+	BOOST_TEST( summary.count == 1000 );
+	BOOST_TEST( std::abs( static_cast<double>(summary.p50.count( )) - 500.0e3 ) <= 500.0e3/32.0 );
+	BOOST_TEST( std::abs( static_cast<double>(summary.p99.count( )) - 990.0e3 ) <= 990.0e3/32.0 );
+	BOOST_TEST( summary.max.count( ) == 1000000 );
+	BOOST_TEST( summary_for( stage_t::determine_basal ).count == 0 );
+
+	ns::latency::reset( );
+	BOOST_TEST( summary_for( stage_t::iob_total ).count == 0 );
+}
+
+BOOST_AUTO_TEST_CASE( latency_threads ) {
+	ns::latency::reset( );
+	std::vector<std::thread> threads;
+	for( int t = 0; t < 4; ++t ) {
+		threads.emplace_back( [t]( ) {
+			for( int n = 0; n < 1000; ++n ) {
+				ns::latency::record( stage_t::calc_temp_treatments, nanoseconds{ 100 * (t + 1) } );
+			}
+		} );
+	}
+	for( auto & thread: threads ) {
+		thread.join( );
+	}
+	// histograms of finished threads are kept
+	auto const summary = summary_for( stage_t::calc_temp_treatments );
+	BOOST_TEST( summary.count == 4000 );
+	BOOST_TEST( summary.max.count( ) == 400 );
+	BOOST_TEST( summary.p50.count( ) >= 200 );
+	BOOST_TEST( summary.p50.count( ) <= 207 );
+}
+
+BOOST_AUTO_TEST_CASE( latency_thread_slots_reused ) {
+	ns::latency::reset( );
+	ns::latency::record( stage_t::iob_total, nanoseconds{ 50 } );
+	auto const slots = ns::latency::thread_slots( );
+	for( int t = 0; t < 16; ++t ) {
+		std::thread{ []( ) {
+			ns::latency::record( stage_t::iob_total, nanoseconds{ 100 } );
+		} }.join( );
+	}
+	// one thread at a time, each takes the slot the last one freed
+	BOOST_TEST( ns::latency::thread_slots( ) <= slots + 1 );
+	auto const summary = summary_for( stage_t::iob_total );
+	BOOST_TEST( summary.count == 17 );
+	BOOST_TEST( summary.max.count( ) == 100 );
+}
+
+BOOST_AUTO_TEST_CASE( latency_reset_while_recording ) {
+	ns::latency::reset( );
+	std::atomic<bool> stop{ false };
+	std::atomic<bool> started{ false };
+	std::thread recorder{ [&]( ) {
+		while( !stop ) {
+			ns::latency::record( stage_t::determine_basal, nanoseconds{ 1000 } );
+			started = true;
+		}
+		ns::latency::record( stage_t::determine_basal, nanoseconds{ 1000 } );
+	} };
+	while( !started ) {
+		std::this_thread::yield( );
+	}
+	for( int n = 0; n < 100; ++n ) {
+		ns::latency::reset( );
+		ns::latency::summarize( );
+	}
+	ns::latency::reset( );
+	// the recorder clears its old values on its next record
+	BOOST_TEST( summary_for( stage_t::determine_basal ).count <= 1 );
+	stop = true;
+	recorder.join( );
+	auto const summary = summary_for( stage_t::determine_basal );
+	BOOST_TEST( summary.count >= 1 );
+	BOOST_TEST( summary.max.count( ) == 1000 );
+}
+
+BOOST_AUTO_TEST_CASE( latency_scoped_timer_and_output ) {
+	ns::latency::reset( );
+	{
+		ns::latency::scoped_timer_t const timer{ stage_t::profile_load };
+		std::this_thread::sleep_for( milliseconds{ 2 } );
+	}
+	auto const summary = summary_for( stage_t::profile_load );
+	BOOST_TEST( summary.count == 1 );
+	BOOST_TEST( summary.max.count( ) >= 2000000 );
+
+	std::stringstream text;
+	ns::latency::write( text, ns::latency::output_formats::text );
+	BOOST_TEST( text.str( ).find( "profile_load" ) != std::string::npos );
+	BOOST_TEST( text.str( ).find( "determine_basal" ) != std::string::npos );
+
+	std::stringstream json;
+	ns::latency::write( json, ns::latency::output_formats::json );
+	BOOST_TEST( json.str( ).find( "{ \"stage\": \"profile_load\", \"count\": 1, " ) != std::string::npos );
+}
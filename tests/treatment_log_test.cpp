@@ -0,0 +1,107 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016 Darrell Wright
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#define BOOST_TEST_MODULE treatment_log_test 
+#include <boost/test/unit_test.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include "data_types.h"
+#include "lib_iob_history.h"
+#include "treatment_log.h"
+
+using namespace std::chrono;
+using namespace ns::lib::iob;
+
+namespace {
+	ns::timestamp_t const s_day{ hours{ 24*365*47 } };
+	std::vector<basal_profile_entry_t> const s_basal_profile = { { minutes{ 0 }, 0.8 }, { hours{ 6 }, 1.2 }, { hours{ 22 }, 0.9 } };
+
+	/// Two days of history, oldest first, with temps every 20-40 minutes that often cancel the previous one
+	std::vector<pump_history_t> make_history( ) {
+		std::mt19937 rng{ 1 };
+		std::uniform_int_distribution<int> gap_dist{ 20, 40 };
+		std::uniform_int_distribution<int> length_dist{ 1, 4 };
+		std::uniform_int_distribution<int> rate_dist{ 0, 60 };
+		std::vector<pump_history_t> result;
+		for( auto when = s_day; when < s_day + 48h; when += minutes{ gap_dist( rng ) } ) {
+			if( rate_dist( rng ) < 10 ) {
+				result.push_back( { pump_history_types::Bolus, when, 0.1 * rate_dist( rng ), 0.0, pump_temp_basal_types::Absolute, minutes{ 0 } } );
+				continue;
+			}
+			auto const type = rate_dist( rng ) < 3 ? pump_temp_basal_types::Percentage : pump_temp_basal_types::Absolute;
+			result.push_back( { pump_history_types::TempBasal, when, 0.0, 0.05 * rate_dist( rng ), type, minutes{ 0 } } );
+			result.push_back( { pump_history_types::TempBasalDuration, when, 0.0, 0.0, pump_temp_basal_types::Absolute, minutes{ 30*length_dist( rng ) } } );
+		}
+		return result;
+	}
+
+	void check_matches( treatment_log const & log, std::vector<pump_history_t> const & history, size_t const count ) {
+		auto const expected = calc_temp_treatments( history.data( ), count, s_basal_profile, -hours{ 5 } );
+		auto const & result = log.treatments( );
+		BOOST_REQUIRE( result.boluses.size( ) == expected.boluses.size( ) );
+		BOOST_REQUIRE( result.temp_basals.size( ) == expected.temp_basals.size( ) );
+		BOOST_REQUIRE( result.net_basals.size( ) == expected.net_basals.size( ) );
+		double net_basal = 0.0;
+		for( size_t n = 0; n < expected.net_basals.size( ); ++n ) {
+			BOOST_TEST( (result.net_basals[n].start == expected.net_basals[n].start) );
+			BOOST_TEST( (result.net_basals[n].end == expected.net_basals[n].end) );
+			BOOST_TEST( result.net_basals[n].scheduled_rate == expected.net_basals[n].scheduled_rate );
+			net_basal += expected.net_basals[n].net_insulin( );
+		}
+		BOOST_TEST( std::abs( net_basal - log.net_basal_insulin( ) ) < 1.0e-9 );
+	}
+}
+
+BOOST_AUTO_TEST_CASE( treatment_log_incremental ) {
+	auto const history = make_history( );
+	treatment_log log{ s_basal_profile, -hours{ 5 } };
+	// batches of the last 30 records every 5 records, newest first like the pump reports them.  Batch edges
+	// split temps from their durations
+	for( size_t end = 5; end < history.size( ) + 5; end += 5 ) {
+		auto const last = std::min( end, history.size( ) );
+		auto const first = last > 30 ? last - 30 : 0;
+		std::vector<pump_history_t> batch{ history.begin( ) + static_cast<intmax_t>(first), history.begin( ) + static_cast<intmax_t>(last) };
+		std::reverse( batch.begin( ), batch.end( ) );
+		log.ingest( batch );
+		check_matches( log, history, last );
+	}
+	BOOST_TEST( log.size( ) == history.size( ) );
+	BOOST_TEST( log.rebuilds( ) == 0 );
+}
+
+BOOST_AUTO_TEST_CASE( treatment_log_out_of_order ) {
+	auto const history = make_history( );
+	treatment_log log{ s_basal_profile, -hours{ 5 } };
+	auto const middle = history.size( )/2 + 1;
+	std::vector<pump_history_t> const newer{ history.begin( ) + static_cast<intmax_t>(middle), history.end( ) };
+	std::vector<pump_history_t> const older{ history.begin( ), history.begin( ) + static_cast<intmax_t>(middle) };
+	log.ingest( newer );
+	BOOST_TEST( log.ingest( older ) == older.size( ) );
+	BOOST_TEST( log.rebuilds( ) == 1 );
+	check_matches( log, history, history.size( ) );
+	BOOST_TEST( log.ingest( history ) == 0 );
+}
@@ -0,0 +1,110 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016 Darrell Wright
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#define BOOST_TEST_MODULE tz_cache_test 
+#include <boost/test/unit_test.hpp>
+
+#include <chrono>
+#include <date/tz.h>
+#include <vector>
+
+#include "data_types.h"
+#include "lib_iob_history.h"
+#include "tz_cache.h"
+
+using namespace std::chrono;
+
+namespace {
+	// America/New_York went from -5h to -4h at 2016-03-13T07:00Z and back at 2016-11-06T06:00Z
+	ns::timestamp_t const s_spring{ seconds{ 1457852400 } };
+	ns::timestamp_t const s_fall{ seconds{ 1478412000 } };
+	ns::timestamp_t const s_march_13{ seconds{ 1457827200 } };	// midnight UTC
+
+	ns::tz_cache_t const s_new_york{ std::vector<ns::tz_cache_t::transition_t>{ { s_spring - hours{ 24*200 }, hours{ -5 } }, { s_spring, hours{ -4 } }, { s_fall, hours{ -5 } } } };
+}
+
+BOOST_AUTO_TEST_CASE( tz_cache_fixed_offset ) {
+	ns::tz_cache_t const tz{ hours{ -7 } };
+	BOOST_TEST( tz.offset( s_spring ).count( ) == duration_cast<seconds>( hours{ -7 } ).count( ) );
+	BOOST_TEST( (tz.to_local( s_spring ) == s_spring.time_since_epoch( ) - hours{ 7 }) );
+	BOOST_TEST( (tz.from_local( tz.to_local( s_spring ) ) == s_spring) );
+	BOOST_TEST( tz.transitions( ).empty( ) );
+}
+
+BOOST_AUTO_TEST_CASE( tz_cache_transitions ) {
+	BOOST_TEST( s_new_york.offset( s_spring - seconds{ 1 } ).count( ) == -5*3600 );
+	BOOST_TEST( s_new_york.offset( s_spring ).count( ) == -4*3600 );
+	BOOST_TEST( s_new_york.offset( s_fall ).count( ) == -5*3600 );
+	// before the first transition uses its offset
+	BOOST_TEST( s_new_york.offset( s_spring - hours{ 24*365 } ).count( ) == -5*3600 );
+	// every time round trips, the repeated local hour in the fall resolves to one of its two times
+	for( auto ts = s_spring - hours{ 24 }; ts < s_spring + hours{ 24 }; ts += minutes{ 15 } ) {
+		BOOST_TEST( (s_new_york.from_local( s_new_york.to_local( ts ) ) == ts) );
+	}
+	for( auto ts = s_fall - hours{ 24 }; ts < s_fall + hours{ 24 }; ts += minutes{ 15 } ) {
+		auto const local = s_new_york.to_local( ts );
+		BOOST_TEST( (s_new_york.to_local( s_new_york.from_local( local ) ) == local) );
+	}
+	// 02:30 did not happen on March 13, it resolves with the offset before the change
+	auto const skipped = s_march_13.time_since_epoch( ) + hours{ 2 } + minutes{ 30 };
+	BOOST_TEST( (s_new_york.from_local( skipped ) == s_spring + minutes{ 30 }) );
+}
+
+BOOST_AUTO_TEST_CASE( tz_cache_named_zone ) {
+	ns::tz_cache_t tz{ "America/New_York", s_spring - hours{ 48 }, s_spring + hours{ 24 } };
+	auto const zone = date::locate_zone( "America/New_York" );
+	auto const check = [&]( ns::timestamp_t const & from, ns::timestamp_t const & to ) {
+		for( auto ts = from; ts < to; ts += minutes{ 30 } ) {
+			auto const expected = duration_cast<seconds>( zone->get_info( date::floor<seconds>( ts ) ).offset );
+			BOOST_TEST( tz.offset( ts ).count( ) == expected.count( ) );
+		}
+	};
+	BOOST_TEST( tz.transitions( ).size( ) == 2u );
+	check( s_spring - hours{ 48 }, s_spring + hours{ 24 } );
+	// outside the window asks the zone
+	check( s_fall - hours{ 2 }, s_fall + hours{ 2 } );
+	tz.cover( s_fall - hours{ 2 }, s_fall + hours{ 2 } );
+	BOOST_TEST( tz.transitions( ).size( ) == 3u );
+	check( s_fall - hours{ 2 }, s_fall + hours{ 2 } );
+}
+
+BOOST_AUTO_TEST_CASE( tz_cache_basal_schedule_across_dst ) {
+	using namespace ns::lib::iob;
+	std::vector<basal_profile_entry_t> const basal_profile = { { minutes{ 0 }, 0.8 }, { hours{ 6 }, 1.2 }, { hours{ 22 }, 0.9 } };
+	// local 23:00 March 12 until 08:00 March 13, clocks go forward at 02:00
+	temp_basal_t const temp{ s_march_13 + hours{ 4 }, s_march_13 + hours{ 12 }, 2.0 };
+	std::vector<net_basal_t> pieces;
+	BOOST_REQUIRE_EQUAL( split_temp_basal( temp, basal_profile, s_new_york, pieces ), 3u );
+	BOOST_TEST( (pieces[0].start == temp.start && pieces[0].end == s_march_13 + hours{ 5 }) );
+	BOOST_TEST( pieces[0].scheduled_rate == 0.9 );
+	// 06:00 local is 10:00Z after the change, not 11:00Z
+	BOOST_TEST( (pieces[1].end == s_march_13 + hours{ 10 }) );
+	BOOST_TEST( pieces[1].scheduled_rate == 0.8 );
+	BOOST_TEST( (pieces[2].start == s_march_13 + hours{ 10 } && pieces[2].end == temp.end) );
+	BOOST_TEST( pieces[2].scheduled_rate == 1.2 );
+
+	// a fixed offset gives the same pieces as before the change
+	std::vector<net_basal_t> fixed;
+	split_temp_basal( temp, basal_profile, hours{ -5 }, fixed );
+	BOOST_REQUIRE_EQUAL( fixed.size( ), 3u );
+	BOOST_TEST( (fixed[1].end == s_march_13 + hours{ 11 }) );
+}